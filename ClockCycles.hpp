@@ -50,5 +50,23 @@ constexpr uint32_t fromMicroseconds(uint32_t microSeconds) {
 }
 
 
+/// Get a free running counter of clock cycles.
+///
+/// The counter is derived from the millisecond tick and the SysTick timer. It wraps
+/// after ~89 seconds, so only use it to measure short durations by subtraction.
+///
+uint32_t getCounter();
+
+/// Get the millisecond tick and the clock cycles elapsed in this tick.
+///
+/// A SysTick wrap with a pending interrupt is counted like in `getCounter()`, so the
+/// result never goes backwards, even in interrupts with a higher priority than SysTick.
+///
+/// @param ticks The variable for the millisecond tick.
+/// @param cycles The variable for the clock cycles since the start of the tick.
+///
+void getTickAndCycles(uint32_t &ticks, uint32_t &cycles);
+
+
 }
 
@@ -0,0 +1,434 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+// Coroutines need C++20, enable it for the library and the firmware with `hal_feature_coroutines()`.
+#if !defined(__cpp_impl_coroutine)
+#error "Coroutine_SAMD21.hpp needs C++20 coroutines, use hal_feature_coroutines() in CMakeLists.txt."
+#endif
+
+
+#include "WireMaster_SAMD21.hpp"
+
+#include "hal-core/Chip.hpp"
+#include "hal-common/InterruptLock.hpp"
+#include "hal-common/SerialLine.hpp"
+#include "hal-common/StatusTools.hpp"
+#include "hal-common/Timer.hpp"
+
+#include <coroutine>
+#include <cstdint>
+
+
+namespace lr::Coroutine {
+
+
+/// A coroutine started by the executor.
+///
+/// The coroutine starts suspended and is resumed by the executor after `Executor::spawn()`.
+/// It destroys itself when it returns. The frame is allocated with `operator new`.
+///
+/// Example:
+/// ```
+/// Coroutine::Task readSensor(Coroutine::Executor &executor) {
+///     uint8_t data[6];
+///     while (true) {
+///         const auto status = co_await executor.readRegisterData(gWire, 0x1d, 0x01, data, 6);
+///         ...
+///         co_await executor.delay(10_ms);
+///     }
+/// }
+/// ```
+///
+class Task
+{
+public:
+    struct promise_type {
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+
+public:
+    explicit Task(std::coroutine_handle<> handle) noexcept : _handle(handle) {}
+
+    /// Get the handle of the coroutine.
+    ///
+    std::coroutine_handle<> getHandle() const noexcept { return _handle; }
+
+private:
+    std::coroutine_handle<> _handle; ///< The handle of the coroutine.
+};
+
+
+/// A single threaded executor for coroutines.
+///
+/// Coroutines waiting for an interrupt are resumed with `post()`, which is safe to call from
+/// interrupt handlers. Delays are checked against the millisecond tick, and polling awaitables
+/// are checked in every loop. If there is nothing to resume, the CPU sleeps with WFI until the
+/// next interrupt. The SysTick interrupt wakes it at least every millisecond.
+///
+class Executor
+{
+public:
+    /// The size of the ready queue.
+    ///
+    static constexpr uint8_t cReadySize = 8;
+
+    /// The maximum number of sleeping coroutines.
+    ///
+    static constexpr uint8_t cSleepSize = 8;
+
+    /// The maximum number of polling coroutines.
+    ///
+    static constexpr uint8_t cPollSize = 4;
+
+    /// A function to check if a polling coroutine can be resumed.
+    ///
+    using PollFunction = bool(*)(void *context);
+
+public:
+    /// An awaitable for an asynchronous I2C transaction.
+    ///
+    class WireAwaitable
+    {
+    public:
+        using Status = WireMaster::Status;
+        using Start = Status(*)(WireAwaitable &awaitable);
+
+    public:
+        WireAwaitable(Executor &executor, WireMaster_SAMD21 &bus, uint8_t address, uint8_t registerAddress,
+            uint8_t *data, uint8_t count, Start start) noexcept
+            : executor(executor), bus(bus), address(address), registerAddress(registerAddress),
+            data(data), count(count), _start(start), _status(Status::Success), _handle()
+        {
+        }
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            _handle = handle;
+            _status = _start(*this);
+            // Continue directly if the transaction did not start.
+            return isSuccessful(_status);
+        }
+        Status await_resume() const noexcept { return _status; }
+
+        /// The callback of the transaction.
+        ///
+        static void onComplete(void *context, Status status) {
+            auto &awaitable = *static_cast<WireAwaitable*>(context);
+            awaitable._status = status;
+            awaitable.executor.post(awaitable._handle);
+        }
+
+    public:
+        Executor &executor; ///< The executor.
+        WireMaster_SAMD21 &bus; ///< The bus.
+        const uint8_t address; ///< The 7bit address of the device.
+        const uint8_t registerAddress; ///< The register address.
+        uint8_t *const data; ///< The data buffer.
+        const uint8_t count; ///< The number of bytes.
+
+    private:
+        const Start _start; ///< The function to start the transaction.
+        volatile Status _status; ///< The result of the transaction.
+        std::coroutine_handle<> _handle; ///< The waiting coroutine.
+    };
+
+    /// An awaitable for a delay.
+    ///
+    class DelayAwaitable
+    {
+    public:
+        DelayAwaitable(Executor &executor, Milliseconds delay) noexcept
+            : _executor(executor), _delay(delay) {}
+
+        bool await_ready() const noexcept { return _delay.ticks() == 0; }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            return _executor.addSleep(handle, _delay);
+        }
+        void await_resume() const noexcept {}
+
+    private:
+        Executor &_executor; ///< The executor.
+        const Milliseconds _delay; ///< The delay.
+    };
+
+    /// An awaitable to send data to a serial line, e.g. the USB CDC serial line.
+    ///
+    /// Waits without blocking until the serial line can accept all bytes, then sends them.
+    ///
+    class SendAwaitable
+    {
+    public:
+        using Status = SerialLine::Status;
+
+    public:
+        SendAwaitable(Executor &executor, SerialLine &serialLine, const uint8_t *data, SerialLine::DataSize size) noexcept
+            : _executor(executor), _serialLine(serialLine), _data(data), _size(size) {}
+
+        bool await_ready() noexcept { return isReady(this); }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept {
+            return _executor.addPoll(handle, &SendAwaitable::isReady, this);
+        }
+        Status await_resume() noexcept { return _serialLine.send(_data, _size); }
+
+    private:
+        static bool isReady(void *context) {
+            auto &awaitable = *static_cast<SendAwaitable*>(context);
+            return awaitable._serialLine.sendBytesAvailable() >= awaitable._size;
+        }
+
+    private:
+        Executor &_executor; ///< The executor.
+        SerialLine &_serialLine; ///< The serial line.
+        const uint8_t *const _data; ///< The data to send.
+        const SerialLine::DataSize _size; ///< The number of bytes to send.
+    };
+
+public:
+    /// Create an empty executor.
+    ///
+    Executor() noexcept
+        : _ready(), _readyHead(0), _readyCount(0), _sleeping(), _polling()
+    {
+    }
+
+public:
+    /// Start a coroutine.
+    ///
+    /// If the ready queue is full, the coroutine never runs and its frame is destroyed.
+    ///
+    /// @param task The coroutine.
+    /// @return `true` if the coroutine was queued, `false` if the ready queue is full.
+    ///
+    bool spawn(Task task) noexcept {
+        const auto handle = task.getHandle();
+        if (!post(handle)) {
+            handle.destroy();
+            return false;
+        }
+        return true;
+    }
+
+    /// Queue a coroutine to be resumed.
+    ///
+    /// This method can be called from interrupt handlers.
+    ///
+    /// @param handle The coroutine to resume.
+    /// @return `true` if the coroutine was queued, `false` if the ready queue is full.
+    ///
+    bool post(std::coroutine_handle<> handle) noexcept {
+        const bool isInterrupt = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0;
+        if (!isInterrupt) {
+            __disable_irq();
+        }
+        bool result = false;
+        if (_readyCount < cReadySize) {
+            _ready[(_readyHead + _readyCount) % cReadySize] = handle;
+            _readyCount = _readyCount + 1;
+            result = true;
+        }
+        if (!isInterrupt) {
+            __enable_irq();
+        }
+        return result;
+    }
+
+    /// Run the executor forever.
+    ///
+    [[noreturn]] void run() noexcept {
+        while (true) {
+            runOnce();
+            __disable_irq();
+            if (_readyCount == 0 && !isPollDue() && !isSleepDue()) {
+                // A pending interrupt wakes the CPU, even with disabled interrupts.
+                __WFI();
+            }
+            __enable_irq();
+        }
+    }
+
+    /// Resume all coroutines which are ready.
+    ///
+    void runOnce() noexcept {
+        resumeDue();
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                InterruptLock lock;
+                if (_readyCount == 0) {
+                    break;
+                }
+                handle = _ready[_readyHead];
+                _readyHead = (_readyHead + 1) % cReadySize;
+                _readyCount = _readyCount - 1;
+            }
+            handle.resume();
+        }
+    }
+
+public: // Awaitables
+    /// Wait for a delay.
+    ///
+    DelayAwaitable delay(Milliseconds delay) noexcept { return DelayAwaitable(*this, delay); }
+
+    /// Read register data from a device.
+    ///
+    /// @see WireMaster_SAMD21::readRegisterDataAsync
+    ///
+    WireAwaitable readRegisterData(WireMaster_SAMD21 &bus, uint8_t address, uint8_t registerAddress,
+        uint8_t *data, uint8_t count) noexcept {
+        return WireAwaitable(*this, bus, address, registerAddress, data, count, [](WireAwaitable &a) {
+            return a.bus.readRegisterDataAsync(a.address, a.registerAddress, a.data, a.count,
+                &WireAwaitable::onComplete, &a);
+        });
+    }
+
+    /// Write register data to a device.
+    ///
+    /// @see WireMaster_SAMD21::writeRegisterDataAsync
+    ///
+    WireAwaitable writeRegisterData(WireMaster_SAMD21 &bus, uint8_t address, uint8_t registerAddress,
+        const uint8_t *data, uint8_t count) noexcept {
+        return WireAwaitable(*this, bus, address, registerAddress, const_cast<uint8_t*>(data), count,
+            [](WireAwaitable &a) {
+            return a.bus.writeRegisterDataAsync(a.address, a.registerAddress, a.data, a.count,
+                &WireAwaitable::onComplete, &a);
+        });
+    }
+
+    /// Read bytes from a device.
+    ///
+    /// @see WireMaster_SAMD21::readBytesAsync
+    ///
+    WireAwaitable readBytes(WireMaster_SAMD21 &bus, uint8_t address, uint8_t *data, uint8_t count) noexcept {
+        return WireAwaitable(*this, bus, address, 0, data, count, [](WireAwaitable &a) {
+            return a.bus.readBytesAsync(a.address, a.data, a.count, &WireAwaitable::onComplete, &a);
+        });
+    }
+
+    /// Write bytes to a device.
+    ///
+    /// @see WireMaster_SAMD21::writeBytesAsync
+    ///
+    WireAwaitable writeBytes(WireMaster_SAMD21 &bus, uint8_t address, const uint8_t *data, uint8_t count) noexcept {
+        return WireAwaitable(*this, bus, address, 0, const_cast<uint8_t*>(data), count, [](WireAwaitable &a) {
+            return a.bus.writeBytesAsync(a.address, a.data, a.count, &WireAwaitable::onComplete, &a);
+        });
+    }
+
+    /// Send data to a serial line.
+    ///
+    SendAwaitable send(SerialLine &serialLine, const uint8_t *data, SerialLine::DataSize size) noexcept {
+        return SendAwaitable(*this, serialLine, data, size);
+    }
+
+private:
+    /// A sleeping coroutine.
+    ///
+    struct Sleep {
+        std::coroutine_handle<> handle; ///< The coroutine, or `nullptr` if the entry is free.
+        uint32_t wakeTick; ///< The tick to resume the coroutine.
+    };
+
+    /// A polling coroutine.
+    ///
+    struct Poll {
+        std::coroutine_handle<> handle; ///< The coroutine, or `nullptr` if the entry is free.
+        PollFunction function; ///< The function to check.
+        void *context; ///< The context for the function.
+    };
+
+private:
+    bool addSleep(std::coroutine_handle<> handle, Milliseconds delay) noexcept {
+        const uint32_t wakeTick = static_cast<uint32_t>(Timer::tickMilliseconds().ticks() + delay.ticks());
+        for (auto &entry : _sleeping) {
+            if (!entry.handle) {
+                entry.handle = handle;
+                entry.wakeTick = wakeTick;
+                return true;
+            }
+        }
+        return false; // No free entry, continue without delay.
+    }
+
+    bool addPoll(std::coroutine_handle<> handle, PollFunction function, void *context) noexcept {
+        for (auto &entry : _polling) {
+            if (!entry.handle) {
+                entry.handle = handle;
+                entry.function = function;
+                entry.context = context;
+                return true;
+            }
+        }
+        return false; // No free entry, continue directly.
+    }
+
+    bool isSleepDue() const noexcept {
+        const uint32_t now = static_cast<uint32_t>(Timer::tickMilliseconds().ticks());
+        for (const auto &entry : _sleeping) {
+            if (entry.handle && static_cast<int32_t>(now - entry.wakeTick) >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isPollDue() const noexcept {
+        for (const auto &entry : _polling) {
+            if (entry.handle && entry.function(entry.context)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void resumeDue() noexcept {
+        const uint32_t now = static_cast<uint32_t>(Timer::tickMilliseconds().ticks());
+        for (auto &entry : _sleeping) {
+            if (entry.handle && static_cast<int32_t>(now - entry.wakeTick) >= 0) {
+                const auto handle = entry.handle;
+                entry.handle = nullptr;
+                handle.resume();
+            }
+        }
+        for (auto &entry : _polling) {
+            if (entry.handle && entry.function(entry.context)) {
+                const auto handle = entry.handle;
+                entry.handle = nullptr;
+                handle.resume();
+            }
+        }
+    }
+
+private:
+    std::coroutine_handle<> _ready[cReadySize]; ///< The ready queue.
+    volatile uint8_t _readyHead; ///< The index of the next ready coroutine.
+    volatile uint8_t _readyCount; ///< The number of ready coroutines.
+    Sleep _sleeping[cSleepSize]; ///< The sleeping coroutines.
+    Poll _polling[cPollSize]; ///< The polling coroutines.
+};
+
+
+}
+
@@ -0,0 +1,182 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "Debouncer_SAMD21.hpp"
+
+
+#include "VerticalDebouncer.hpp"
+
+#include "hal-core/Chip.hpp"
+#include "hal-common/InterruptLock.hpp"
+
+
+namespace lr::Debouncer {
+
+
+namespace {
+
+
+/// The debounce state of a port group.
+///
+struct GroupState {
+    uint32_t mask; ///< The debounced inputs.
+    uint32_t activeLowMask; ///< The inputs which are active low.
+    VerticalDebouncer debouncer; ///< The vertical counters.
+    uint32_t pressToggle; ///< The press toggle mask.
+    uint32_t releaseToggle; ///< The release toggle mask.
+};
+
+/// The debounce state for both port groups, only used in the SysTick handler or with a lock.
+///
+GroupState gGroups[2] = {};
+
+/// The number of ticks between two samples.
+///
+uint8_t gSampleDivider = 1;
+
+/// The tick counter for the sample divider.
+///
+uint8_t gSampleCounter = 0;
+
+/// The sequence number of the published snapshot, odd while it is written.
+///
+volatile uint32_t gSequence = 0;
+
+/// The published state.
+///
+volatile uint32_t gState[2] = {};
+
+/// The published press toggle masks.
+///
+volatile uint32_t gPressToggle[2] = {};
+
+/// The published release toggle masks.
+///
+volatile uint32_t gReleaseToggle[2] = {};
+
+
+/// Sample the inputs of a port group.
+///
+inline uint32_t sampleGroup(uint8_t groupIndex) {
+    const auto &group = gGroups[groupIndex];
+    return (chip::gPort->Group[groupIndex].IN.reg ^ group.activeLowMask) & group.mask;
+}
+
+/// Publish the current state.
+///
+/// Must be called from the SysTick handler or with disabled interrupts.
+///
+void publish() {
+    gSequence = gSequence + 1;
+    for (uint8_t i = 0; i < 2; ++i) {
+        gState[i] = gGroups[i].debouncer.getState();
+        gPressToggle[i] = gGroups[i].pressToggle;
+        gReleaseToggle[i] = gGroups[i].releaseToggle;
+    }
+    gSequence = gSequence + 1;
+}
+
+
+}
+
+
+void setInputs(GPIO::Group group, uint32_t mask, uint32_t activeLowMask)
+{
+    const auto groupIndex = static_cast<uint8_t>(group);
+    InterruptLock lock;
+    auto &state = gGroups[groupIndex];
+    state.mask = mask;
+    state.activeLowMask = activeLowMask;
+    state.debouncer = VerticalDebouncer(sampleGroup(groupIndex));
+    publish();
+}
+
+
+void setSampleDivider(uint8_t divider)
+{
+    InterruptLock lock;
+    gSampleDivider = (divider > 0 ? divider : 1);
+    gSampleCounter = 0;
+}
+
+
+Snapshot getSnapshot()
+{
+    Snapshot snapshot;
+    uint32_t sequence;
+    do {
+        sequence = gSequence;
+        for (uint8_t i = 0; i < 2; ++i) {
+            snapshot.state[i] = gState[i];
+            snapshot.pressToggle[i] = gPressToggle[i];
+            snapshot.releaseToggle[i] = gReleaseToggle[i];
+        }
+    } while ((sequence & 1u) != 0 || sequence != gSequence);
+    snapshot.sequence = sequence;
+    return snapshot;
+}
+
+
+void debounceTick()
+{
+    if ((gGroups[0].mask | gGroups[1].mask) == 0) {
+        return;
+    }
+    if (++gSampleCounter < gSampleDivider) {
+        return;
+    }
+    gSampleCounter = 0;
+    bool hasChanges = false;
+    for (uint8_t i = 0; i < 2; ++i) {
+        auto &group = gGroups[i];
+        if (group.mask == 0) {
+            continue;
+        }
+        const auto changed = group.debouncer.update(sampleGroup(i));
+        if (changed != 0) {
+            const auto state = group.debouncer.getState();
+            group.pressToggle ^= (changed & state);
+            group.releaseToggle ^= (changed & ~state);
+            hasChanges = true;
+        }
+    }
+    if (hasChanges) {
+        publish();
+    }
+}
+
+
+EventReader::EventReader()
+    : _snapshot(getSnapshot()), _pressed(), _released()
+{
+}
+
+
+void EventReader::update()
+{
+    const auto snapshot = getSnapshot();
+    for (uint8_t i = 0; i < 2; ++i) {
+        _pressed[i] = snapshot.pressToggle[i] ^ _snapshot.pressToggle[i];
+        _released[i] = snapshot.releaseToggle[i] ^ _snapshot.releaseToggle[i];
+    }
+    _snapshot = snapshot;
+}
+
+
+}
+
@@ -0,0 +1,160 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "GPIO_SAMD21.hpp"
+
+#include <cstdint>
+
+
+/// A debouncer for up to 64 inputs, sampled from the SysTick handler.
+///
+/// All selected inputs of both port groups are sampled with one read of the `IN` register
+/// for each group, and debounced at once with vertical counters (see `VerticalDebouncer`).
+/// An input changes its state after four consecutive equal samples, so with the default
+/// sample divider of one, after four milliseconds.
+///
+/// The state and the press/release events are published in a snapshot, which is read
+/// without disabling interrupts. Use `EventReader` to get the events since the last read.
+///
+/// Example:
+/// ```
+/// Debouncer::setInputs(GPIO::Group::A, GPIO::getMask(GPIO::Port::PA16, GPIO::Port::PA17), ~0u);
+/// Debouncer::EventReader events;
+/// // ...
+/// events.update();
+/// if (events.isPressed(GPIO::Port::PA16)) { ... }
+/// ```
+///
+namespace lr::Debouncer {
+
+
+/// A consistent snapshot of the debounced inputs.
+///
+/// Press and release events are published as toggle masks: each event of an input toggles
+/// its bit. Comparing two snapshots reveals the inputs with an event in between, as long as
+/// an input has at most one press and one release between the two snapshots.
+///
+struct Snapshot {
+    uint32_t sequence; ///< The sequence number, incremented for each change.
+    uint32_t state[2]; ///< The debounced state for each port group, 1 = active.
+    uint32_t pressToggle[2]; ///< The press toggle masks for each port group.
+    uint32_t releaseToggle[2]; ///< The release toggle masks for each port group.
+};
+
+
+/// Select the inputs of a port group to debounce.
+///
+/// The debounced state of the inputs starts with the current input, without events.
+/// The inputs have to be configured as inputs before.
+///
+/// @param group The port group.
+/// @param mask The mask of the inputs to debounce, or zero to stop debouncing the port group.
+/// @param activeLowMask The mask of the inputs which are active low, e.g. buttons to ground.
+///
+void setInputs(GPIO::Group group, uint32_t mask, uint32_t activeLowMask = 0);
+
+/// Set the sample divider.
+///
+/// @param divider The number of SysTick ticks between two samples, in the range 1-255.
+///     Each input changes its state after four samples.
+///
+void setSampleDivider(uint8_t divider);
+
+/// Get a snapshot of the debounced inputs.
+///
+/// This function does not disable interrupts. It repeats reading the published values,
+/// until they were not changed by the SysTick handler while reading.
+///
+/// @return The snapshot.
+///
+Snapshot getSnapshot();
+
+/// Sample and debounce the inputs.
+///
+/// This function is called from the SysTick handler in `Timer.cpp`.
+///
+void debounceTick();
+
+
+/// A reader for the press and release events.
+///
+class EventReader
+{
+public:
+    /// Create a new event reader.
+    ///
+    /// Events before the creation are ignored.
+    ///
+    EventReader();
+
+public:
+    /// Read the current snapshot and get the events since the last update.
+    ///
+    /// An input needs eight samples for a press and a release. Call this method more often
+    /// than every eight samples, or a press, release and press between two calls cancel out.
+    ///
+    void update();
+
+    /// Get the debounced state of a port group.
+    ///
+    inline uint32_t getState(GPIO::Group group) const {
+        return _snapshot.state[static_cast<uint8_t>(group)];
+    }
+
+    /// Get the inputs of a port group which were pressed before the last update.
+    ///
+    inline uint32_t getPressed(GPIO::Group group) const {
+        return _pressed[static_cast<uint8_t>(group)];
+    }
+
+    /// Get the inputs of a port group which were released before the last update.
+    ///
+    inline uint32_t getReleased(GPIO::Group group) const {
+        return _released[static_cast<uint8_t>(group)];
+    }
+
+    /// Check if an input is active.
+    ///
+    inline bool isActive(GPIO::Port port) const {
+        return (getState(GPIO::getGroup(port)) & GPIO::getMask(port)) != 0;
+    }
+
+    /// Check if an input was pressed before the last update.
+    ///
+    inline bool isPressed(GPIO::Port port) const {
+        return (getPressed(GPIO::getGroup(port)) & GPIO::getMask(port)) != 0;
+    }
+
+    /// Check if an input was released before the last update.
+    ///
+    inline bool isReleased(GPIO::Port port) const {
+        return (getReleased(GPIO::getGroup(port)) & GPIO::getMask(port)) != 0;
+    }
+
+private:
+    Snapshot _snapshot; ///< The last snapshot.
+    uint32_t _pressed[2]; ///< The pressed inputs since the previous snapshot.
+    uint32_t _released[2]; ///< The released inputs since the previous snapshot.
+};
+
+
+}
+
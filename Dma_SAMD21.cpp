@@ -0,0 +1,173 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Dma_SAMD21.hpp"
+
+
+#include "SpinDeadline_SAMD21.hpp"
+
+#include "hal-common/InterruptLock.hpp"
+
+
+namespace lr::Dma {
+
+
+namespace {
+
+
+/// The descriptor table with the first descriptor of each channel.
+///
+__attribute__((aligned(16)))
+DmacDescriptor gDescriptors[cChannelCount] = {};
+
+/// The write back table for the active descriptors.
+///
+__attribute__((aligned(16)))
+DmacDescriptor gWriteBack[cChannelCount] = {};
+
+
+/// One registered channel callback.
+///
+struct Entry {
+    Callback callback; ///< The callback or `nullptr`.
+    void *context; ///< The context for the callback.
+};
+
+/// The callbacks for all channels.
+///
+Entry gEntries[cChannelCount] = {};
+
+/// Flag if the controller is initialized.
+///
+bool gInitialized = false;
+
+
+}
+
+
+bool initialize()
+{
+    if (gInitialized) {
+        return true;
+    }
+    // Enable the clocks for the DMA controller.
+    PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+    PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+    // Reset the controller.
+    DMAC->CTRL.reg = 0;
+    DMAC->CTRL.reg = DMAC_CTRL_SWRST;
+    SpinDeadline resetTimer(10_ms);
+    while (DMAC->CTRL.bit.SWRST) {
+        if (resetTimer.hasTimeout()) {
+            return false;
+        }
+    }
+    // Set the descriptor tables.
+    DMAC->BASEADDR.reg = reinterpret_cast<uintptr_t>(gDescriptors);
+    DMAC->WRBADDR.reg = reinterpret_cast<uintptr_t>(gWriteBack);
+    // Enable the controller with all priority levels.
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE|DMAC_CTRL_LVLEN(0xf);
+    NVIC_EnableIRQ(DMAC_IRQn);
+    gInitialized = true;
+    return true;
+}
+
+
+DmacDescriptor& getDescriptor(const uint8_t channel)
+{
+    return gDescriptors[channel];
+}
+
+
+void prepareDescriptor(DmacDescriptor &descriptor,
+    const volatile void *source, const bool sourceIncrement,
+    volatile void *destination, const bool destinationIncrement,
+    const uint16_t count, DmacDescriptor *next)
+{
+    uint16_t control = DMAC_BTCTRL_VALID|DMAC_BTCTRL_BEATSIZE_BYTE;
+    control |= (next == nullptr) ? DMAC_BTCTRL_BLOCKACT_INT : DMAC_BTCTRL_BLOCKACT_NOACT;
+    // With increment, the DMAC expects the address after the last byte.
+    auto sourceAddress = reinterpret_cast<uintptr_t>(source);
+    if (sourceIncrement) {
+        control |= DMAC_BTCTRL_SRCINC;
+        sourceAddress += count;
+    }
+    auto destinationAddress = reinterpret_cast<uintptr_t>(destination);
+    if (destinationIncrement) {
+        control |= DMAC_BTCTRL_DSTINC;
+        destinationAddress += count;
+    }
+    descriptor.BTCTRL.reg = control;
+    descriptor.BTCNT.reg = count;
+    descriptor.SRCADDR.reg = sourceAddress;
+    descriptor.DSTADDR.reg = destinationAddress;
+    descriptor.DESCADDR.reg = reinterpret_cast<uintptr_t>(next);
+}
+
+
+bool startTransfer(const uint8_t channel, const uint8_t trigger, const Callback callback, void *context)
+{
+    InterruptLock lock;
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    DMAC->CHCTRLA.reg = 0;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+    SpinDeadline resetTimer(1_ms);
+    while (DMAC->CHCTRLA.bit.SWRST) {
+        if (resetTimer.hasTimeout()) {
+            return false;
+        }
+    }
+    gEntries[channel].callback = callback;
+    gEntries[channel].context = context;
+    DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0)|DMAC_CHCTRLB_TRIGSRC(trigger)|DMAC_CHCTRLB_TRIGACT_BEAT;
+    DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL|DMAC_CHINTENSET_TERR;
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    return true;
+}
+
+
+void abortTransfer(const uint8_t channel)
+{
+    InterruptLock lock;
+    DMAC->CHID.reg = DMAC_CHID_ID(channel);
+    DMAC->CHCTRLA.reg = 0;
+    DMAC->CHINTENCLR.reg = DMAC_CHINTENCLR_TCMPL|DMAC_CHINTENCLR_TERR;
+    DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL|DMAC_CHINTFLAG_TERR;
+    gEntries[channel].callback = nullptr;
+}
+
+
+}
+
+
+/// The DMAC interrupt handler.
+///
+void DMAC_Handler()
+{
+    using namespace lr::Dma;
+    while (DMAC->INTSTATUS.reg != 0) {
+        const uint8_t channel = DMAC->INTPEND.bit.ID;
+        DMAC->CHID.reg = DMAC_CHID_ID(channel);
+        const uint8_t flags = DMAC->CHINTFLAG.reg;
+        DMAC->CHINTFLAG.reg = flags;
+        const auto &entry = gEntries[channel];
+        if (entry.callback != nullptr) {
+            entry.callback(entry.context, (flags & DMAC_CHINTFLAG_TERR) == 0);
+        }
+    }
+}
+
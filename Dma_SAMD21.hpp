@@ -0,0 +1,115 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "hal-core/Chip.hpp"
+
+#include <cstdint>
+
+
+namespace lr::Dma {
+
+
+/// The number of DMA channels on the chip.
+///
+constexpr uint8_t cChannelCount = 12;
+
+
+/// The callback for a finished transfer.
+///
+/// This callback is called from the DMAC interrupt handler.
+///
+/// @param context The context pointer passed to `startTransfer`.
+/// @param success `true` if the transfer completed, `false` on a transfer error.
+///
+using Callback = void(*)(void *context, bool success);
+
+
+/// Get the trigger source for the receive of a SERCOM interface.
+///
+constexpr uint8_t getSercomRxTrigger(uint8_t sercomIndex) {
+    return static_cast<uint8_t>(0x01u + (sercomIndex * 2u));
+}
+
+/// Get the trigger source for the transmit of a SERCOM interface.
+///
+constexpr uint8_t getSercomTxTrigger(uint8_t sercomIndex) {
+    return static_cast<uint8_t>(0x02u + (sercomIndex * 2u));
+}
+
+
+/// Initialize the DMA controller.
+///
+/// Enables the clocks, sets the descriptor tables and enables the controller.
+/// Multiple calls of this function do no harm.
+///
+/// @return `true` on success, `false` if the reset of the controller did not finish.
+///
+bool initialize();
+
+/// Access the first descriptor of a channel.
+///
+/// @param channel The channel index.
+/// @return The descriptor in the descriptor table.
+///
+DmacDescriptor& getDescriptor(uint8_t channel);
+
+/// Prepare a byte-wise transfer descriptor.
+///
+/// This function only writes to the given descriptor, it does not access the hardware.
+/// If `next` is `nullptr` the descriptor is the last in the chain and will raise the
+/// transfer complete interrupt.
+///
+/// @param descriptor The descriptor to prepare.
+/// @param source The start address of the source.
+/// @param sourceIncrement If the source address is incremented for each byte.
+/// @param destination The start address of the destination.
+/// @param destinationIncrement If the destination address is incremented for each byte.
+/// @param count The number of bytes to transfer.
+/// @param next The next descriptor in the chain, or `nullptr`.
+///
+void prepareDescriptor(DmacDescriptor &descriptor,
+    const volatile void *source, bool sourceIncrement,
+    volatile void *destination, bool destinationIncrement,
+    uint16_t count, DmacDescriptor *next = nullptr);
+
+/// Start a transfer on a channel.
+///
+/// The descriptor for the channel must be prepared before this call.
+/// Every trigger moves one byte.
+///
+/// @param channel The channel index.
+/// @param trigger The trigger source for the channel.
+/// @param callback The callback called if the transfer is finished.
+/// @param context A context pointer passed to the callback.
+/// @return `true` if the transfer was started, `false` if the reset of the channel did not finish.
+///
+bool startTransfer(uint8_t channel, uint8_t trigger, Callback callback, void *context);
+
+/// Abort a running transfer on a channel.
+///
+/// The callback is not called.
+///
+/// @param channel The channel index.
+///
+void abortTransfer(uint8_t channel);
+
+
+}
+
@@ -0,0 +1,266 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "GPIO_Pin_SAMD21.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+
+namespace lr::GPIO {
+
+
+/// A group of pins, accessed with as few register writes as possible.
+///
+/// The masks of the pins are combined at compile time for each port group. Setting,
+/// clearing or toggling all pins is a single write for each used port group. Writing a
+/// value is one `OUTSET` and one `OUTCLR` write for each used port group, without reading
+/// the output register. Between the two writes, the pins which go high are already set while
+/// the pins which go low are still high. If this glitch matters, e.g. for a parallel bus with
+/// a strobe on another pin, use `writeGlitchFree()`.
+///
+/// The order of the pins is the bit-spread table: bit 0 of a value is written to the first
+/// pin, bit 1 to the second pin, and so on. So the pins can be anywhere on the ports. If all
+/// pins are consecutive pins of one port in ascending order, a value is just shifted into
+/// place. Otherwise the bits are spread with precomputed masks, or with `writeFromTable()`
+/// using a lookup table.
+///
+/// Example:
+/// `using DataBus = PinGroup<PinPA16, PinPA17, PinPA18, PinPA19>; DataBus::write(0x0a);`
+///
+/// @tparam Pins The pins of the group, all with the same `PortBus`.
+///
+template<typename... Pins>
+class PinGroup
+{
+    static_assert(sizeof...(Pins) > 0 && sizeof...(Pins) <= 32, "A pin group needs 1-32 pins.");
+
+public:
+    /// The number of pins in this group.
+    ///
+    constexpr static const uint8_t cPinCount = sizeof...(Pins);
+
+    /// The bus used to access the pins.
+    ///
+    constexpr static const PortBus cBus = std::initializer_list<PortBus>{Pins::cBus...}.begin()[0];
+
+    static_assert(((Pins::cBus == cBus) && ...), "All pins of a group must use the same bus.");
+
+    /// Get the mask of all pins of this group in a port group.
+    ///
+    constexpr static uint32_t getPortMask(uint8_t portIndex) {
+        return ((Pins::cPortIndex == portIndex ? Pins::cMask : 0u) | ...);
+    }
+
+    /// Convert a value to the output mask for a port group.
+    ///
+    /// @param portIndex The index of the port group.
+    /// @param value The value, bit 0 for the first pin.
+    /// @return The mask with the bits set for all pins which are set in the value.
+    ///
+    constexpr static uint32_t spreadValue(uint8_t portIndex, uint32_t value) {
+        if (isShiftable(portIndex)) {
+            return (value << getFirstBit()) & getPortMask(portIndex);
+        }
+        return spreadBits(portIndex, value, std::make_index_sequence<cPinCount>());
+    }
+
+public:
+    /// Configure all pins as outputs.
+    ///
+    inline static void configureAsOutput() {
+        (Pins::configureAsOutput(), ...);
+    }
+
+    /// Configure all pins as inputs.
+    ///
+    inline static void configureAsInput(Pull pull = Pull::None) {
+        (Pins::configureAsInput(pull), ...);
+    }
+
+    /// Set all outputs to high.
+    ///
+    inline static void setOutputHigh() {
+        writeRegister<0>(&PortGroup::OUTSET, getPortMask(0));
+        writeRegister<1>(&PortGroup::OUTSET, getPortMask(1));
+    }
+
+    /// Set all outputs to low.
+    ///
+    inline static void setOutputLow() {
+        writeRegister<0>(&PortGroup::OUTCLR, getPortMask(0));
+        writeRegister<1>(&PortGroup::OUTCLR, getPortMask(1));
+    }
+
+    /// Toggle all outputs.
+    ///
+    inline static void toggleOutput() {
+        writeRegister<0>(&PortGroup::OUTTGL, getPortMask(0));
+        writeRegister<1>(&PortGroup::OUTTGL, getPortMask(1));
+    }
+
+    /// Write a value to the outputs.
+    ///
+    /// @param value The value, bit 0 is written to the first pin.
+    ///
+    inline static void write(uint32_t value) {
+        writeValue<0>(spreadValue(0, value));
+        writeValue<1>(spreadValue(1, value));
+    }
+
+    /// Write a value to the outputs, changing all pins of a port group at once.
+    ///
+    /// Reads `OUT` and writes the changed bits with a single `OUTTGL` store for each used port
+    /// group. This is a read-modify-write: if an interrupt changes pins of this group between
+    /// the read and the store, these changes are toggled back. Only use it if no interrupt
+    /// writes to the pins of the group.
+    ///
+    /// @param value The value, bit 0 is written to the first pin.
+    ///
+    inline static void writeGlitchFree(uint32_t value) {
+        toggleChangedBits<0>(spreadValue(0, value));
+        toggleChangedBits<1>(spreadValue(1, value));
+    }
+
+    /// Write a value to the outputs, using a lookup table.
+    ///
+    /// The table with one entry for each value is created at compile time and stored in flash,
+    /// but only if this method is used. It is only available for groups of up to eight pins.
+    ///
+    /// @param value The value, bit 0 is written to the first pin.
+    ///
+    inline static void writeFromTable(uint8_t value) {
+        static_assert(cPinCount <= 8, "The lookup table is only available for groups of up to 8 pins.");
+        const auto &entry = cSpreadTable.values[value & ((1u << cPinCount) - 1u)];
+        writeValue<0>(entry[0]);
+        writeValue<1>(entry[1]);
+    }
+
+    /// Read the inputs.
+    ///
+    /// @return The value, bit 0 is the input of the first pin.
+    ///
+    inline static uint32_t read() {
+        return gatherBits(getPort<0>().IN.reg, getPort<1>().IN.reg, std::make_index_sequence<cPinCount>());
+    }
+
+private:
+    /// The lookup table for the spread values.
+    ///
+    struct SpreadTable {
+        uint32_t values[1u << (cPinCount <= 8 ? cPinCount : 0)][2]; ///< The masks for both port groups.
+    };
+
+    /// Create the lookup table.
+    ///
+    constexpr static SpreadTable createSpreadTable() {
+        SpreadTable table = {};
+        for (uint32_t value = 0; value < (1u << (cPinCount <= 8 ? cPinCount : 0)); ++value) {
+            table.values[value][0] = spreadValue(0, value);
+            table.values[value][1] = spreadValue(1, value);
+        }
+        return table;
+    }
+
+    /// The lookup table, only created if used.
+    ///
+    inline constexpr static SpreadTable cSpreadTable = createSpreadTable();
+
+    /// Get the pin index of the first pin.
+    ///
+    constexpr static uint8_t getFirstBit() {
+        return static_cast<uint8_t>(std::initializer_list<uint8_t>{Pins::cPinIndex...}.begin()[0] & 0b11111u);
+    }
+
+    /// Check if all pins are consecutive pins of one port group in ascending order.
+    ///
+    constexpr static bool isShiftable(uint8_t portIndex) {
+        constexpr uint8_t indexes[] = {Pins::cPinIndex...};
+        for (uint8_t i = 0; i < cPinCount; ++i) {
+            if ((indexes[i] >> 5u) != portIndex || indexes[i] != indexes[0] + i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Spread the bits of a value to the pin masks.
+    ///
+    template<std::size_t... bits>
+    constexpr static uint32_t spreadBits(uint8_t portIndex, uint32_t value, std::index_sequence<bits...>) {
+        return (((Pins::cPortIndex == portIndex && (value & (static_cast<uint32_t>(1) << bits)) != 0)
+            ? Pins::cMask : 0u) | ...);
+    }
+
+    /// Gather the input bits from the port groups.
+    ///
+    template<std::size_t... bits>
+    inline static uint32_t gatherBits(uint32_t input0, uint32_t input1, std::index_sequence<bits...>) {
+        return ((((Pins::cPortIndex == 0 ? input0 : input1) & Pins::cMask) != 0
+            ? (static_cast<uint32_t>(1) << bits) : 0u) | ...);
+    }
+
+    /// Access a port group.
+    ///
+    template<uint8_t portIndex>
+    inline static PortGroup& getPort() {
+        if constexpr (cBus == PortBus::IoBus) {
+            return chip::getPortIoBus()->Group[portIndex];
+        } else {
+            return chip::gPort->Group[portIndex];
+        }
+    }
+
+    /// Write a mask to a register of a port group, if this group uses the port group.
+    ///
+    template<uint8_t portIndex, typename Register>
+    inline static void writeRegister(Register PortGroup::*reg, uint32_t mask) {
+        if constexpr (getPortMask(portIndex) != 0) {
+            (getPort<portIndex>().*reg).reg = mask;
+        }
+    }
+
+    /// Write the spread value to a port group, if this group uses the port group.
+    ///
+    template<uint8_t portIndex>
+    inline static void writeValue(uint32_t setMask) {
+        if constexpr (getPortMask(portIndex) != 0) {
+            auto &port = getPort<portIndex>();
+            port.OUTSET.reg = setMask;
+            port.OUTCLR.reg = getPortMask(portIndex) & ~setMask;
+        }
+    }
+
+    /// Toggle the bits which differ from the spread value, if this group uses the port group.
+    ///
+    template<uint8_t portIndex>
+    inline static void toggleChangedBits(uint32_t setMask) {
+        if constexpr (getPortMask(portIndex) != 0) {
+            auto &port = getPort<portIndex>();
+            port.OUTTGL.reg = (port.OUT.reg ^ setMask) & getPortMask(portIndex);
+        }
+    }
+};
+
+
+}
+
@@ -45,6 +45,29 @@ using Pin11     = PinPA16;
 using Pin12     = PinPA19;
 using Pin13     = PinPA17;
 
+/// The pins using the single-cycle IOBUS.
+///
+using PinA0Fast     = PinA0::IoBus;
+using PinA1Fast     = PinA1::IoBus;
+using PinA2Fast     = PinA2::IoBus;
+using PinA3Fast     = PinA3::IoBus;
+using PinA4Fast     = PinA4::IoBus;
+using PinA5Fast     = PinA5::IoBus;
+using PinSCKFast    = PinSCK::IoBus;
+using PinMOSIFast   = PinMOSI::IoBus;
+using PinMISOFast   = PinMISO::IoBus;
+using PinRXFast     = PinRX::IoBus;
+using PinTXFast     = PinTX::IoBus;
+using PinSDAFast    = PinSDA::IoBus;
+using PinSCLFast    = PinSCL::IoBus;
+using Pin5Fast      = Pin5::IoBus;
+using Pin6Fast      = Pin6::IoBus;
+using Pin9Fast      = Pin9::IoBus;
+using Pin10Fast     = Pin10::IoBus;
+using Pin11Fast     = Pin11::IoBus;
+using Pin12Fast     = Pin12::IoBus;
+using Pin13Fast     = Pin13::IoBus;
+
 
 }
 
@@ -25,9 +25,32 @@
 #include "hal-common/GPIO.hpp"
 
 
+namespace lr::chip {
+
+
+/// Access the PORT registers through the single-cycle IOBUS.
+///
+/// This is declared outside of `lr::GPIO`, where the name `Port` refers to the port enumeration.
+///
+inline Port* getPortIoBus() {
+    return PORT_IOBUS;
+}
+
+
+}
+
+
 namespace lr::GPIO {
 
 
+/// The bus used to access the PORT registers.
+///
+enum class PortBus : uint8_t {
+    Apb, ///< The peripheral bus (APB), with wait states.
+    IoBus, ///< The single-cycle IOBUS of the Cortex-M0+.
+};
+
+
 /// The base class for static pin access.
 ///
 /// Do not use this class directly, but the predefined names `PinXXX`. This is a pure static
@@ -37,11 +60,43 @@ namespace lr::GPIO {
 /// Using this classes will result in non portable code which may have to be adapted for a new
 /// platform.
 ///
+/// The output and direction registers can be accessed through the single-cycle IOBUS of the
+/// Cortex-M0+, using the `IoBus` variant of each pin, e.g. `PinPA17::IoBus::toggleOutput()`.
+/// A write through the APB bridge takes several cycles, a write through the IOBUS a single one.
+/// The pin configuration always uses the APB bridge. To read the input through the IOBUS
+/// without delay, enable continuous sampling for the pin.
+///
 /// @tparam index The index of the used pin.
+/// @tparam bus The bus to access the output, direction and input registers.
 ///
-template<uint8_t pinIndex>
+template<uint8_t pinIndex, PortBus bus = PortBus::Apb>
 class PinBase
 {
+public:
+    /// The variant of this pin using the single-cycle IOBUS.
+    ///
+    using IoBus = PinBase<pinIndex, PortBus::IoBus>;
+
+    /// The variant of this pin using the APB bridge.
+    ///
+    using Apb = PinBase<pinIndex, PortBus::Apb>;
+
+    /// The pin index, 0x00-0x3f.
+    ///
+    constexpr static const uint8_t cPinIndex = pinIndex;
+
+    /// The index of the port group of this pin.
+    ///
+    constexpr static const uint8_t cPortIndex = static_cast<uint8_t>(pinIndex >> 5u);
+
+    /// The mask of this pin in its port group.
+    ///
+    constexpr static const uint32_t cMask = static_cast<uint32_t>(1) << (pinIndex & 0b11111u);
+
+    /// The bus used to access this pin.
+    ///
+    constexpr static const PortBus cBus = bus;
+
 private:
     /// Access the port for this pin.
     ///
@@ -49,6 +104,16 @@ private:
         return chip::gPort->Group[pinIndex >> 5u];
     }
 
+    /// Access the port for the output, direction and input registers of this pin.
+    ///
+    inline static PortGroup& getDataPort() {
+        if constexpr (bus == PortBus::IoBus) {
+            return chip::getPortIoBus()->Group[pinIndex >> 5u];
+        } else {
+            return getPort();
+        }
+    }
+
     /// The pin index in the selected port.
     ///
     constexpr static const uint8_t _index = static_cast<uint8_t>(pinIndex & 0b11111u);
@@ -64,15 +129,15 @@ public:
     ///
     inline static void configureAsInput(Pull pull = Pull::None) {
         auto &port = getPort();
-        port.DIRCLR.reg = _mask;
+        getDataPort().DIRCLR.reg = _mask;
         switch (pull) {
             case Pull::Up:
                 port.PINCFG[_index].reg |= (PORT_PINCFG_INEN|PORT_PINCFG_PULLEN);
-                port.OUTSET.reg = _mask;
+                getDataPort().OUTSET.reg = _mask;
                 break;
             case Pull::Down:
                 port.PINCFG[_index].reg |= (PORT_PINCFG_INEN|PORT_PINCFG_PULLEN);
-                port.OUTCLR.reg = _mask;
+                getDataPort().OUTCLR.reg = _mask;
                 break;
             default:
                 port.PINCFG[_index].bit.INEN = 1;
@@ -85,7 +150,7 @@ public:
     ///
     inline static void configureAsOutput() {
         auto &port = getPort();
-        port.DIRSET.reg = _mask;
+        getDataPort().DIRSET.reg = _mask;
         port.PINCFG[_index].reg &= ~(PORT_PINCFG_INEN|PORT_PINCFG_PULLEN);
     }
 
@@ -93,36 +158,36 @@ public:
     ///
     inline static void configureAsHighImpendance() {
         auto &port = getPort();
-        port.OUTCLR.reg = _mask;
-        port.DIRCLR.reg = _mask;
+        getDataPort().OUTCLR.reg = _mask;
+        getDataPort().DIRCLR.reg = _mask;
         port.PINCFG[_index].reg &= ~(PORT_PINCFG_INEN|PORT_PINCFG_PULLEN);
     }
 
     /// Set the output to low.
     ///
     inline static void setOutputLow() {
-        auto &port = getPort();
+        auto &port = getDataPort();
         port.OUTCLR.reg = _mask;
     }
 
     /// Set the output to high.
     ///
     inline static void setOutputHigh() {
-        auto &port = getPort();
+        auto &port = getDataPort();
         port.OUTSET.reg = _mask;
     }
 
     /// Toggle the output.
     ///
     inline static void toggleOutput() {
-        auto &port = getPort();
+        auto &port = getDataPort();
         port.OUTTGL.reg = _mask;
     }
 
     /// Read the input.
     ///
     inline static bool getInput() {
-        auto &port = getPort();
+        auto &port = getDataPort();
         return (port.IN.reg & _mask) != 0;
     }
 };
@@ -19,11 +19,58 @@
 
 
 #include "hal-core/Chip.hpp"
+#include "hal-common/InterruptLock.hpp"
 
 
 namespace lr::GPIO {
 
 
+namespace {
+
+
+/// Create the value for the `WRCONFIG` register.
+///
+/// @param halfMask The mask of the pins in the selected half of the port group.
+/// @param isUpperHalf If the pins are in the upper half (16-31) of the port group.
+/// @param mode The mode for the pins.
+/// @param pull The pull for the pins.
+/// @param function The function for the pins.
+/// @return The value for the `WRCONFIG` register.
+///
+constexpr uint32_t getWriteConfig(uint16_t halfMask, bool isUpperHalf, Mode mode, Pull pull, Function function)
+{
+    uint32_t value = PORT_WRCONFIG_WRPINCFG | PORT_WRCONFIG_PINMASK(halfMask);
+    if (isUpperHalf) {
+        value |= PORT_WRCONFIG_HWSEL;
+    }
+    if (mode == Mode::Input) {
+        value |= PORT_WRCONFIG_INEN;
+        if (pull != Pull::None) {
+            value |= PORT_WRCONFIG_PULLEN;
+        }
+    }
+    if (function != Function::Disabled) {
+        value |= PORT_WRCONFIG_WRPMUX | PORT_WRCONFIG_PMUXEN | PORT_WRCONFIG_PMUX(static_cast<uint8_t>(function));
+    }
+    return value;
+}
+
+static_assert(getWriteConfig(0x0003, false, Mode::Input, Pull::Up, Function::Disabled) == 0x40060003u);
+static_assert(getWriteConfig(0x0003, false, Mode::Input, Pull::None, Function::Disabled) == 0x40020003u);
+static_assert(getWriteConfig(0x0c00, true, Mode::Low, Pull::Up, Function::Sercom) == 0xd2010c00u);
+static_assert(getWriteConfig(0x8000, false, Mode::HighImpendance, Pull::None, Function::Disabled) == 0x40008000u);
+
+
+/// The pins with enabled continuous sampling, for each port group.
+///
+/// The `CTRL` register is write-only, therefore the enabled pins are kept here.
+///
+uint32_t gContinuousSampling[2] = {0, 0};
+
+
+}
+
+
 Status initialize()
 {
     // Nothing to initialize.
@@ -84,7 +131,73 @@ bool getState(PinNumber pin)
     return (port.IN.reg&mask) != 0;
 }
 
-    
+
+Status configurePins(Group group, uint32_t mask, Mode mode, Pull pull, Function function)
+{
+    auto &port = chip::gPort->Group[static_cast<uint8_t>(group)];
+    // Prepare the direction and output, so outputs start with the right level.
+    switch (mode) {
+    case Mode::Input:
+        port.DIRCLR.reg = mask;
+        if (pull == Pull::Up) {
+            port.OUTSET.reg = mask;
+        } else if (pull == Pull::Down) {
+            port.OUTCLR.reg = mask;
+        }
+        break;
+    case Mode::HighImpendance:
+        port.DIRCLR.reg = mask;
+        port.OUTCLR.reg = mask;
+        break;
+    case Mode::High:
+        port.OUTSET.reg = mask;
+        break;
+    case Mode::Low:
+        port.OUTCLR.reg = mask;
+        break;
+    default:
+        return Status::Error;
+    }
+    // Write the pin configuration and multiplexing, up to 16 pins at once.
+    const auto lowerMask = static_cast<uint16_t>(mask & 0xffffu);
+    const auto upperMask = static_cast<uint16_t>(mask >> 16u);
+    if (lowerMask != 0) {
+        port.WRCONFIG.reg = getWriteConfig(lowerMask, false, mode, pull, function);
+    }
+    if (upperMask != 0) {
+        port.WRCONFIG.reg = getWriteConfig(upperMask, true, mode, pull, function);
+    }
+    if (mode == Mode::High || mode == Mode::Low) {
+        port.DIRSET.reg = mask;
+    }
+    return Status::Success;
+}
+
+
+void enableContinuousSampling(Group group, uint32_t mask)
+{
+    const auto groupIndex = static_cast<uint8_t>(group);
+    InterruptLock lock;
+    gContinuousSampling[groupIndex] |= mask;
+    chip::gPort->Group[groupIndex].CTRL.reg = gContinuousSampling[groupIndex];
+}
+
+
+void disableContinuousSampling(Group group, uint32_t mask)
+{
+    const auto groupIndex = static_cast<uint8_t>(group);
+    InterruptLock lock;
+    gContinuousSampling[groupIndex] &= ~mask;
+    chip::gPort->Group[groupIndex].CTRL.reg = gContinuousSampling[groupIndex];
+}
+
+
+InputSnapshot InputSnapshot::capture(Group group)
+{
+    return InputSnapshot(group, chip::gPort->Group[static_cast<uint8_t>(group)].IN.reg);
+}
+
+
 void setFunction(PinNumber pin, Function function)
 {
     auto &port = chip::gPort->Group[static_cast<uint16_t>(pin)>>5];
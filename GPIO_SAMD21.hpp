@@ -150,5 +150,144 @@ inline bool getState(Port port) {
 }
 
 
+/// The port groups of the chip.
+///
+enum class Group : uint8_t {
+    A = 0, ///< The port group A with the pins PA00-PA31.
+    B = 1, ///< The port group B with the pins PB00-PB31.
+};
+
+
+/// Get the port group of a port.
+///
+constexpr Group getGroup(Port port) {
+    return static_cast<Group>(static_cast<PinNumber>(port) >> 5u);
+}
+
+/// Get the mask of one or more ports, in their port group.
+///
+/// All ports have to be in the same port group.
+///
+template<typename... Ports>
+constexpr uint32_t getMask(Port port, Ports... ports) {
+    return (static_cast<uint32_t>(1) << (static_cast<PinNumber>(port) & 0b11111u)) | (0u | ... | getMask(ports));
+}
+
+/// Configure multiple pins of a port group at once.
+///
+/// This sets the mode, pull and function of all pins in the mask, using one `WRCONFIG`
+/// write for each half of the port group with selected pins. In contrast to `setMode`
+/// and `setFunction`, the pin configuration is replaced and not modified, so all
+/// configuration of the pins is set with this call.
+///
+/// Example:
+/// `configurePins(Group::A, getMask(Port::PA16, Port::PA17), Mode::Input, Pull::Up);`
+///
+/// @param group The port group of the pins.
+/// @param mask The mask of the pins to configure.
+/// @param mode The mode for the pins.
+/// @param pull The pull for the pins, if they are configured as input.
+/// @param function The function for the pins, or `Function::Disabled` to disable
+///     multiplexing for the pins.
+/// @return `Status::Success` if the pins were configured, `Status::Error` for an unknown mode.
+///
+Status configurePins(Group group, uint32_t mask, Mode mode, Pull pull = Pull::None,
+    Function function = Function::Disabled);
+
+/// Enable continuous sampling for pins of a port group.
+///
+/// By default, the input of a pin is only sampled if the `IN` register is read, which
+/// adds a synchronizer delay to each read. With continuous sampling, the input is sampled
+/// every clock cycle, so reading `IN` has no delay, at the cost of a higher power consumption.
+///
+/// @param group The port group of the pins.
+/// @param mask The mask of the pins to enable continuous sampling.
+///
+void enableContinuousSampling(Group group, uint32_t mask);
+
+/// Disable continuous sampling for pins of a port group.
+///
+/// @param group The port group of the pins.
+/// @param mask The mask of the pins to disable continuous sampling.
+///
+void disableContinuousSampling(Group group, uint32_t mask);
+
+
+/// A snapshot of the inputs of a port group.
+///
+/// The `IN` register is read once, and all queries are answered from the captured value.
+/// Scanning many inputs this way needs a single register read. Combine it with continuous
+/// sampling, to read the inputs without synchronizer delay.
+///
+/// Example:
+/// `const auto inputs = InputSnapshot::capture(Group::A); if (inputs.isHigh(Port::PA16)) ...`
+///
+class InputSnapshot
+{
+public:
+    /// Create a snapshot from a captured value.
+    ///
+    /// @param group The port group.
+    /// @param input The value of the `IN` register.
+    ///
+    constexpr InputSnapshot(Group group, uint32_t input) : _group(group), _input(input) {}
+
+public:
+    /// Capture the inputs of a port group.
+    ///
+    /// @param group The port group to capture.
+    /// @return The snapshot with the current inputs.
+    ///
+    static InputSnapshot capture(Group group);
+
+    /// Get the captured port group.
+    ///
+    constexpr Group getGroup() const { return _group; }
+
+    /// Get the captured value of the `IN` register.
+    ///
+    constexpr uint32_t getInput() const { return _input; }
+
+    /// Check if the input of a port is high.
+    ///
+    /// @param port The port, which has to be in the captured port group.
+    /// @return `true` if the input was high, `false` if it was low or the port is not in
+    ///     the captured port group.
+    ///
+    constexpr bool isHigh(Port port) const {
+        return GPIO::getGroup(port) == _group && (_input & getMask(port)) != 0;
+    }
+
+    /// Check if the input of a port is low.
+    ///
+    /// @param port The port, which has to be in the captured port group.
+    /// @return `true` if the input was low, `false` if it was high or the port is not in
+    ///     the captured port group.
+    ///
+    constexpr bool isLow(Port port) const {
+        return GPIO::getGroup(port) == _group && (_input & getMask(port)) == 0;
+    }
+
+    /// Check if any input of the mask is high.
+    ///
+    constexpr bool isAnyHigh(uint32_t mask) const { return (_input & mask) != 0; }
+
+    /// Check if all inputs of the mask are high.
+    ///
+    constexpr bool isAllHigh(uint32_t mask) const { return (_input & mask) == mask; }
+
+    /// Check if the input of a static pin, e.g. `PinPA16`, is high.
+    ///
+    template<typename Pin>
+    constexpr bool isHigh() const {
+        return static_cast<uint8_t>(_group) == Pin::cPortIndex && (_input & Pin::cMask) != 0;
+    }
+
+private:
+    Group _group; ///< The captured port group.
+    uint32_t _input; ///< The captured value of the `IN` register.
+};
+
+
 }
 
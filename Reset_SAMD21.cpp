@@ -51,6 +51,7 @@ void erase() {
     __disable_irq();
     // Only erase the application, if a boot loader is present.
     if (cAppStart >= 0x204) {
+        // No deadline: the interrupts are disabled, the flash may be erased and the board resets anyway.
         while (!nvmReady()) {}
         // Erase the first block of the application.
         NVMCTRL->STATUS.reg |= NVMCTRL_STATUS_MASK;
@@ -0,0 +1,84 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "SercomInterrupt_SAMD21.hpp"
+
+
+#include "hal-core/Chip.hpp"
+
+
+namespace lr::SercomInterrupt {
+
+
+namespace {
+
+
+/// One registered interrupt callback.
+///
+struct Entry {
+    Callback callback; ///< The callback or `nullptr`.
+    void *context; ///< The context for the callback.
+};
+
+
+/// The callbacks for all SERCOM interfaces.
+///
+Entry gEntries[cSercomCount] = {};
+
+
+}
+
+
+void setCallback(const uint8_t sercomIndex, const Callback callback, void *context)
+{
+    if (sercomIndex >= cSercomCount) {
+        return;
+    }
+    const auto irq = static_cast<IRQn_Type>(SERCOM0_IRQn + sercomIndex);
+    NVIC_DisableIRQ(irq);
+    gEntries[sercomIndex].callback = callback;
+    gEntries[sercomIndex].context = context;
+    if (callback != nullptr) {
+        NVIC_ClearPendingIRQ(irq);
+        NVIC_EnableIRQ(irq);
+    }
+}
+
+
+/// Dispatch an interrupt to the registered callback.
+///
+inline void dispatch(const uint8_t sercomIndex)
+{
+    const auto &entry = gEntries[sercomIndex];
+    if (entry.callback != nullptr) {
+        entry.callback(entry.context);
+    }
+}
+
+
+}
+
+
+/// The SERCOM interrupt handlers.
+///
+void SERCOM0_Handler() { lr::SercomInterrupt::dispatch(0); }
+void SERCOM1_Handler() { lr::SercomInterrupt::dispatch(1); }
+void SERCOM2_Handler() { lr::SercomInterrupt::dispatch(2); }
+void SERCOM3_Handler() { lr::SercomInterrupt::dispatch(3); }
+void SERCOM4_Handler() { lr::SercomInterrupt::dispatch(4); }
+void SERCOM5_Handler() { lr::SercomInterrupt::dispatch(5); }
+
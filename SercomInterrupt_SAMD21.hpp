@@ -0,0 +1,52 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <cstdint>
+
+
+namespace lr::SercomInterrupt {
+
+
+/// The number of SERCOM interfaces on the chip.
+///
+constexpr uint8_t cSercomCount = 6;
+
+
+/// The callback function for a SERCOM interrupt.
+///
+/// @param context The context pointer passed to `setCallback`.
+///
+using Callback = void(*)(void *context);
+
+
+/// Set the callback for a SERCOM interrupt.
+///
+/// The callback is called from the `SERCOMx_Handler` interrupt handler. Setting a
+/// callback also enables the interrupt in the NVIC. Setting `nullptr` disables it.
+///
+/// @param sercomIndex The index of the SERCOM interface, 0-5.
+/// @param callback The callback to call, or `nullptr` to remove it.
+/// @param context A context pointer passed to the callback.
+///
+void setCallback(uint8_t sercomIndex, Callback callback, void *context);
+
+
+}
+
@@ -0,0 +1,94 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include <cstdint>
+
+
+namespace lr::SmBusPec {
+
+
+/// The table for the packet error code (PEC) of SMBus transactions.
+///
+/// The PEC is a CRC-8 with the polynomial x^8 + x^2 + x + 1 (0x07), an initial value of
+/// zero and no final XOR. It covers all bytes of a transaction including the address bytes.
+/// Because there is no final XOR, the CRC over a message followed by its PEC is zero.
+///
+/// The CRC is calculated with a 256-entry table, stored in flash.
+///
+struct Table {
+    uint8_t values[256]; ///< The CRC for each byte.
+};
+
+
+/// Create the CRC table.
+///
+constexpr Table createTable() {
+    Table table = {};
+    for (uint16_t i = 0; i < 256; ++i) {
+        uint8_t crc = static_cast<uint8_t>(i);
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint8_t>((crc & 0x80u) != 0 ? ((crc << 1u) ^ 0x07u) : (crc << 1u));
+        }
+        table.values[i] = crc;
+    }
+    return table;
+}
+
+
+/// The CRC table.
+///
+inline constexpr Table cTable = createTable();
+
+
+/// Add a byte to a PEC.
+///
+/// @param pec The current PEC, zero at the start of the transaction.
+/// @param data The next byte.
+/// @return The updated PEC.
+///
+constexpr uint8_t update(uint8_t pec, uint8_t data) {
+    return cTable.values[static_cast<uint8_t>(pec ^ data)];
+}
+
+
+/// Calculate the PEC for a block of bytes.
+///
+/// @param data The bytes.
+/// @param count The number of bytes.
+/// @param pec The initial PEC.
+/// @return The PEC for the bytes.
+///
+constexpr uint8_t calculate(const uint8_t *data, uint16_t count, uint8_t pec = 0) {
+    for (uint16_t i = 0; i < count; ++i) {
+        pec = update(pec, data[i]);
+    }
+    return pec;
+}
+
+
+namespace Check {
+constexpr uint8_t cDigits[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(calculate(cDigits, 9) == 0xf4, "The CRC-8 check value is wrong.");
+}
+
+
+}
+
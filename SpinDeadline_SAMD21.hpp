@@ -0,0 +1,104 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "ClockCycles.hpp"
+
+#include "hal-common/Timer.hpp"
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// A cheap deadline for busy loops polling a register.
+///
+/// `Timer::Deadline` reads the millisecond tick in every call of `hasTimeout()`. This
+/// deadline only decrements a counter in most calls, and reads the tick once every
+/// `cCheckInterval` calls.
+///
+/// Additionally, it counts down an iteration budget, calculated from the timeout and the
+/// minimum number of clock cycles a polling loop takes. The budget never expires before
+/// the timeout, but it ends the loop even if the tick does not advance, e.g. if the loop
+/// runs in an interrupt handler.
+///
+/// All register polling loops of the HAL use this deadline. The few loops without one
+/// have a comment which explains why.
+///
+class SpinDeadline
+{
+public:
+    /// The minimum number of clock cycles for one iteration of a polling loop.
+    ///
+    /// A volatile load, a compare, the decrement and a branch.
+    ///
+    static constexpr uint32_t cMinimumCyclesPerIteration = 6;
+
+    /// The number of iterations between two reads of the millisecond tick.
+    ///
+    static constexpr uint32_t cCheckInterval = 32;
+
+public:
+    /// Create a new deadline.
+    ///
+    /// @param timeout The timeout, up to 60 seconds.
+    ///
+    inline explicit SpinDeadline(Milliseconds timeout) noexcept
+        : _startTick(static_cast<uint32_t>(Timer::tickMilliseconds().ticks())),
+        _timeout(static_cast<uint32_t>(timeout.ticks())),
+        _budget(getIterationBudget(_timeout)),
+        _countdown(cCheckInterval)
+    {
+    }
+
+public:
+    /// Check if the deadline has passed.
+    ///
+    /// Call this method once per loop iteration.
+    ///
+    inline bool hasTimeout() noexcept {
+        if (--_countdown != 0) {
+            return false;
+        }
+        _countdown = cCheckInterval;
+        if (_budget <= cCheckInterval) {
+            return true;
+        }
+        _budget -= cCheckInterval;
+        return (static_cast<uint32_t>(Timer::tickMilliseconds().ticks()) - _startTick) > _timeout;
+    }
+
+private:
+    /// Get the iteration budget for a timeout.
+    ///
+    static constexpr uint32_t getIterationBudget(uint32_t timeoutMs) {
+        return timeoutMs * (ClockCycles::cSystemCoreClock / 1000ul / cMinimumCyclesPerIteration) + cCheckInterval;
+    }
+
+private:
+    uint32_t _startTick; ///< The millisecond tick at the start.
+    uint32_t _timeout; ///< The timeout in milliseconds.
+    uint32_t _budget; ///< The remaining iteration budget.
+    uint32_t _countdown; ///< The iterations until the next check.
+};
+
+
+}
+
@@ -19,6 +19,8 @@
 
 
 #include "Reset_SAMD21.hpp"
+#include "Debouncer_SAMD21.hpp"
+#include "ClockCycles.hpp"
 
 #include "hal-core/Chip.hpp"
 
@@ -39,6 +41,7 @@ Milliseconds tickMilliseconds()
 void waitForNextTick()
 {
     const auto currentValue = tickMilliseconds();
+    // No deadline: this loop waits for the tick itself, it is the time base of `SpinDeadline`.
     while (currentValue == tickMilliseconds()) {}
 }
 
@@ -59,6 +62,39 @@ void delayMicroseconds(const uint32_t microseconds)
 }
 
 
+}
+
+
+namespace ClockCycles {
+
+
+void getTickAndCycles(uint32_t &ticks, uint32_t &cycles)
+{
+    uint32_t value;
+    bool pending;
+    do {
+        ticks = Timer::gTickCounter;
+        value = SysTick->VAL;
+        pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+    } while (ticks != Timer::gTickCounter);
+    const uint32_t reload = SysTick->LOAD;
+    // The SysTick wrapped, but the interrupt is blocked and did not increment the counter yet.
+    if (pending && value > (reload / 2)) {
+        ticks += 1;
+    }
+    cycles = reload - value;
+}
+
+
+uint32_t getCounter()
+{
+    uint32_t ticks;
+    uint32_t cycles;
+    getTickAndCycles(ticks, cycles);
+    return (ticks * (SysTick->LOAD + 1)) + cycles;
+}
+
+
 }
 }
 
@@ -67,4 +103,5 @@ void SysTick_Handler(void)
 {
     ++lr::Timer::gTickCounter;
     lr::Reset::eraseTick();
+    lr::Debouncer::debounceTick();
 }
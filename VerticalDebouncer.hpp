@@ -0,0 +1,80 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// A debouncer for 32 inputs, using vertical counters.
+///
+/// Each input has a two bit counter, where the bits of all counters are stored in two
+/// words. So all 32 inputs are debounced at once with a few bitwise operations. The
+/// counter of an input is reset if the sample equals the debounced state. If an input
+/// differs from the debounced state for four consecutive samples, the state changes.
+///
+class VerticalDebouncer
+{
+public:
+    /// The number of consecutive samples to change the state of an input.
+    ///
+    constexpr static const uint8_t cSampleCount = 4;
+
+public:
+    /// Create a new debouncer, with all inputs inactive.
+    ///
+    constexpr VerticalDebouncer() : VerticalDebouncer(0) {}
+
+    /// Create a new debouncer.
+    ///
+    /// @param state The initial debounced state.
+    ///
+    constexpr explicit VerticalDebouncer(uint32_t state) : _state(state), _count0(0), _count1(0) {}
+
+public:
+    /// Add a new sample for all inputs.
+    ///
+    /// @param sample The sampled inputs.
+    /// @return The mask of inputs where the debounced state changed.
+    ///
+    constexpr uint32_t update(uint32_t sample) {
+        const uint32_t delta = sample ^ _state;
+        _count1 = (_count1 ^ _count0) & delta;
+        _count0 = ~_count0 & delta;
+        const uint32_t changed = delta & ~(_count0 | _count1);
+        _state ^= changed;
+        return changed;
+    }
+
+    /// Get the debounced state.
+    ///
+    constexpr uint32_t getState() const { return _state; }
+
+private:
+    uint32_t _state; ///< The debounced state.
+    uint32_t _count0; ///< The lower bits of the counters.
+    uint32_t _count1; ///< The upper bits of the counters.
+};
+
+
+}
+
@@ -0,0 +1,124 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include <cstdint>
+
+
+namespace lr::WireBaud {
+
+
+/// The result of the baud rate calculation.
+///
+struct Result {
+    bool isValid; ///< If the frequency can be reached with the given clock.
+    uint8_t baud; ///< The value for BAUD (high time) or HSBAUD.
+    uint8_t baudLow; ///< The value for BAUDLOW (low time) or HSBAUDLOW.
+    uint32_t frequencyHz; ///< The achieved SCL frequency.
+    int32_t errorPpm; ///< The error of the achieved frequency in ppm, always zero or negative.
+};
+
+
+/// Split the sum of the baud values into a high and low part.
+///
+/// The low part gets the larger half, as the I2C specification requires a longer low time.
+///
+constexpr Result createResult(uint32_t sum, uint32_t clockHz, uint32_t targetHz, uint32_t fixedCycles) {
+    Result result = {};
+    if (sum > 510u) {
+        return result;
+    }
+    result.isValid = true;
+    result.baud = static_cast<uint8_t>(sum / 2u);
+    result.baudLow = static_cast<uint8_t>(sum - result.baud);
+    result.frequencyHz = clockHz / (fixedCycles + sum);
+    result.errorPpm = static_cast<int32_t>(
+        (static_cast<int64_t>(result.frequencyHz) - static_cast<int64_t>(targetHz)) * 1000000 /
+        static_cast<int64_t>(targetHz));
+    return result;
+}
+
+
+/// Calculate the baud values for standard, fast and fast-plus mode.
+///
+/// f_SCL = f_GCLK / (10 + BAUD + BAUDLOW + f_GCLK * T_RISE)
+///
+/// The values are rounded, so the achieved frequency never exceeds the target frequency.
+///
+/// @param clockHz The frequency of the generic clock of the SERCOM.
+/// @param targetHz The target SCL frequency.
+/// @param riseTimeNs The rise time of the bus in nanoseconds.
+/// @return The result, `isValid` is `false` if the frequency can not be reached.
+///
+constexpr Result calculate(uint32_t clockHz, uint32_t targetHz, uint32_t riseTimeNs) {
+    if (clockHz == 0 || targetHz == 0 || targetHz > clockHz) {
+        return Result{};
+    }
+    const uint32_t periodCycles = (clockHz + targetHz - 1u) / targetHz;
+    const auto riseCycles = static_cast<uint32_t>(
+        static_cast<uint64_t>(clockHz) * static_cast<uint64_t>(riseTimeNs) / 1000000000ull);
+    const uint32_t fixedCycles = 10u + riseCycles;
+    if (periodCycles < fixedCycles) {
+        return Result{};
+    }
+    return createResult(periodCycles - fixedCycles, clockHz, targetHz, fixedCycles);
+}
+
+
+/// Calculate the baud values for high-speed mode.
+///
+/// f_SCL = f_GCLK / (2 + HSBAUD + HSBAUDLOW)
+///
+/// @param clockHz The frequency of the generic clock of the SERCOM.
+/// @param targetHz The target SCL frequency.
+/// @return The result, `isValid` is `false` if the frequency can not be reached.
+///
+constexpr Result calculateHighSpeed(uint32_t clockHz, uint32_t targetHz) {
+    if (clockHz == 0 || targetHz == 0 || targetHz > clockHz) {
+        return Result{};
+    }
+    const uint32_t periodCycles = (clockHz + targetHz - 1u) / targetHz;
+    if (periodCycles < 2u) {
+        return Result{};
+    }
+    return createResult(periodCycles - 2u, clockHz, targetHz, 2u);
+}
+
+
+namespace Check {
+// The values for the default 48MHz clock, matching the previous calculation.
+static_assert(calculate(48000000, 100000, 90).baud == 233 && calculate(48000000, 100000, 90).baudLow == 233);
+static_assert(calculate(48000000, 400000, 90).baud == 53 && calculate(48000000, 400000, 90).baudLow == 53);
+static_assert(calculate(48000000, 1000000, 90).baud == 17 && calculate(48000000, 1000000, 90).baudLow == 17);
+static_assert(calculate(48000000, 400000, 300).frequencyHz <= 400000);
+static_assert(calculateHighSpeed(48000000, 3400000).frequencyHz == 3200000);
+// Slower clocks.
+static_assert(calculate(8000000, 100000, 0).baud == 35 && calculate(8000000, 100000, 0).baudLow == 35);
+static_assert(calculate(8000000, 400000, 0).frequencyHz == 400000);
+static_assert(calculate(1000000, 100000, 0).isValid && calculate(1000000, 100000, 0).baud == 0);
+// Out of range.
+static_assert(!calculate(48000000, 10000, 0).isValid);
+static_assert(!calculate(1000000, 400000, 0).isValid);
+static_assert(!calculate(32768, 100000, 0).isValid);
+}
+
+
+}
+
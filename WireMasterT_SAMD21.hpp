@@ -0,0 +1,173 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "WireMaster_SAMD21.hpp"
+
+
+namespace lr {
+
+
+/// The valid pin configurations for I2C on the SAM D21.
+///
+/// SDA has to be on PAD0 and SCL on PAD1 of the SERCOM. This table lists all pins of the
+/// multiplexing matrix where this is possible, for the default (function C) and the
+/// alternative (function D) configuration.
+///
+class WirePins_SAMD21
+{
+public:
+    /// One valid pin configuration.
+    ///
+    struct Entry {
+        WireMaster_SAMD21::Interface interface; ///< The interface.
+        GPIO::Port sda; ///< The SDA pin on PAD0.
+        GPIO::Port scl; ///< The SCL pin on PAD1.
+    };
+
+    /// All valid pin configurations.
+    ///
+    static constexpr Entry cEntries[] = {
+        {WireMaster_SAMD21::Interface::SerCom0, GPIO::Port::PA08, GPIO::Port::PA09},
+        {WireMaster_SAMD21::Interface::SerCom0Alt, GPIO::Port::PA04, GPIO::Port::PA05},
+        {WireMaster_SAMD21::Interface::SerCom1, GPIO::Port::PA16, GPIO::Port::PA17},
+        {WireMaster_SAMD21::Interface::SerCom1Alt, GPIO::Port::PA00, GPIO::Port::PA01},
+        {WireMaster_SAMD21::Interface::SerCom2, GPIO::Port::PA12, GPIO::Port::PA13},
+        {WireMaster_SAMD21::Interface::SerCom2Alt, GPIO::Port::PA08, GPIO::Port::PA09},
+        {WireMaster_SAMD21::Interface::SerCom3, GPIO::Port::PA22, GPIO::Port::PA23},
+        {WireMaster_SAMD21::Interface::SerCom3Alt, GPIO::Port::PA16, GPIO::Port::PA17},
+        {WireMaster_SAMD21::Interface::SerCom4, GPIO::Port::PB12, GPIO::Port::PB13},
+        {WireMaster_SAMD21::Interface::SerCom4Alt, GPIO::Port::PA12, GPIO::Port::PA13},
+        {WireMaster_SAMD21::Interface::SerCom4Alt, GPIO::Port::PB08, GPIO::Port::PB09},
+        {WireMaster_SAMD21::Interface::SerCom5, GPIO::Port::PB16, GPIO::Port::PB17},
+        {WireMaster_SAMD21::Interface::SerCom5Alt, GPIO::Port::PA22, GPIO::Port::PA23},
+        {WireMaster_SAMD21::Interface::SerCom5Alt, GPIO::Port::PB02, GPIO::Port::PB03},
+        {WireMaster_SAMD21::Interface::SerCom5Alt, GPIO::Port::PB30, GPIO::Port::PB31},
+    };
+
+    /// Check if a pin configuration is valid.
+    ///
+    /// @param interface The interface.
+    /// @param sda The SDA pin.
+    /// @param scl The SCL pin.
+    /// @return `true` if the pins can be used for I2C with this interface.
+    ///
+    static constexpr bool isValid(WireMaster_SAMD21::Interface interface, GPIO::Port sda, GPIO::Port scl) {
+        for (const auto &entry : cEntries) {
+            if (entry.interface == interface && entry.sda == sda && entry.scl == scl) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+
+/// A compile time setup for an I2C bus.
+///
+/// @tparam tInterface The SERCOM interface.
+/// @tparam tSDA The SDA pin, has to be on PAD0 of the SERCOM.
+/// @tparam tSCL The SCL pin, has to be on PAD1 of the SERCOM.
+///
+template<WireMaster_SAMD21::Interface tInterface, GPIO::Port tSDA, GPIO::Port tSCL>
+struct WireSetup_SAMD21
+{
+    static_assert(WirePins_SAMD21::isValid(tInterface, tSDA, tSCL),
+        "The SDA/SCL pins can not be used with this SERCOM interface.");
+
+    /// The interface.
+    ///
+    static constexpr auto cInterface = tInterface;
+
+    /// The SDA pin.
+    ///
+    static constexpr auto cPinSDA = static_cast<GPIO::PinNumber>(tSDA);
+
+    /// The SCL pin.
+    ///
+    static constexpr auto cPinSCL = static_cast<GPIO::PinNumber>(tSCL);
+
+    /// The index of the SERCOM.
+    ///
+    static constexpr uint8_t cSercomIndex = WireMaster_SAMD21::getSercomIndex(tInterface);
+
+    /// The generic clock ID of the SERCOM.
+    ///
+    static constexpr uint8_t cClockId = static_cast<uint8_t>(GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + cSercomIndex);
+    static_assert(GCLK_CLKCTRL_ID_SERCOM5_CORE_Val == GCLK_CLKCTRL_ID_SERCOM0_CORE_Val + 5,
+        "The clock IDs of the SERCOM interfaces have to be consecutive.");
+
+    /// The pin function.
+    ///
+    static constexpr GPIO::Function cPinFunction =
+        ((static_cast<uint8_t>(tInterface) & 0x10u) != 0) ? GPIO::Function::SercomAlt : GPIO::Function::Sercom;
+
+    /// Get the SERCOM registers.
+    ///
+    static inline Sercom* getSercom() {
+        switch (cSercomIndex) {
+        default:
+        case 0: return chip::gSercom0;
+        case 1: return chip::gSercom1;
+        case 2: return chip::gSercom2;
+        case 3: return chip::gSercom3;
+        case 4: return chip::gSercom4;
+        case 5: return chip::gSercom5;
+        }
+    }
+};
+
+
+/// An I2C bus with a configuration resolved at compile time.
+///
+/// Invalid combinations of SERCOM and pins fail to compile. The SERCOM registers, the clock ID
+/// and the pin function are constants of the setup, so no lookup tables are used at runtime.
+/// The transfers use the shared driver code with the registers passed to the constructor.
+///
+/// Example:
+/// `WireMasterT<WireSetup_SAMD21<WireMaster_SAMD21::Interface::SerCom3, GPIO::Port::PA22, GPIO::Port::PA23>> gWire;`
+///
+/// @tparam tSetup The setup, usually a `WireSetup_SAMD21` type.
+///
+template<typename tSetup>
+class WireMasterT : public WireMaster_SAMD21
+{
+public:
+    /// The setup of this bus.
+    ///
+    using Setup = tSetup;
+
+public:
+    /// Create the I2C bus.
+    ///
+    inline WireMasterT()
+        : WireMaster_SAMD21(Setup::cInterface, Setup::getSercom(), Setup::cPinSDA, Setup::cPinSCL)
+    {
+    }
+
+public: // Implement the WireMaster interface.
+    inline Status initialize() override {
+        return WireMaster_SAMD21::initialize(Setup::cClockId, Setup::cPinFunction);
+    }
+};
+
+
+}
+
@@ -20,6 +20,7 @@
 
 #include "GPIO_FeatherM0.hpp"
 #include "WireMaster_SAMD21.hpp"
+#include "WireMasterT_SAMD21.hpp"
 
 
 namespace lr {
@@ -46,8 +47,10 @@ public:
         Default = SDA_SCL_3, ///< The default bus.
     };
     
-private:
-    static inline Interface getInterfaceForSetup(const Setup setup)
+public:
+    /// Get the interface for a setup.
+    ///
+    static constexpr Interface getInterfaceForSetup(const Setup setup)
     {
         switch (setup) {
         case Setup::A1_A2: return Interface::SerCom4Alt;
@@ -61,7 +64,9 @@ private:
         return Interface::SerCom3;
     }
 
-    static inline GPIO::PinNumber getSdaPinForSetup(const Setup setup)
+    /// Get the SDA pin for a setup.
+    ///
+    static constexpr GPIO::PinNumber getSdaPinForSetup(const Setup setup)
     {
         switch (setup) {
         case Setup::A1_A2: return static_cast<GPIO::PinNumber>(GPIO::Port::PB08);
@@ -75,7 +80,9 @@ private:
         return static_cast<GPIO::PinNumber>(GPIO::FeatherM0::SDA);
     }
 
-    static inline GPIO::PinNumber getSclPinForSetup(const Setup setup)
+    /// Get the SCL pin for a setup.
+    ///
+    static constexpr GPIO::PinNumber getSclPinForSetup(const Setup setup)
     {
         switch (setup) {
         case Setup::A1_A2: return static_cast<GPIO::PinNumber>(GPIO::Port::PB09);
@@ -96,6 +103,18 @@ public:
     }
 };
 
+
+/// The compile time setup for a bus on the Adafruit Feather M0 platform.
+///
+/// Example:
+/// `WireMasterT<WireSetup_FeatherM0<WireMaster_FeatherM0::Setup::Default>> gWire;`
+///
+template<WireMaster_FeatherM0::Setup tSetup>
+using WireSetup_FeatherM0 = WireSetup_SAMD21<
+    WireMaster_FeatherM0::getInterfaceForSetup(tSetup),
+    static_cast<GPIO::Port>(WireMaster_FeatherM0::getSdaPinForSetup(tSetup)),
+    static_cast<GPIO::Port>(WireMaster_FeatherM0::getSclPinForSetup(tSetup))>;
+
     
 }
 
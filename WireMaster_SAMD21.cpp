@@ -20,6 +20,9 @@
 
 #include "GPIO_SAMD21.hpp"
 #include "ClockCycles.hpp"
+#include "SercomInterrupt_SAMD21.hpp"
+#include "Dma_SAMD21.hpp"
+#include "SpinDeadline_SAMD21.hpp"
 
 #include "hal-common/Timer.hpp"
 #include "hal-common/StatusTools.hpp"
@@ -35,6 +38,22 @@ namespace {
 ///
 const uint32_t cDefaultSpeed100k = 100000;
 
+/// The default number of failures until the bus is recovered.
+///
+const uint8_t cDefaultRecoveryThreshold = 3;
+
+/// Half of the SCL clock period for the bus recovery (100kHz).
+///
+const uint32_t cRecoveryHalfPeriod = ClockCycles::fromMicroseconds(5);
+
+/// The maximum frequency for fast mode.
+///
+const uint32_t cFastSpeed = 400000;
+
+/// The maximum frequency for fast mode plus.
+///
+const uint32_t cFastPlusSpeed = 1000000;
+
 // Constants not defined in CMSIS.
 const uint8_t cBusStateUnknown = 0x0;
 const uint8_t cBusStateIdle = 0x1;
@@ -58,6 +77,18 @@ enum class Command : uint8_t {
 };
 
 
+/// Wait for a number of clock cycles.
+///
+/// @param cycles The number of clock cycles to wait.
+///
+inline void waitCycles(uint32_t cycles)
+{
+    const auto start = ClockCycles::getCounter();
+    // No deadline: the loop polls no hardware and ends after the given number of cycles.
+    while ((ClockCycles::getCounter() - start) < cycles) {}
+}
+
+
 /// Wait for a system operation to finish.
 ///
 /// @param sercom The SERCOM interface to use.
@@ -65,7 +96,7 @@ enum class Command : uint8_t {
 ///
 inline WireMaster::Status waitForSystemOperation(Sercom *sercom)
 {
-    Timer::Deadline sysopTimer(10_ms);
+    SpinDeadline sysopTimer(10_ms);
     while (sercom->I2CM.SYNCBUSY.bit.SYSOP != 0) {
         if (sysopTimer.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -82,7 +113,7 @@ inline WireMaster::Status waitForSystemOperation(Sercom *sercom)
 ///
 inline WireMaster::Status waitForSyncEnable(Sercom *sercom)
 {
-    Timer::Deadline sysopTimer(10_ms);
+    SpinDeadline sysopTimer(10_ms);
     while (sercom->I2CM.SYNCBUSY.bit.ENABLE != 0) {
         if (sysopTimer.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -99,7 +130,7 @@ inline WireMaster::Status waitForSyncEnable(Sercom *sercom)
 ///
 inline bool isBusReady(Sercom *sercom)
 {
-    const auto busState = sercom->I2CM.STATUS.bit.BUSSTATE;
+    const uint8_t busState = sercom->I2CM.STATUS.bit.BUSSTATE;
     return busState == cBusStateIdle || busState == cBusStateOwner;
 }
 
@@ -123,7 +154,7 @@ inline WireMaster::Status waitUntilReady(Sercom *sercom)
     if (hasBusError(sercom)) {
         return WireMaster::Status::Error;
     }
-    Timer::Deadline readyTimer(100_ms);
+    SpinDeadline readyTimer(100_ms);
     while (!isBusReady(sercom)) {
         if (readyTimer.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -154,7 +185,7 @@ inline WireMaster::Status setAcknowledge(Sercom *sercom, Acknowledge acknowledge
 ///
 inline WireMaster::Status waitForBusIdle(Sercom *sercom)
 {
-    Timer::Deadline dt(10_ms);
+    SpinDeadline dt(10_ms);
     while (sercom->I2CM.STATUS.bit.BUSSTATE != cBusStateIdle) {
         if (dt.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -170,7 +201,7 @@ inline WireMaster::Status waitForBusIdle(Sercom *sercom)
 ///
 inline WireMaster::Status waitForMasterOnBus(Sercom *sercom)
 {
-    Timer::Deadline waitTimer(100_ms);
+    SpinDeadline waitTimer(100_ms);
     while (!sercom->I2CM.INTFLAG.bit.MB) {
         if (waitTimer.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -189,7 +220,7 @@ inline WireMaster::Status waitForMasterOnBus(Sercom *sercom)
 ///
 inline WireMaster::Status waitForSlaveOnBus(Sercom *sercom)
 {
-    Timer::Deadline waitTimer(100_ms);
+    SpinDeadline waitTimer(100_ms);
     while (!sercom->I2CM.INTFLAG.bit.SB) {
         if (waitTimer.hasTimeout()) {
             return WireMaster::Status::Timeout;
@@ -223,7 +254,8 @@ inline WireMaster::Status sendCommand(Sercom *sercom, Command command)
 ///
 inline WireMaster::Status sendCommandAcknowledgeAddress(Sercom *sercom, Command command, Acknowledge acknowledge)
 {
-    const uint32_t regValue = SERCOM_I2CM_CTRLB_CMD(static_cast<uint8_t>(command)) |
+    // The write sets the whole register, keep the smart mode enabled for the next read.
+    const uint32_t regValue = SERCOM_I2CM_CTRLB_SMEN | SERCOM_I2CM_CTRLB_CMD(static_cast<uint8_t>(command)) |
         (static_cast<uint32_t>(acknowledge) << SERCOM_I2CM_CTRLB_ACKACT_Pos);
     sercom->I2CM.CTRLB.reg = regValue;
     return waitForSystemOperation(sercom);
@@ -232,82 +264,117 @@ inline WireMaster::Status sendCommandAcknowledgeAddress(Sercom *sercom, Command
 }
 
 
-WireMaster_SAMD21::WireMaster_SAMD21(Interface interface, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL)
-:
-    WireMaster(),
-    _interface(interface),
-    _pinSDA(pinSDA),
-    _pinSCL(pinSCL),
-    _frequencyHz(cDefaultSpeed100k),
-    _riseTime(90_ns)
+Sercom* WireMaster_SAMD21::getSercom(Interface interface)
 {
-    // Assign the correct interface structure.
     switch (interface) {
     default:
     case Interface::SerCom0:
     case Interface::SerCom0Alt:
-        _sercom = chip::gSercom0;
-        break;
+        return chip::gSercom0;
     case Interface::SerCom1:
     case Interface::SerCom1Alt:
-        _sercom = chip::gSercom1;
-        break;
+        return chip::gSercom1;
     case Interface::SerCom2:
     case Interface::SerCom2Alt:
-        _sercom = chip::gSercom2;
-        break;
+        return chip::gSercom2;
     case Interface::SerCom3:
     case Interface::SerCom3Alt:
-        _sercom = chip::gSercom3;
-        break;
+        return chip::gSercom3;
     case Interface::SerCom4:
     case Interface::SerCom4Alt:
-        _sercom = chip::gSercom4;
-        break;
+        return chip::gSercom4;
     case Interface::SerCom5:
     case Interface::SerCom5Alt:
-        _sercom = chip::gSercom5;
-        break;
+        return chip::gSercom5;
     }
 }
 
 
-WireMaster_SAMD21::Status WireMaster_SAMD21::initialize()
+uint8_t WireMaster_SAMD21::getClockId(Interface interface)
 {
-    // Enable the clock for the SERCOM interface.
-    uint8_t clockId;
-    switch (_interface) {
+    switch (interface) {
     default:
     case Interface::SerCom0:
     case Interface::SerCom0Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM0_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM0_CORE_Val;
     case Interface::SerCom1:
     case Interface::SerCom1Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM1_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM1_CORE_Val;
     case Interface::SerCom2:
     case Interface::SerCom2Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM2_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM2_CORE_Val;
     case Interface::SerCom3:
     case Interface::SerCom3Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM3_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM3_CORE_Val;
     case Interface::SerCom4:
     case Interface::SerCom4Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM4_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM4_CORE_Val;
     case Interface::SerCom5:
     case Interface::SerCom5Alt:
-        clockId = GCLK_CLKCTRL_ID_SERCOM5_CORE_Val;
-        break;
+        return GCLK_CLKCTRL_ID_SERCOM5_CORE_Val;
     }
+}
+
+
+GPIO::Function WireMaster_SAMD21::getPinFunction(Interface interface)
+{
+    if ((static_cast<uint8_t>(interface) & 0x10u) != 0) {
+        return GPIO::Function::SercomAlt;
+    }
+    return GPIO::Function::Sercom;
+}
+
+
+WireMaster_SAMD21::WireMaster_SAMD21(Interface interface, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL)
+:
+    WireMaster_SAMD21(interface, getSercom(interface), pinSDA, pinSCL)
+{
+}
+
+
+WireMaster_SAMD21::WireMaster_SAMD21(Interface interface, Sercom *sercom, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL)
+:
+    WireMaster(),
+    _interface(interface),
+    _sercom(sercom),
+    _pinSDA(pinSDA),
+    _pinSCL(pinSCL),
+    _frequencyHz(cDefaultSpeed100k),
+    _clockGenerator(0),
+    _clockFrequencyHz(ClockCycles::cSystemCoreClock),
+    _baudResult(),
+    _riseTime(90_ns),
+    _highSpeed(false),
+    _highSpeedFallback(),
+    _recoveryThreshold(cDefaultRecoveryThreshold),
+    _failureCount(0),
+    _recoveryCount(0),
+    _retryEntries(),
+    _pecActive(false),
+    _pec(0),
+    _async(),
+    _asyncPhase(AsyncPhase::Idle),
+    _asyncStatus(Status::Success),
+    _dmaChannel(cNoDmaChannel),
+    _dmaDescriptor()
+{
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::initialize()
+{
+    return initialize(getClockId(_interface), getPinFunction(_interface));
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::initialize(uint8_t clockId, GPIO::Function pinFunction)
+{
+    // Enable the clock for the SERCOM interface.
     GCLK->CLKCTRL.reg =
         GCLK_CLKCTRL_ID(clockId) |
-        GCLK_CLKCTRL_GEN_GCLK0 | // Source is clock generator 0
+        GCLK_CLKCTRL_GEN(_clockGenerator) | // The configured clock generator.
         GCLK_CLKCTRL_CLKEN; // Enable it.
-    Timer::Deadline gclkTimer(10_ms);
+    SpinDeadline gclkTimer(10_ms);
     while (GCLK->STATUS.reg & GCLK_STATUS_SYNCBUSY) {
         if (gclkTimer.hasTimeout()) {
             return Status::Timeout;
@@ -321,57 +388,164 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::initialize()
     }
     
     // Set the pin peripheral mode for the Arduino environment.
-    switch (_interface) {
-    default:
-    case Interface::SerCom0:
-    case Interface::SerCom1:
-    case Interface::SerCom2:
-    case Interface::SerCom3:
-    case Interface::SerCom4:
-    case Interface::SerCom5:
-        GPIO::setFunction(_pinSDA, GPIO::Function::Sercom);
-        GPIO::setFunction(_pinSCL, GPIO::Function::Sercom);
-        break;
-    case Interface::SerCom0Alt:
-    case Interface::SerCom1Alt:
-    case Interface::SerCom2Alt:
-    case Interface::SerCom3Alt:
-    case Interface::SerCom4Alt:
-    case Interface::SerCom5Alt:
-        GPIO::setFunction(_pinSDA, GPIO::Function::SercomAlt);
-        GPIO::setFunction(_pinSCL, GPIO::Function::SercomAlt);
-        break;
+    GPIO::setFunction(_pinSDA, pinFunction);
+    GPIO::setFunction(_pinSCL, pinFunction);
+
+    // Register the interrupt handler for asynchronous transactions.
+    SercomInterrupt::setCallback(getSercomIndex(), [](void *context) {
+        static_cast<WireMaster_SAMD21*>(context)->handleInterrupt();
+    }, this);
+    return Status::Success;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::setClockSource(uint8_t generator, uint32_t frequencyHz)
+{
+    if (generator > 8 || frequencyHz == 0) {
+        return Status::Error;
     }
+    _clockGenerator = generator;
+    _clockFrequencyHz = frequencyHz;
+    // The baud values have to be calculated again for the new clock.
+    _baudResult = WireBaud::Result();
     return Status::Success;
 }
 
 
-void WireMaster_SAMD21::setBaudRegister(uint32_t frequencyHz, Nanoseconds riseTime)
+WireBaud::Result WireMaster_SAMD21::calculateBaud(uint32_t frequencyHz, Nanoseconds riseTime,
+    WireBaud::Result &highSpeedResult) const
 {
-    // Change the bus speed bits.
-    _sercom->I2CM.BAUD.bit.HSBAUDLOW = 0;
-    _sercom->I2CM.BAUD.bit.HSBAUD = 0;
-    _sercom->I2CM.BAUD.bit.BAUDLOW = 0;
-    // f_SCL = f_GCLK / (10 + 2*BAUD + f_GCLK * T_RISE)
-    const uint32_t halfClock = ClockCycles::cSystemCoreClock / 2;
-    _sercom->I2CM.BAUD.bit.BAUD = (halfClock / frequencyHz) - 5 -
-                                  (halfClock * static_cast<uint32_t>(riseTime.ticks()) / 1000000000);
-    if (frequencyHz <= 400000) {
-        _sercom->I2CM.CTRLA.bit.SPEED = 0;
-    } else if (frequencyHz <= 1000000) {
-        _sercom->I2CM.CTRLA.bit.SPEED = 1;
-    } else {
+    const auto riseTimeNs = static_cast<uint32_t>(riseTime.ticks());
+    if (frequencyHz > cFastPlusSpeed) {
+        // The master code and all transfers to fallback devices use fast mode.
+        highSpeedResult = WireBaud::calculateHighSpeed(_clockFrequencyHz, frequencyHz);
+        return WireBaud::calculate(_clockFrequencyHz, cFastSpeed, riseTimeNs);
+    }
+    highSpeedResult = WireBaud::Result();
+    return WireBaud::calculate(_clockFrequencyHz, frequencyHz, riseTimeNs);
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::setBaudRegister(uint32_t frequencyHz, Nanoseconds riseTime)
+{
+    WireBaud::Result highSpeedResult;
+    const auto result = calculateBaud(frequencyHz, riseTime, highSpeedResult);
+    const bool highSpeed = (frequencyHz > cFastPlusSpeed);
+    if (!result.isValid || (highSpeed && !highSpeedResult.isValid)) {
+        return Status::Error;
+    }
+    _highSpeed = highSpeed;
+    if (_highSpeed) {
+        _sercom->I2CM.BAUD.reg = SERCOM_I2CM_BAUD_BAUD(result.baud)|
+            SERCOM_I2CM_BAUD_BAUDLOW(result.baudLow)|
+            SERCOM_I2CM_BAUD_HSBAUD(highSpeedResult.baud)|
+            SERCOM_I2CM_BAUD_HSBAUDLOW(highSpeedResult.baudLow);
+        // Clock stretch after ACK is required for high-speed mode.
+        _sercom->I2CM.CTRLA.bit.SCLSM = 1;
         _sercom->I2CM.CTRLA.bit.SPEED = 2;
+        _baudResult = highSpeedResult;
+    } else {
+        _sercom->I2CM.BAUD.reg = SERCOM_I2CM_BAUD_BAUD(result.baud)|
+            SERCOM_I2CM_BAUD_BAUDLOW(result.baudLow);
+        _sercom->I2CM.CTRLA.bit.SCLSM = 0;
+        if (frequencyHz <= cFastSpeed) {
+            _sercom->I2CM.CTRLA.bit.SPEED = 0;
+        } else {
+            _sercom->I2CM.CTRLA.bit.SPEED = 1;
+        }
+        _baudResult = result;
+    }
+    // Forget all fallback devices if the speed changes.
+    for (auto &mask : _highSpeedFallback) {
+        mask = 0;
+    }
+    return Status::Success;
+}
+
+
+bool WireMaster_SAMD21::isHighSpeedAddress(uint8_t address) const
+{
+    if (!_highSpeed) {
+        return false;
     }
+    return (_highSpeedFallback[(address >> 5u) & 0x03u] & (static_cast<uint32_t>(1) << (address & 0x1fu))) == 0;
+}
+
+
+void WireMaster_SAMD21::writeAddressRegister(uint8_t addressData, bool highSpeed)
+{
+    // Write the whole register, to clear the length counter of a previous DMA transfer.
+    uint32_t addressRegister = SERCOM_I2CM_ADDR_ADDR(addressData);
+    if (highSpeed) {
+        // The interface sends the master code in fast mode, followed by a repeated start.
+        addressRegister |= SERCOM_I2CM_ADDR_HS;
+    }
+    _sercom->I2CM.ADDR.reg = addressRegister;
+}
+
+
+WireMaster::Status WireMaster_SAMD21::sendAddress(uint8_t address, bool read)
+{
+    WireMaster::Status status;
+    enterPhase(WireStatistics::Phase::Address);
+    const uint8_t addressData = (address<<1u)|static_cast<uint8_t>(read ? 0x01u : 0x00u);
+    updatePec(addressData);
+    const bool highSpeed = isHighSpeedAddress(address);
+    writeAddressRegister(addressData, highSpeed);
+    status = read ? waitForSlaveOnBus(_sercom) : waitForMasterOnBus(_sercom);
+    if (!highSpeed) {
+        return status;
+    }
+    // Check if the device did not acknowledge the address in high-speed mode.
+    const bool noAcknowledge = read ? (status == Status::NoAcknowledge) :
+        (status == Status::Success && _sercom->I2CM.STATUS.bit.RXNACK);
+    if (!noAcknowledge) {
+        return status;
+    }
+    // Leave high-speed mode and retry in fast mode.
+    sendCommand(_sercom, Command::Stop); // Ignore timeout.
+    if (hasError(status = waitForBusIdle(_sercom))) return status;
+    writeAddressRegister(addressData, false);
+    status = read ? waitForSlaveOnBus(_sercom) : waitForMasterOnBus(_sercom);
+    const bool acknowledged = read ? (status == Status::Success) :
+        (status == Status::Success && !_sercom->I2CM.STATUS.bit.RXNACK);
+    if (acknowledged) {
+        // Remember the device as fallback device.
+        _highSpeedFallback[(address >> 5u) & 0x03u] |= (static_cast<uint32_t>(1) << (address & 0x1fu));
+    }
+    return status;
 }
 
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::reset()
+{
+    // Abort any running asynchronous transaction.
+    _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB|SERCOM_I2CM_INTENCLR_SB|SERCOM_I2CM_INTENCLR_ERROR;
+    const bool isAborted = (_asyncPhase != AsyncPhase::Idle);
+    const auto callback = _async.callback;
+    const auto context = _async.context;
+    if (isAborted) {
+        if (_async.useDma) {
+            Dma::abortTransfer(_dmaChannel);
+        }
+        _asyncStatus = Status::Error;
+        _asyncPhase = AsyncPhase::Idle;
+    }
+    const auto status = resetInterface();
+    // Report the abort after the reset, the callback may already start the next transaction.
+    if (isAborted && callback != nullptr) {
+        callback(context, Status::Error);
+    }
+    return status;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::resetInterface()
 {
     // Start the software reset.
     _sercom->I2CM.CTRLA.bit.SWRST = 1;
     // Wait for the software reset to finish.
-    Timer::Deadline opTimer(100_ms);
+    SpinDeadline opTimer(100_ms);
     while (_sercom->I2CM.CTRLA.bit.SWRST||_sercom->I2CM.SYNCBUSY.bit.SWRST) {
         if (opTimer.hasTimeout()) {
             return Status::Error;
@@ -391,7 +565,9 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::reset()
         return Status::Error;
     }
     // Set the baudrate.
-    setBaudRegister(_frequencyHz, _riseTime);
+    if (hasError(setBaudRegister(_frequencyHz, _riseTime))) {
+        return Status::Error;
+    }
     // Enable the SERCOM interface.
     _sercom->I2CM.CTRLA.bit.ENABLE = 1;
     // Wait for synchronization.
@@ -404,8 +580,8 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::reset()
     if (hasError(waitForSystemOperation(_sercom))) {
         return Status::Error;
     }
-    // Disable SB and MB interrupts.
-    _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB|SERCOM_I2CM_INTENCLR_SB;
+    // Disable SB, MB and ERROR interrupts, they are only enabled for asynchronous transactions.
+    _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB|SERCOM_I2CM_INTENCLR_SB|SERCOM_I2CM_INTENCLR_ERROR;
     // Success
     return Status::Success;
 }
@@ -428,10 +604,16 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::setSpeed(Speed speed, Nanoseconds r
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::setSpeed(uint32_t frequencyHz, Nanoseconds riseTime)
 {
-    // Ignore calls which do not actually change the frequency.
-    if (_frequencyHz == frequencyHz && _riseTime == riseTime) {
+    // Ignore calls which do not actually change the frequency, if it was reached with the current clock.
+    if (_frequencyHz == frequencyHz && _riseTime == riseTime && _baudResult.isValid) {
         return Status::Success;
     }
+    // Check if the frequency can be reached, before the interface is touched.
+    WireBaud::Result highSpeedResult;
+    const auto result = calculateBaud(frequencyHz, riseTime, highSpeedResult);
+    if (!result.isValid || (frequencyHz > cFastPlusSpeed && !highSpeedResult.isValid)) {
+        return Status::Error;
+    }
     // Wait until the bus is idle.
     if (hasError(waitForBusIdle(_sercom))) {
         return Status::Error;
@@ -442,7 +624,7 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::setSpeed(uint32_t frequencyHz, Nano
     if (hasError(waitForSyncEnable(_sercom))) {
         return Status::Error;
     }
-    setBaudRegister(frequencyHz, riseTime);
+    setBaudRegister(frequencyHz, riseTime); // Already checked.
     // Enable the SERCOM interface.
     _sercom->I2CM.CTRLA.bit.ENABLE = 1;
     // Wait for synchronization.
@@ -466,18 +648,207 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::setSpeed(uint32_t frequencyHz, Nano
 }
 
 
+void WireMaster_SAMD21::setRecoveryThreshold(uint8_t failureCount)
+{
+    _recoveryThreshold = failureCount;
+    _failureCount = 0;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::recoverBus()
+{
+    ++_recoveryCount;
+    _failureCount = 0;
+    // Disable the interface and take over the pins.
+    _sercom->I2CM.CTRLA.bit.ENABLE = 0;
+    waitForSyncEnable(_sercom); // Ignore timeout.
+    GPIO::setFunction(_pinSDA, GPIO::Function::Disabled);
+    GPIO::setFunction(_pinSCL, GPIO::Function::Disabled);
+    // Emulate open drain outputs, a released line is pulled up.
+    GPIO::setMode(_pinSDA, GPIO::Mode::Input, GPIO::Pull::Up);
+    GPIO::setMode(_pinSCL, GPIO::Mode::Input, GPIO::Pull::Up);
+    waitCycles(cRecoveryHalfPeriod);
+    // Clock SCL until the slave releases SDA, at most 9 times.
+    for (uint8_t i = 0; i < 9 && !GPIO::getState(_pinSDA); ++i) {
+        GPIO::setMode(_pinSCL, GPIO::Mode::Low);
+        waitCycles(cRecoveryHalfPeriod);
+        GPIO::setMode(_pinSCL, GPIO::Mode::Input, GPIO::Pull::Up);
+        waitCycles(cRecoveryHalfPeriod);
+    }
+    // Send a stop condition, SDA goes from low to high while SCL is high.
+    GPIO::setMode(_pinSCL, GPIO::Mode::Low);
+    waitCycles(cRecoveryHalfPeriod);
+    GPIO::setMode(_pinSDA, GPIO::Mode::Low);
+    waitCycles(cRecoveryHalfPeriod);
+    GPIO::setMode(_pinSCL, GPIO::Mode::Input, GPIO::Pull::Up);
+    waitCycles(cRecoveryHalfPeriod);
+    GPIO::setMode(_pinSDA, GPIO::Mode::Input, GPIO::Pull::Up);
+    waitCycles(cRecoveryHalfPeriod);
+    const bool isReleased = GPIO::getState(_pinSDA) && GPIO::getState(_pinSCL);
+    // Re-initialize the interface and give the pins back to it.
+    GPIO::setMode(_pinSDA, GPIO::Mode::HighImpendance);
+    GPIO::setMode(_pinSCL, GPIO::Mode::HighImpendance);
+    const auto status = reset();
+    GPIO::setFunction(_pinSDA, getPinFunction(_interface));
+    GPIO::setFunction(_pinSCL, getPinFunction(_interface));
+    if (hasError(status)) {
+        return status;
+    }
+    return isReleased ? Status::Success : Status::Error;
+}
+
+
+bool WireMaster_SAMD21::isBusFault(Status status) const
+{
+    if (status == Status::Timeout) {
+        return true;
+    }
+    // Errors like a PEC mismatch or an invalid block count are no bus faults.
+    return status == Status::Error && (_sercom->I2CM.STATUS.bit.ARBLOST || hasBusError(_sercom));
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::trackResult(Status status)
+{
+    if (isBusFault(status)) {
+        ++_failureCount;
+        if (_recoveryThreshold != 0 && _failureCount >= _recoveryThreshold) {
+            recoverBus(); // Ignore the result, the status of the transaction is returned.
+        }
+    } else {
+        _failureCount = 0;
+    }
+    return status;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::setRetryPolicy(uint8_t address, const RetryPolicy &policy)
+{
+    if (policy.maxAttempts == 0 || address > 0x7fu) {
+        return Status::Error;
+    }
+    auto entry = findRetryEntry(address);
+    if (entry == nullptr) {
+        for (auto &freeEntry : _retryEntries) {
+            if (!freeEntry.isUsed) {
+                entry = &freeEntry;
+                break;
+            }
+        }
+        if (entry == nullptr) {
+            return Status::Error;
+        }
+    }
+    entry->isUsed = true;
+    entry->address = address;
+    entry->policy = policy;
+    entry->failureCount = 0;
+    entry->isOpen = false;
+    entry->openTick = 0;
+    return Status::Success;
+}
+
+
+void WireMaster_SAMD21::removeRetryPolicy(uint8_t address)
+{
+    auto entry = findRetryEntry(address);
+    if (entry != nullptr) {
+        entry->isUsed = false;
+    }
+}
+
+
+bool WireMaster_SAMD21::isCircuitOpen(uint8_t address) const
+{
+    for (const auto &entry : _retryEntries) {
+        if (entry.isUsed && entry.address == address) {
+            return !isTransactionAllowed(entry);
+        }
+    }
+    return false;
+}
+
+
+void WireMaster_SAMD21::resetCircuit(uint8_t address)
+{
+    auto entry = findRetryEntry(address);
+    if (entry != nullptr) {
+        entry->failureCount = 0;
+        entry->isOpen = false;
+    }
+}
+
+
+WireMaster_SAMD21::RetryEntry* WireMaster_SAMD21::findRetryEntry(uint8_t address)
+{
+    for (auto &entry : _retryEntries) {
+        if (entry.isUsed && entry.address == address) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+
+bool WireMaster_SAMD21::isTransactionAllowed(const RetryEntry &entry) const
+{
+    if (!entry.isOpen) {
+        return true;
+    }
+    // Allow a trial transaction after the timeout.
+    const uint32_t elapsed = static_cast<uint32_t>(Timer::tickMilliseconds().ticks()) - entry.openTick;
+    return elapsed >= static_cast<uint32_t>(entry.policy.breakerTimeout.ticks());
+}
+
+
+bool WireMaster_SAMD21::prepareRetry(const RetryEntry &entry, Status status, uint8_t attempt)
+{
+    if (!hasError(status) || status == Status::NotSupported || attempt >= entry.policy.maxAttempts) {
+        return false;
+    }
+    // Exponential backoff: the delay doubles with every retry, up to the limit.
+    if (entry.policy.backoffMicroseconds > 0) {
+        const uint8_t shift = (attempt > 8) ? 8 : (attempt - 1);
+        auto delay = static_cast<uint32_t>(entry.policy.backoffMicroseconds) << shift;
+        if (delay > cMaximumBackoffMicroseconds) {
+            delay = cMaximumBackoffMicroseconds;
+        }
+        waitCycles(ClockCycles::fromMicroseconds(delay));
+    }
+    return true;
+}
+
+
+void WireMaster_SAMD21::updateCircuit(RetryEntry &entry, Status status)
+{
+    if (!hasError(status)) {
+        entry.failureCount = 0;
+        entry.isOpen = false;
+        return;
+    }
+    if (entry.policy.breakerThreshold == 0) {
+        return;
+    }
+    if (entry.failureCount < 0xffu) {
+        ++entry.failureCount;
+    }
+    // A failed trial transaction or too many failures open the circuit (again).
+    if (entry.isOpen || entry.failureCount >= entry.policy.breakerThreshold) {
+        entry.isOpen = true;
+        entry.openTick = static_cast<uint32_t>(Timer::tickMilliseconds().ticks());
+    }
+}
+
+
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeBegin(uint8_t address)
 {
     WireMaster::Status status;
-    // The data byte is 7bit address + bit 1 = 0 for write.
-    const uint8_t addressData = (address<<1)|static_cast<uint8_t>(0x00);
     // Wait for the bus to be ready.
     if (hasError(status = waitUntilReady(_sercom))) return status;
     // Make sure acknowledge is set.
     if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
     // Send the address and write bit.
-    _sercom->I2CM.ADDR.bit.ADDR = addressData;
-    if (hasError(status = waitForMasterOnBus(_sercom))) return status;
+    if (hasError(status = sendAddress(address, false))) return status;
     // Check if an acknowledge was received.
     if (_sercom->I2CM.STATUS.bit.RXNACK) {
         // Send stop condition, but ignore any timeout.
@@ -493,9 +864,12 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::writeBegin(uint8_t address)
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeByte(uint8_t data)
 {
     WireMaster::Status status;
+    enterPhase(WireStatistics::Phase::Data);
+    updatePec(data);
     // Prepare the data byte to send.
     _sercom->I2CM.DATA.bit.DATA = data;
     if (hasError(status = waitForMasterOnBus(_sercom))) return status;
+    addBytes(1);
     // Check if we received an acknowledge.
     if (_sercom->I2CM.STATUS.bit.RXNACK) {
         // Send stop condition, but ignore any timeout.
@@ -512,6 +886,7 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::writeByte(uint8_t data)
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeEndAndStop()
 {
     WireMaster::Status status;
+    enterPhase(WireStatistics::Phase::Stop);
     // Send a stop condition.
     if (hasError(status = sendCommand(_sercom, Command::Stop))) return status;
     // Wait until the bus is idle to make sure everything was sent.
@@ -531,69 +906,446 @@ WireMaster_SAMD21::Status WireMaster_SAMD21::writeEndAndStart()
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeBytes(uint8_t address, const uint8_t *data, uint8_t count)
 {
-    WireMaster::Status status;
     // Check the parameter.
     if (count == 0 || data == nullptr) return Status::Error;
-    // Start the write with the address.
-    if (hasError(status = writeBegin(address))) return status;
-    // Send the data.
-    for (uint8_t i = 0; i < count; ++i) {
-        if (hasError(status = writeByte(data[i]))) return status;
-    }
-    // Stop the transaction
-    return writeEndAndStop();
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        // Start the write with the address.
+        if (hasError(status = writeBegin(address))) return status;
+        // Send the data.
+        for (uint8_t i = 0; i < count; ++i) {
+            if (hasError(status = writeByte(data[i]))) return status;
+        }
+        // Stop the transaction
+        return writeEndAndStop();
+    });
 }
 
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeRegisterData(uint8_t address, uint8_t registerAddress, uint8_t data)
 {
-    WireMaster::Status status;
-    // Start the write with the address.
-    if (hasError(status = writeBegin(address))) return status;
-    // Send the register address.
-    if (hasError(status = writeByte(registerAddress))) return status;
-    // Send the byte.
-    if (hasError(status = writeByte(data))) return status;
-    // Stop the transaction
-    return writeEndAndStop();
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        // Start the write with the address.
+        if (hasError(status = writeBegin(address))) return status;
+        // Send the register address.
+        if (hasError(status = writeByte(registerAddress))) return status;
+        // Send the byte.
+        if (hasError(status = writeByte(data))) return status;
+        // Stop the transaction
+        return writeEndAndStop();
+    });
 }
 
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::writeRegisterData(uint8_t address, uint8_t registerAddress, const uint8_t *data, uint8_t count)
 {
-    WireMaster::Status status;
     // Check the parameter.
     if (count == 0 || data == nullptr) return Status::Error;
-    // Check if there is an error on the bus.
-    if (hasError(status = writeBegin(address))) return status;
-    if (hasError(status = writeByte(registerAddress))) return status;
-    for (uint8_t i = 0; i < count; ++i) {
-        if (hasError(status = writeByte(data[i]))) return status;
-    }
-    return writeEndAndStop();
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        // Check if there is an error on the bus.
+        if (hasError(status = writeBegin(address))) return status;
+        if (hasError(status = writeByte(registerAddress))) return status;
+        for (uint8_t i = 0; i < count; ++i) {
+            if (hasError(status = writeByte(data[i]))) return status;
+        }
+        return writeEndAndStop();
+    });
 }
 
 
 WireMaster_SAMD21::Status WireMaster_SAMD21::readBytes(uint8_t address, uint8_t *data, uint8_t count)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        // Wait for the bus to be ready.
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        // Make sure acknowledge is set.
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        // Send the address and wait for acknowledge + bit 1 = 1 for read.
+        if (hasError(status = sendAddress(address, true))) return status;
+        // Start reading the bytes.
+        return readBytesAfterAcknowledge(data, count);
+    });
+}
+
+
+WireMaster::Status WireMaster_SAMD21::readBytesAfterAcknowledge(uint8_t *data, uint16_t count, bool stop)
 {
     WireMaster::Status status;
+    // Check the parameter. The address was already sent, so release the bus.
+    if (count == 0 || data == nullptr) {
+        sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No); // Ignore timeout.
+        waitForBusIdle(_sercom); // Ignore timeout.
+        return Status::Error;
+    }
+    // Check if an acknowledge was received.
+    if (_sercom->I2CM.STATUS.bit.RXNACK) {
+        // No... send a stop.
+        sendCommand(_sercom, Command::Stop); // Ignore timeout.
+        return WireMaster::Status::AddressNotFound;
+    }
+    enterPhase(WireStatistics::Phase::Data);
+    // Stream all bytes except the last one. The ACK action is already set before the
+    // address was sent. In smart mode, reading DATA sends the ACK and starts the read of
+    // the next byte, so there is no command and no synchronization per byte.
+    const uint16_t lastIndex = count - 1;
+    for (uint16_t i = 0; i < lastIndex; ++i) {
+        data[i] = _sercom->I2CM.DATA.bit.DATA;
+        updatePec(data[i]);
+        // Wait for the next byte.
+        if (hasError(status = waitForSlaveOnBus(_sercom))) return status;
+    }
+    // No acknowledge (NACK) + stop for the last byte, or keep the bus for a repeated start.
+    if (stop) {
+        enterPhase(WireStatistics::Phase::Stop);
+        if (hasError(status = sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No))) return status;
+    } else {
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::No))) return status;
+    }
+    // Read the last byte from the register.
+    data[lastIndex] = _sercom->I2CM.DATA.bit.DATA;
+    updatePec(data[lastIndex]);
+    if (hasError(status = waitForSystemOperation(_sercom))) return status;
+    addBytes(count);
+    if (stop) {
+        // Wait until the bus is idle to make sure everything was sent.
+        if (hasError(status = waitForBusIdle(_sercom))) return status;
+    }
+    return Status::Success;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readRegisterData(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count)
+{
     // Check the parameter.
     if (count == 0 || data == nullptr) return Status::Error;
-    // Wait for the bus to be ready.
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        // Start writing an address.
+        if (hasError(status = writeBegin(address))) return status;
+        // Write a byte with the register address.
+        if (hasError(status = writeByte(registerAddress))) return status;
+        // Wait for the bus to be ready.
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        // Make sure acknowledge is set.
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        // Send the address and wait for acknowledge + bit 1 = 1 for read.
+        if (hasError(status = sendAddress(address, true))) return status;
+        // Start reading the bytes.
+        return readBytesAfterAcknowledge(data, count);
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeBlock(uint8_t address, const uint8_t *data, uint16_t count)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeBegin(address))) return status;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (hasError(status = writeByte(data[i]))) return status;
+        }
+        return writeEndAndStop();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readBlock(uint8_t address, uint8_t *data, uint16_t count)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        if (hasError(status = sendAddress(address, true))) return status;
+        return readBytesAfterAcknowledge(data, count);
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeMemory(uint8_t address, uint16_t memoryAddress, const uint8_t *data, uint16_t count)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeMemoryAddress(address, memoryAddress))) return status;
+        for (uint16_t i = 0; i < count; ++i) {
+            if (hasError(status = writeByte(data[i]))) return status;
+        }
+        return writeEndAndStop();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readMemory(uint8_t address, uint16_t memoryAddress, uint8_t *data, uint16_t count)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeMemoryAddress(address, memoryAddress))) return status;
+        // Send a repeated start with the read address.
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        if (hasError(status = sendAddress(address, true))) return status;
+        return readBytesAfterAcknowledge(data, count);
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readMemoryStream(uint8_t address, uint16_t memoryAddress, uint32_t count,
+    ReadRingBuffer &buffer, StreamCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || buffer.data == nullptr || buffer.size < 2 || callback == nullptr) return Status::Error;
+    uint32_t storedCount = 0;
+    return runTransaction(address, [=, &buffer, &storedCount]() -> Status {
+        WireMaster::Status status;
+        // A retry resumes after the bytes which were already stored in the buffer.
+        if (storedCount == count) {
+            callback(context, buffer);
+            return Status::Success;
+        }
+        const auto resumeAddress = static_cast<uint16_t>(memoryAddress + storedCount);
+        if (hasError(status = writeMemoryAddress(address, resumeAddress))) return status;
+        // Send a repeated start with the read address.
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        if (hasError(status = sendAddress(address, true))) return status;
+        return readStreamAfterAcknowledge(count - storedCount, buffer, callback, context, storedCount);
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeSegments(uint8_t address, const WriteSegment *segments, uint8_t segmentCount)
+{
+    // Check the parameter.
+    if (segments == nullptr) return Status::Error;
+    bool hasData = false;
+    for (uint8_t i = 0; i < segmentCount; ++i) {
+        if (segments[i].size > 0) {
+            if (segments[i].data == nullptr) return Status::Error;
+            hasData = true;
+        }
+    }
+    if (!hasData) return Status::Error;
+    return runTransaction(address, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeBegin(address))) return status;
+        for (uint8_t i = 0; i < segmentCount; ++i) {
+            const auto &segment = segments[i];
+            for (uint16_t j = 0; j < segment.size; ++j) {
+                if (hasError(status = writeByte(segment.data[j]))) return status;
+            }
+        }
+        return writeEndAndStop();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusWriteByte(uint8_t address, uint8_t command, uint8_t value, bool usePec)
+{
+    return runSmBusTransaction(address, usePec, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeBegin(address))) return status;
+        if (hasError(status = writeByte(command))) return status;
+        if (hasError(status = writeByte(value))) return status;
+        return smBusWriteEnd();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusReadByte(uint8_t address, uint8_t command, uint8_t &value, bool usePec)
+{
+    return runSmBusTransaction(address, usePec, [=, &value]() -> Status {
+        WireMaster::Status status;
+        uint8_t data[2];
+        if (hasError(status = smBusStartRead(address, command))) return status;
+        if (hasError(status = smBusReadEnd(data, 1))) return status;
+        value = data[0];
+        return Status::Success;
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusWriteWord(uint8_t address, uint8_t command, uint16_t value, bool usePec)
+{
+    return runSmBusTransaction(address, usePec, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeBegin(address))) return status;
+        if (hasError(status = writeByte(command))) return status;
+        if (hasError(status = writeByte(static_cast<uint8_t>(value & 0xffu)))) return status;
+        if (hasError(status = writeByte(static_cast<uint8_t>(value >> 8u)))) return status;
+        return smBusWriteEnd();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusReadWord(uint8_t address, uint8_t command, uint16_t &value, bool usePec)
+{
+    return runSmBusTransaction(address, usePec, [=, &value]() -> Status {
+        WireMaster::Status status;
+        uint8_t data[3];
+        if (hasError(status = smBusStartRead(address, command))) return status;
+        if (hasError(status = smBusReadEnd(data, 2))) return status;
+        value = static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8u));
+        return Status::Success;
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusBlockWrite(uint8_t address, uint8_t command, const uint8_t *data,
+    uint8_t count, bool usePec)
+{
+    // Check the parameter.
+    if (count == 0 || count > cSmBusBlockSize || data == nullptr) return Status::Error;
+    return runSmBusTransaction(address, usePec, [=]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = writeBegin(address))) return status;
+        if (hasError(status = writeByte(command))) return status;
+        if (hasError(status = writeByte(count))) return status;
+        for (uint8_t i = 0; i < count; ++i) {
+            if (hasError(status = writeByte(data[i]))) return status;
+        }
+        return smBusWriteEnd();
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusBlockRead(uint8_t address, uint8_t command, uint8_t *data,
+    uint8_t &count, bool usePec)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr) return Status::Error;
+    const uint8_t bufferSize = count;
+    return runSmBusTransaction(address, usePec, [=, &count]() -> Status {
+        WireMaster::Status status;
+        if (hasError(status = smBusStartRead(address, command))) return status;
+        // Check if an acknowledge was received.
+        if (_sercom->I2CM.STATUS.bit.RXNACK) {
+            sendCommand(_sercom, Command::Stop); // Ignore timeout.
+            return WireMaster::Status::AddressNotFound;
+        }
+        enterPhase(WireStatistics::Phase::Data);
+        uint8_t blockSize;
+        if (hasError(status = readNextByte(blockSize, false))) return status;
+        if (blockSize == 0 || blockSize > cSmBusBlockSize || blockSize > bufferSize) {
+            // Receive the next byte with a NACK to end the transaction.
+            uint8_t ignored;
+            readNextByte(ignored, true); // Ignore errors.
+            return Status::Error;
+        }
+        for (uint8_t i = 0; i < blockSize; ++i) {
+            const bool isLast = (i + 1u == blockSize) && !_pecActive;
+            if (hasError(status = readNextByte(data[i], isLast))) return status;
+        }
+        if (_pecActive) {
+            uint8_t pec;
+            if (hasError(status = readNextByte(pec, true))) return status;
+            if (_pec != 0) return Status::Error;
+        }
+        count = blockSize;
+        return Status::Success;
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusProcessCall(uint8_t address, uint8_t command, uint16_t value,
+    uint16_t &result, bool usePec)
+{
+    return runSmBusTransaction(address, usePec, [=, &result]() -> Status {
+        WireMaster::Status status;
+        uint8_t data[3];
+        if (hasError(status = writeBegin(address))) return status;
+        if (hasError(status = writeByte(command))) return status;
+        if (hasError(status = writeByte(static_cast<uint8_t>(value & 0xffu)))) return status;
+        if (hasError(status = writeByte(static_cast<uint8_t>(value >> 8u)))) return status;
+        // Send a repeated start with the read address.
+        if (hasError(status = waitUntilReady(_sercom))) return status;
+        if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+        if (hasError(status = sendAddress(address, true))) return status;
+        if (hasError(status = smBusReadEnd(data, 2))) return status;
+        result = static_cast<uint16_t>(data[0] | (static_cast<uint16_t>(data[1]) << 8u));
+        return Status::Success;
+    });
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusStartRead(uint8_t address, uint8_t command)
+{
+    WireMaster::Status status;
+    if (hasError(status = writeBegin(address))) return status;
+    if (hasError(status = writeByte(command))) return status;
+    // Send a repeated start with the read address.
     if (hasError(status = waitUntilReady(_sercom))) return status;
-    // Make sure acknowledge is set.
     if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
-    // Send the address and wait for acknowledge + bit 1 = 1 for read.
-    const uint8_t addressData = (address<<1u)|static_cast<uint8_t>(0x01u);
-    // Send the address.
-    _sercom->I2CM.ADDR.bit.ADDR = addressData;
-    if (hasError(status = waitForSlaveOnBus(_sercom))) return status;
-    // Start reading the bytes.
-    return readBytesAfterAcknowledge(data, count);
+    return sendAddress(address, true);
 }
 
 
-WireMaster::Status WireMaster_SAMD21::readBytesAfterAcknowledge(uint8_t *data, uint8_t count)
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusWriteEnd()
+{
+    WireMaster::Status status;
+    if (_pecActive) {
+        if (hasError(status = writeByte(_pec))) return status;
+    }
+    return writeEndAndStop();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::smBusReadEnd(uint8_t *data, uint8_t count)
+{
+    WireMaster::Status status;
+    // Read the PEC with the data, the PEC over the data and its PEC is zero.
+    const uint8_t readCount = _pecActive ? (count + 1u) : count;
+    if (hasError(status = readBytesAfterAcknowledge(data, readCount))) return status;
+    if (_pecActive && _pec != 0) {
+        return Status::Error;
+    }
+    return Status::Success;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readNextByte(uint8_t &value, bool isLast)
+{
+    WireMaster::Status status;
+    if (!isLast) {
+        // Reading the data acknowledges the byte and starts the next read.
+        value = _sercom->I2CM.DATA.bit.DATA;
+        updatePec(value);
+        addBytes(1);
+        return waitForSlaveOnBus(_sercom);
+    }
+    // No acknowledge (NACK) + stop for the last byte.
+    enterPhase(WireStatistics::Phase::Stop);
+    if (hasError(status = sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No))) return status;
+    value = _sercom->I2CM.DATA.bit.DATA;
+    updatePec(value);
+    addBytes(1);
+    if (hasError(status = waitForSystemOperation(_sercom))) return status;
+    return waitForBusIdle(_sercom);
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeMemoryAddress(uint8_t address, uint16_t memoryAddress)
+{
+    WireMaster::Status status;
+    if (hasError(status = writeBegin(address))) return status;
+    if (hasError(status = writeByte(static_cast<uint8_t>(memoryAddress >> 8u)))) return status;
+    return writeByte(static_cast<uint8_t>(memoryAddress & 0xffu));
+}
+
+
+WireMaster::Status WireMaster_SAMD21::readStreamAfterAcknowledge(uint32_t count, ReadRingBuffer &buffer,
+    StreamCallback callback, void *context, uint32_t &storedCount)
 {
     WireMaster::Status status;
     // Check if an acknowledge was received.
@@ -602,55 +1354,431 @@ WireMaster::Status WireMaster_SAMD21::readBytesAfterAcknowledge(uint8_t *data, u
         sendCommand(_sercom, Command::Stop); // Ignore timeout.
         return WireMaster::Status::AddressNotFound;
     }
-    for (uint8_t i = 0; i < count; ++i) {
-        // After the first byte, which is read after the address
-        // send a read command.
-        if (i != 0) {
-            // Send the ACK and start a read operation.
-            if (hasError(status = sendCommand(_sercom, Command::ByteRead))) return status;
-            // Wait for the read operation to finish.
-            if (hasError(status = waitForSlaveOnBus(_sercom))) return status;
+    enterPhase(WireStatistics::Phase::Data);
+    const uint32_t lastIndex = count - 1;
+    for (uint32_t i = 0; i < count; ++i) {
+        // The next byte is waiting in the data register, the clock is stretched until it is read.
+        const uint16_t nextWriteIndex = static_cast<uint16_t>((buffer.writeIndex + 1u) % buffer.size);
+        if (nextWriteIndex == buffer.readIndex) {
+            callback(context, buffer);
+            if (nextWriteIndex == buffer.readIndex) {
+                // No space was freed, stop the transaction.
+                sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No); // Ignore timeout.
+                waitForBusIdle(_sercom); // Ignore timeout.
+                return Status::Error;
+            }
         }
-        // Last byte?
-        const bool lastByte = ((i+1)==count);
-        if (lastByte) {
-            // No acknowledge (NACK) + stop.
-            if (hasError(status = setAcknowledge(_sercom, Acknowledge::No))) return status;
-            if (hasError(status = sendCommand(_sercom, Command::Stop))) return status;
+        if (i < lastIndex) {
+            // Reading the data acknowledges the byte and starts the next read.
+            buffer.data[buffer.writeIndex] = _sercom->I2CM.DATA.bit.DATA;
+            buffer.writeIndex = nextWriteIndex;
+            ++storedCount;
+            if (hasError(status = waitForSlaveOnBus(_sercom))) return status;
         } else {
-            // Set the acknowledge bit.
-            if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+            // No acknowledge (NACK) + stop for the last byte.
+            enterPhase(WireStatistics::Phase::Stop);
+            if (hasError(status = sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No))) return status;
+            buffer.data[buffer.writeIndex] = _sercom->I2CM.DATA.bit.DATA;
+            buffer.writeIndex = nextWriteIndex;
+            ++storedCount;
+            if (hasError(status = waitForSystemOperation(_sercom))) return status;
+            if (hasError(status = waitForBusIdle(_sercom))) return status;
         }
-        // Read the byte from the register and trigger ACK/NACK
-        data[i] = _sercom->I2CM.DATA.bit.DATA;
-        if (hasError(status = waitForSystemOperation(_sercom))) return status;
+        addBytes(1);
     }
-    // Wait until the bus is idle to make sure everything was sent.
-    if (hasError(status = waitForBusIdle(_sercom))) return status;
+    callback(context, buffer);
     return Status::Success;
 }
 
 
-WireMaster_SAMD21::Status WireMaster_SAMD21::readRegisterData(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count)
+WireMaster_SAMD21::Status WireMaster_SAMD21::transferBatch(RegisterTransfer *transfers, uint8_t count, uint32_t *busCycles)
 {
     WireMaster::Status status;
-    // Start writing an address.
-    if (hasError(status = writeBegin(address))) return status;
-    // Write a byte with the register address.
-    if (hasError(status = writeByte(registerAddress))) return status;
+    // Check the parameter.
+    if (count == 0 || transfers == nullptr) return Status::Error;
     // Wait for the bus to be ready.
-    if (hasError(status = waitUntilReady(_sercom))) return status;
+    if (hasError(status = waitUntilReady(_sercom))) return trackResult(status);
+    const auto startCycles = ClockCycles::getCounter();
+    auto result = Status::Success;
+    for (uint8_t i = 0; i < count; ++i) {
+        auto &transfer = transfers[i];
+        // Skip devices with an open circuit, without accessing the bus.
+        auto retry = findRetryEntry(transfer.address);
+        if (retry != nullptr && !isTransactionAllowed(*retry)) {
+            transfer.status = Status::AddressNotFound;
+            if (result == Status::Success) {
+                result = transfer.status;
+            }
+            continue;
+        }
+        // While the bus is owned, writing the address sends a repeated start.
+        beginStatistics(transfer.address);
+        transfer.status = transferBatchEntry(transfer);
+        endStatistics(transfer.status);
+        if (retry != nullptr) {
+            updateCircuit(*retry, transfer.status);
+        }
+        if (hasError(transfer.status) && result == Status::Success) {
+            result = transfer.status;
+        }
+        // A timeout or bus error ends the batch.
+        if (transfer.status == Status::Timeout || transfer.status == Status::Error) {
+            for (uint8_t j = i + 1; j < count; ++j) {
+                transfers[j].status = transfer.status;
+            }
+            break;
+        }
+    }
+    // Stop the batch, ignore any timeout.
+    sendCommand(_sercom, Command::Stop);
+    waitForBusIdle(_sercom);
+    if (busCycles != nullptr) {
+        *busCycles = ClockCycles::getCounter() - startCycles;
+    }
+    trackResult(result);
+    return result;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::transferBatchEntry(const RegisterTransfer &transfer)
+{
+    WireMaster::Status status;
+    if (transfer.count == 0 || transfer.data == nullptr) return Status::Error;
     // Make sure acknowledge is set.
     if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
-    // Send the address and wait for acknowledge + bit 1 = 1 for read.
-    const uint8_t addressData = (address<<1u)|static_cast<uint8_t>(0x01u);
-    // Send the address.
-    _sercom->I2CM.ADDR.bit.ADDR = addressData;
-    if (hasError(status = waitForSlaveOnBus(_sercom))) return status;
-    // Start reading the bytes.
-    return readBytesAfterAcknowledge(data, count);
+    // Send the address and write bit.
+    if (hasError(status = sendAddress(transfer.address, false))) return status;
+    if (_sercom->I2CM.STATUS.bit.RXNACK) return Status::AddressNotFound;
+    // Send the register address.
+    _sercom->I2CM.DATA.bit.DATA = transfer.registerAddress;
+    if (hasError(status = waitForMasterOnBus(_sercom))) return status;
+    if (_sercom->I2CM.STATUS.bit.RXNACK) return Status::NoAcknowledge;
+    if (transfer.direction == Direction::Write) {
+        for (uint8_t i = 0; i < transfer.count; ++i) {
+            _sercom->I2CM.DATA.bit.DATA = transfer.data[i];
+            if (hasError(status = waitForMasterOnBus(_sercom))) return status;
+            if (_sercom->I2CM.STATUS.bit.RXNACK) return Status::NoAcknowledge;
+        }
+        return Status::Success;
+    }
+    // Send a repeated start with the read address.
+    if (hasError(status = sendAddress(transfer.address, true))) {
+        return (status == Status::NoAcknowledge) ? Status::AddressNotFound : status;
+    }
+    // Read the data, the last byte is answered with a NACK and the bus is kept.
+    return readBytesAfterAcknowledge(transfer.data, transfer.count, false);
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeBytesAsync(uint8_t address, const uint8_t *data, uint8_t count,
+    AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy()) return Status::Error;
+    _async = AsyncTransaction{callback, context, data, nullptr, address, 0, false, count, 0, false};
+    return startAsync();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeRegisterDataAsync(uint8_t address, uint8_t registerAddress,
+    const uint8_t *data, uint8_t count, AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy()) return Status::Error;
+    _async = AsyncTransaction{callback, context, data, nullptr, address, registerAddress, true, count, 0, false};
+    return startAsync();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readBytesAsync(uint8_t address, uint8_t *data, uint8_t count,
+    AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy()) return Status::Error;
+    _async = AsyncTransaction{callback, context, nullptr, data, address, 0, false, count, 0, false};
+    return startAsync();
 }
 
 
+WireMaster_SAMD21::Status WireMaster_SAMD21::readRegisterDataAsync(uint8_t address, uint8_t registerAddress,
+    uint8_t *data, uint8_t count, AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy()) return Status::Error;
+    _async = AsyncTransaction{callback, context, nullptr, data, address, registerAddress, true, count, 0, false};
+    return startAsync();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::setDmaChannel(uint8_t channel)
+{
+    if (channel >= Dma::cChannelCount || isAsyncBusy()) return Status::Error;
+    if (!Dma::initialize()) return Status::Timeout;
+    _dmaChannel = channel;
+    return Status::Success;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeBytesDma(uint8_t address, const uint8_t *data, uint8_t count,
+    AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy() || _dmaChannel == cNoDmaChannel) return Status::Error;
+    _async = AsyncTransaction{callback, context, data, nullptr, address, 0, false, count, 0, true};
+    return startAsync();
 }
 
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::writeRegisterDataDma(uint8_t address, uint8_t registerAddress,
+    const uint8_t *data, uint8_t count, AsyncCallback callback, void *context)
+{
+    // Check the parameter, the register address is part of the length.
+    if (count == 0 || count == 0xffu || data == nullptr || isAsyncBusy() || _dmaChannel == cNoDmaChannel) {
+        return Status::Error;
+    }
+    _async = AsyncTransaction{callback, context, data, nullptr, address, registerAddress, true, count, 0, true};
+    return startAsync();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readBytesDma(uint8_t address, uint8_t *data, uint8_t count,
+    AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy() || _dmaChannel == cNoDmaChannel) return Status::Error;
+    _async = AsyncTransaction{callback, context, nullptr, data, address, 0, false, count, 0, true};
+    return startAsync();
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::readRegisterDataDma(uint8_t address, uint8_t registerAddress,
+    uint8_t *data, uint8_t count, AsyncCallback callback, void *context)
+{
+    // Check the parameter.
+    if (count == 0 || data == nullptr || isAsyncBusy() || _dmaChannel == cNoDmaChannel) return Status::Error;
+    _async = AsyncTransaction{callback, context, nullptr, data, address, registerAddress, true, count, 0, true};
+    return startAsync();
+}
+
+
+bool WireMaster_SAMD21::isBusFree() const
+{
+    return isBusReady(_sercom);
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::startAsync()
+{
+    WireMaster::Status status;
+    // Do not wait for the bus, this may be called from an interrupt or with disabled interrupts.
+    if (hasBusError(_sercom)) return Status::Error;
+    if (!isBusReady(_sercom)) return Status::Timeout;
+    // Make sure acknowledge is set, smart mode will acknowledge every read of DATA.
+    if (hasError(status = setAcknowledge(_sercom, Acknowledge::Yes))) return status;
+    // Clear a stale error flag and enable the error interrupt.
+    _sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR;
+    _sercom->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_ERROR;
+    // DMA transfers which start with the data are completely handled by the DMA controller.
+    if (_async.useDma && (_async.writeData != nullptr || !_async.sendRegister)) {
+        return startDma(_async.readData != nullptr);
+    }
+    // Start with the write address if there is data or a register to write.
+    uint8_t addressData;
+    if (_async.sendRegister || _async.writeData != nullptr) {
+        _asyncPhase = AsyncPhase::Address;
+        addressData = (_async.address<<1u)|static_cast<uint8_t>(0x00u);
+    } else {
+        _asyncPhase = AsyncPhase::ReadAddress;
+        addressData = (_async.address<<1u)|static_cast<uint8_t>(0x01u);
+    }
+    // Enable the bus interrupts.
+    _sercom->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_MB|SERCOM_I2CM_INTENSET_SB;
+    // Send the address, everything else happens in the interrupt.
+    writeAddressRegister(addressData, isHighSpeedAddress(_async.address));
+    return Status::Success;
+}
+
+
+WireMaster_SAMD21::Status WireMaster_SAMD21::startDma(bool read)
+{
+    const auto sercomIndex = getSercomIndex();
+    auto &descriptor = Dma::getDescriptor(_dmaChannel);
+    uint8_t length = _async.count;
+    uint8_t trigger;
+    if (read) {
+        _asyncPhase = AsyncPhase::DmaRead;
+        Dma::prepareDescriptor(descriptor, &_sercom->I2CM.DATA.reg, false, _async.readData, true, _async.count);
+        trigger = Dma::getSercomRxTrigger(sercomIndex);
+    } else {
+        _asyncPhase = AsyncPhase::DmaWrite;
+        if (_async.sendRegister) {
+            // Chain the register address and the data.
+            _async.sendRegister = false;
+            Dma::prepareDescriptor(_dmaDescriptor, _async.writeData, true, &_sercom->I2CM.DATA.reg, false,
+                _async.count);
+            Dma::prepareDescriptor(descriptor, &_async.registerAddress, false, &_sercom->I2CM.DATA.reg, false,
+                1, &_dmaDescriptor);
+            length += 1;
+        } else {
+            Dma::prepareDescriptor(descriptor, _async.writeData, true, &_sercom->I2CM.DATA.reg, false,
+                _async.count);
+        }
+        trigger = Dma::getSercomTxTrigger(sercomIndex);
+    }
+    // The DMA controller owns the data register, MB is its trigger for writes.
+    _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB|SERCOM_I2CM_INTENCLR_SB;
+    if (!Dma::startTransfer(_dmaChannel, trigger, [](void *context, bool success) {
+        static_cast<WireMaster_SAMD21*>(context)->handleDmaComplete(success);
+    }, this)) {
+        _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_ERROR;
+        _asyncPhase = AsyncPhase::Idle;
+        return Status::Timeout;
+    }
+    // Writing the address with the length starts the transfer.
+    uint32_t addressRegister = SERCOM_I2CM_ADDR_ADDR((_async.address<<1u)|(read ? 0x01u : 0x00u))|
+        SERCOM_I2CM_ADDR_LENEN|SERCOM_I2CM_ADDR_LEN(length);
+    if (isHighSpeedAddress(_async.address)) {
+        addressRegister |= SERCOM_I2CM_ADDR_HS;
+    }
+    _sercom->I2CM.ADDR.reg = addressRegister;
+    if (read) {
+        // For reads, the master on bus flag only signals a NACK for the address.
+        _sercom->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_MB;
+    }
+    // For writes, a NACK stops the transfer with a length error and the error interrupt.
+    return Status::Success;
+}
+
+
+void WireMaster_SAMD21::handleDmaComplete(bool success)
+{
+    if (!success) {
+        sendCommand(_sercom, Command::Stop); // Ignore timeout.
+        finishAsync(Status::Error);
+    } else if (_asyncPhase == AsyncPhase::DmaRead) {
+        // The interface sent the NACK and stop condition after the last byte.
+        _async.index = _async.count;
+        finishAsync(Status::Success);
+    } else {
+        // The last byte is still on the way, the MB interrupt finishes the transaction.
+        // The DMA controller is done, so the interrupt can not race its writes anymore.
+        _async.index = _async.count;
+        _sercom->I2CM.INTENSET.reg = SERCOM_I2CM_INTENSET_MB;
+    }
+}
+
+
+void WireMaster_SAMD21::finishAsync(Status status)
+{
+    // Disable the interrupts until the next transaction.
+    _sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MB|SERCOM_I2CM_INTENCLR_SB|SERCOM_I2CM_INTENCLR_ERROR;
+    _asyncStatus = status;
+    _asyncPhase = AsyncPhase::Idle;
+    if (_async.callback != nullptr) {
+        _async.callback(_async.context, status);
+    }
+}
+
+
+void WireMaster_SAMD21::handleInterrupt()
+{
+    const uint8_t flags = _sercom->I2CM.INTFLAG.reg;
+    if (_asyncPhase == AsyncPhase::Idle) {
+        return;
+    }
+    // Bus errors and hardware timeouts end the transaction.
+    if ((flags & SERCOM_I2CM_INTFLAG_ERROR) != 0) {
+        _sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR;
+        if (_async.useDma) {
+            Dma::abortTransfer(_dmaChannel);
+        }
+        if (_asyncPhase == AsyncPhase::DmaWrite && _sercom->I2CM.STATUS.bit.LENERR &&
+            _sercom->I2CM.STATUS.bit.RXNACK) {
+            // A NACK during a DMA write, the interface already sent the stop condition.
+            finishAsync(Status::NoAcknowledge);
+            return;
+        }
+        sendCommand(_sercom, Command::Stop); // Ignore timeout.
+        finishAsync(Status::Error);
+        return;
+    }
+    if (_asyncPhase == AsyncPhase::DmaWrite) {
+        if ((flags & SERCOM_I2CM_INTFLAG_MB) == 0) {
+            return;
+        }
+        if (_sercom->I2CM.STATUS.bit.RXNACK || _sercom->I2CM.STATUS.bit.ARBLOST || hasBusError(_sercom)) {
+            // A NACK for the last byte, lost arbitration or a bus error.
+            sendCommand(_sercom, Command::Stop); // Ignore timeout.
+            finishAsync(_sercom->I2CM.STATUS.bit.RXNACK ? Status::NoAcknowledge : Status::Error);
+        } else if (_async.index == _async.count) {
+            // The last byte was acknowledged, the interface sends the stop condition.
+            _sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_MB;
+            finishAsync(Status::Success);
+        }
+        return;
+    }
+    if (_asyncPhase == AsyncPhase::DmaRead) {
+        // A NACK for the read address.
+        if ((flags & SERCOM_I2CM_INTFLAG_MB) != 0) {
+            Dma::abortTransfer(_dmaChannel);
+            sendCommand(_sercom, Command::Stop); // Ignore timeout.
+            finishAsync(Status::AddressNotFound);
+        }
+        return;
+    }
+    if ((flags & SERCOM_I2CM_INTFLAG_MB) != 0) {
+        // Lost arbitration or bus error.
+        if (_sercom->I2CM.STATUS.bit.ARBLOST || hasBusError(_sercom)) {
+            _sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_MB;
+            finishAsync(Status::Error);
+            return;
+        }
+        // A NACK for the address or a data byte. For a read, MB is only set on a NACK.
+        if (_sercom->I2CM.STATUS.bit.RXNACK || _asyncPhase == AsyncPhase::ReadAddress) {
+            sendCommand(_sercom, Command::Stop); // Ignore timeout.
+            if (_asyncPhase == AsyncPhase::Write) {
+                finishAsync(Status::NoAcknowledge);
+            } else {
+                finishAsync(Status::AddressNotFound);
+            }
+            return;
+        }
+        _asyncPhase = AsyncPhase::Write;
+        if (_async.sendRegister) {
+            _async.sendRegister = false;
+            _sercom->I2CM.DATA.bit.DATA = _async.registerAddress;
+        } else if (_async.writeData != nullptr && _async.index < _async.count) {
+            _sercom->I2CM.DATA.bit.DATA = _async.writeData[_async.index++];
+        } else if (_async.readData != nullptr && _async.useDma) {
+            // Send a repeated start and read the data using DMA.
+            if (hasError(startDma(true))) {
+                sendCommand(_sercom, Command::Stop); // Ignore timeout.
+                finishAsync(Status::Timeout);
+            }
+        } else if (_async.readData != nullptr) {
+            // Send a repeated start with the read address.
+            _asyncPhase = AsyncPhase::ReadAddress;
+            writeAddressRegister((_async.address<<1u)|static_cast<uint8_t>(0x01u), isHighSpeedAddress(_async.address));
+        } else {
+            sendCommand(_sercom, Command::Stop); // Ignore timeout.
+            finishAsync(Status::Success);
+        }
+        return;
+    }
+    if ((flags & SERCOM_I2CM_INTFLAG_SB) != 0) {
+        _asyncPhase = AsyncPhase::Read;
+        const bool lastByte = ((_async.index+1) == _async.count);
+        if (lastByte) {
+            // No acknowledge (NACK) + stop, before the last byte is read.
+            sendCommandAcknowledgeAddress(_sercom, Command::Stop, Acknowledge::No); // Ignore timeout.
+            _async.readData[_async.index++] = _sercom->I2CM.DATA.bit.DATA;
+            finishAsync(Status::Success);
+        } else {
+            // In smart mode, reading the data sends the ACK and starts the next read.
+            _async.readData[_async.index++] = _sercom->I2CM.DATA.bit.DATA;
+        }
+    }
+}
+
+
+}
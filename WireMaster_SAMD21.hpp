@@ -21,6 +21,9 @@
 
 
 #include "GPIO_SAMD21.hpp"
+#include "WireStatistics_SAMD21.hpp"
+#include "SmBusPec.hpp"
+#include "WireBaud_SAMD21.hpp"
 
 #include "hal-core/Chip.hpp"
 #include "hal-common/WireMaster.hpp"
@@ -58,6 +61,79 @@ public:
         SerCom5Alt  = 0x15, ///< Use SERCOM5 alternative pin configuration
     };
 
+    /// The callback for a finished asynchronous transaction.
+    ///
+    /// This callback is called from the SERCOM interrupt handler. Keep it short.
+    ///
+    /// @param context The context pointer passed with the transaction.
+    /// @param status The final status of the transaction.
+    ///
+    using AsyncCallback = void(*)(void *context, Status status);
+
+    /// The retry policy for a device.
+    ///
+    struct RetryPolicy {
+        uint8_t maxAttempts; ///< The maximum number of attempts, including the first one.
+        uint16_t backoffMicroseconds; ///< The delay before the first retry, doubled for every further retry.
+        uint8_t breakerThreshold; ///< The number of failed transactions to open the circuit, or zero to disable it.
+        Milliseconds breakerTimeout; ///< The time until an open circuit allows a trial transaction.
+    };
+
+    /// The number of devices with a retry policy.
+    ///
+    static constexpr uint8_t cRetryPolicyCount = 4;
+
+    /// The maximum delay between two attempts of a transaction.
+    ///
+    static constexpr uint32_t cMaximumBackoffMicroseconds = 10000;
+
+    /// One segment of a scatter-gather write.
+    ///
+    struct WriteSegment {
+        const uint8_t *data; ///< The data of the segment.
+        uint16_t size; ///< The number of bytes in the segment, can be zero.
+    };
+
+    /// A ring buffer for streaming reads.
+    ///
+    /// The driver writes at `writeIndex`, the consumer reads at `readIndex`. The buffer is
+    /// empty if both indexes are equal and full if `writeIndex` is just before `readIndex`,
+    /// so it holds at most `size - 1` bytes.
+    ///
+    struct ReadRingBuffer {
+        uint8_t *data; ///< The memory of the buffer.
+        uint16_t size; ///< The size of the buffer in bytes, at least 2.
+        uint16_t writeIndex; ///< The next write position, advanced by the driver.
+        uint16_t readIndex; ///< The next read position, advanced by the consumer.
+    };
+
+    /// The callback to drain a ring buffer of a streaming read.
+    ///
+    /// The callback has to consume bytes from the buffer and advance `readIndex`.
+    ///
+    /// @param context The context pointer passed to the read.
+    /// @param buffer The ring buffer to drain.
+    ///
+    using StreamCallback = void(*)(void *context, ReadRingBuffer &buffer);
+
+    /// The direction of a register transfer.
+    ///
+    enum class Direction : uint8_t {
+        Read, ///< Read data from the register.
+        Write, ///< Write data to the register.
+    };
+
+    /// One register transfer in a batch.
+    ///
+    struct RegisterTransfer {
+        uint8_t address; ///< The 7bit address of the device.
+        uint8_t registerAddress; ///< The register address.
+        uint8_t *data; ///< The buffer for the data. For writes, the data is only read.
+        uint8_t count; ///< The number of bytes to transfer.
+        Direction direction; ///< The direction of the transfer.
+        Status status; ///< The status of the transfer, set by `transferBatch`.
+    };
+
 public:
     /// Create a new I2C interface instance.
     ///
@@ -82,6 +158,46 @@ public:
     {
     }
 
+protected:
+    /// Create a new I2C interface instance with known SERCOM registers.
+    ///
+    /// Used by `WireMasterT` to avoid the lookup of the registers at runtime.
+    ///
+    /// @param interface The SERCOM inerface to use.
+    /// @param sercom The SERCOM registers of the interface.
+    /// @param pinSDA The arduino pin number for the used SDA pin.
+    /// @param pinSCL The arduino pin number for the used SCL pin.
+    ///
+    WireMaster_SAMD21(Interface interface, Sercom *sercom, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL);
+
+    /// Initialize the interface with a known clock ID and pin function.
+    ///
+    /// Used by `WireMasterT` to pass the constants of its setup.
+    ///
+    /// @param clockId The generic clock ID of the SERCOM.
+    /// @param pinFunction The function for the SDA and SCL pins.
+    ///
+    Status initialize(uint8_t clockId, GPIO::Function pinFunction);
+
+public:
+    /// Get the SERCOM registers for an interface.
+    ///
+    static Sercom* getSercom(Interface interface);
+
+    /// Get the generic clock ID for an interface.
+    ///
+    static uint8_t getClockId(Interface interface);
+
+    /// Get the pin function for an interface.
+    ///
+    static GPIO::Function getPinFunction(Interface interface);
+
+    /// Get the index of the SERCOM for an interface.
+    ///
+    static constexpr uint8_t getSercomIndex(Interface interface) {
+        return static_cast<uint8_t>(interface) & 0x0fu;
+    }
+
 public: // Implement the WireMaster interface.
     Status initialize() override;
     Status reset() override;
@@ -97,14 +213,675 @@ public: // Implement the WireMaster interface.
     Status readBytes(uint8_t address, uint8_t *data, uint8_t count) override;
     Status readRegisterData(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count) override;
 
+public: // Clock configuration.
+    /// Set the generic clock generator for the interface.
+    ///
+    /// The default is generator 0 with the 48MHz core clock. Call this method before `initialize()`.
+    /// The baud values are calculated from the given frequency.
+    ///
+    /// @param generator The generic clock generator, 0-8.
+    /// @param frequencyHz The frequency of the clock generator.
+    /// @return `Success` or `Error` for invalid parameters.
+    ///
+    Status setClockSource(uint8_t generator, uint32_t frequencyHz);
+
+    /// Get the result of the last baud rate calculation.
+    ///
+    /// Contains the baud values, the achieved SCL frequency and the error in ppm.
+    ///
+    inline const WireBaud::Result& getBaudResult() const { return _baudResult; }
+
+public: // Large transfers.
+    /// Write a block of bytes.
+    ///
+    /// Like `writeBytes`, but for blocks larger than 255 bytes in one transaction.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param data The data to write.
+    /// @param count The number of bytes to write.
+    /// @return The status of the transaction.
+    ///
+    Status writeBlock(uint8_t address, const uint8_t *data, uint16_t count);
+
+    /// Read a block of bytes.
+    ///
+    /// Like `readBytes`, but for blocks larger than 255 bytes in one transaction.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param data The buffer for the data.
+    /// @param count The number of bytes to read.
+    /// @return The status of the transaction.
+    ///
+    Status readBlock(uint8_t address, uint8_t *data, uint16_t count);
+
+    /// Write to a memory with a 16bit address.
+    ///
+    /// Sends the memory address with the most significant byte first, followed by the data.
+    /// This is the addressing used by 24Cxx EEPROMs. Writes to an EEPROM must not cross
+    /// a page boundary.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param memoryAddress The 16bit memory address.
+    /// @param data The data to write.
+    /// @param count The number of bytes to write.
+    /// @return The status of the transaction.
+    ///
+    Status writeMemory(uint8_t address, uint16_t memoryAddress, const uint8_t *data, uint16_t count);
+
+    /// Read from a memory with a 16bit address.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param memoryAddress The 16bit memory address.
+    /// @param data The buffer for the data.
+    /// @param count The number of bytes to read.
+    /// @return The status of the transaction.
+    ///
+    Status readMemory(uint8_t address, uint16_t memoryAddress, uint8_t *data, uint16_t count);
+
+    /// Stream data from a memory with a 16bit address into a ring buffer.
+    ///
+    /// All bytes are read in a single transaction. If the ring buffer is full, the callback
+    /// is called to drain it. While the callback runs, the interface stretches the clock, so
+    /// the transfer just pauses. After the last byte, the callback is called once more.
+    /// If the callback does not free any space, the transaction is stopped with an error.
+    ///
+    /// If a retry policy repeats a failed transaction, the read resumes after the bytes which
+    /// were already stored in the ring buffer, so no byte is delivered twice.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param memoryAddress The 16bit memory address.
+    /// @param count The number of bytes to read.
+    /// @param buffer The ring buffer for the data.
+    /// @param callback The callback to drain the buffer.
+    /// @param context A context pointer passed to the callback.
+    /// @return The status of the transaction.
+    ///
+    Status readMemoryStream(uint8_t address, uint16_t memoryAddress, uint32_t count,
+        ReadRingBuffer &buffer, StreamCallback callback, void *context = nullptr);
+
+    /// Write multiple segments of data in one transaction.
+    ///
+    /// The segments are sent in order without copying them into a single buffer. This is
+    /// useful for command, header and payload layouts, which are stored in different buffers.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param segments The array with the segments.
+    /// @param segmentCount The number of segments.
+    /// @return The status of the transaction, `Error` if there is no data to write.
+    ///
+    Status writeSegments(uint8_t address, const WriteSegment *segments, uint8_t segmentCount);
+
+public: // SMBus.
+    /// The maximum number of bytes in a SMBus block.
+    ///
+    static constexpr uint8_t cSmBusBlockSize = 32;
+
+    /// SMBus write byte.
+    ///
+    /// All SMBus methods optionally add a packet error code (PEC) to the transaction. It is
+    /// calculated while the bytes are sent and received. If a received PEC does not match,
+    /// the method returns `Error`.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param command The command code.
+    /// @param value The byte to write.
+    /// @param usePec `true` to send a PEC.
+    /// @return The status of the transaction.
+    ///
+    Status smBusWriteByte(uint8_t address, uint8_t command, uint8_t value, bool usePec = false);
+
+    /// SMBus read byte.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param command The command code.
+    /// @param value The variable for the read byte.
+    /// @param usePec `true` to read and check a PEC.
+    /// @return The status of the transaction.
+    ///
+    Status smBusReadByte(uint8_t address, uint8_t command, uint8_t &value, bool usePec = false);
+
+    /// SMBus write word, the low byte is sent first.
+    ///
+    /// @see smBusWriteByte
+    ///
+    Status smBusWriteWord(uint8_t address, uint8_t command, uint16_t value, bool usePec = false);
+
+    /// SMBus read word, the low byte is received first.
+    ///
+    /// @see smBusReadByte
+    ///
+    Status smBusReadWord(uint8_t address, uint8_t command, uint16_t &value, bool usePec = false);
+
+    /// SMBus block write.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param command The command code.
+    /// @param data The data to write.
+    /// @param count The number of bytes, 1-32.
+    /// @param usePec `true` to send a PEC.
+    /// @return The status of the transaction.
+    ///
+    Status smBusBlockWrite(uint8_t address, uint8_t command, const uint8_t *data, uint8_t count, bool usePec = false);
+
+    /// SMBus block read.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param command The command code.
+    /// @param data The buffer for the data.
+    /// @param count The size of the buffer, set to the number of received bytes.
+    /// @param usePec `true` to read and check a PEC.
+    /// @return The status of the transaction. `Error` if the block does not fit into the buffer.
+    ///
+    Status smBusBlockRead(uint8_t address, uint8_t command, uint8_t *data, uint8_t &count, bool usePec = false);
+
+    /// SMBus process call.
+    ///
+    /// Writes a word and reads the result word after a repeated start.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param command The command code.
+    /// @param value The word to write.
+    /// @param result The variable for the result.
+    /// @param usePec `true` to read and check a PEC.
+    /// @return The status of the transaction.
+    ///
+    Status smBusProcessCall(uint8_t address, uint8_t command, uint16_t value, uint16_t &result, bool usePec = false);
+
+public: // Bus recovery.
+    /// Recover a blocked bus.
+    ///
+    /// If a slave holds SDA low, e.g. after a reset in the middle of a transfer, a software reset
+    /// of the interface can not release the bus. This method takes over the pins, clocks SCL up to
+    /// nine times until SDA is released, sends a stop condition and re-initializes the interface.
+    ///
+    /// @return `Success` if the bus is released, `Error` if SDA or SCL stays low, or any
+    ///     error from the reset of the interface.
+    ///
+    Status recoverBus();
+
+    /// Set the number of consecutive failures until the bus is recovered automatically.
+    ///
+    /// Only bus faults of complete transactions are counted: timeouts, a lost arbitration and
+    /// bus errors. Any other result, including a PEC mismatch or an invalid SMBus block count,
+    /// resets the counter. The default is three failures.
+    ///
+    /// @param failureCount The number of failures, or zero to disable the automatic recovery.
+    ///
+    void setRecoveryThreshold(uint8_t failureCount);
+
+    /// Get the number of bus recoveries since the start.
+    ///
+    inline uint32_t getRecoveryCount() const { return _recoveryCount; }
+
+public: // Retry policy.
+    /// Set the retry policy for a device.
+    ///
+    /// Failed transactions (`NoAcknowledge`, `AddressNotFound`, `Timeout` or `Error`) with
+    /// the device are repeated up to `maxAttempts` times, with an exponential backoff
+    /// between the attempts. The backoff is a busy wait which blocks the caller, each
+    /// delay is limited to `cMaximumBackoffMicroseconds`.
+    ///
+    /// If `breakerThreshold` transactions in a row fail, the circuit for the device opens:
+    /// all transactions fail immediately with `AddressNotFound`, without accessing the bus.
+    /// After `breakerTimeout`, one trial transaction with a single attempt is allowed. If it
+    /// succeeds, the circuit closes again.
+    ///
+    /// Batches from `transferBatch` use the circuit breaker, but failed entries are not
+    /// repeated, because the bus is kept between the entries.
+    ///
+    /// Devices without a policy use a single attempt and no circuit breaker.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param policy The retry policy.
+    /// @return `Success`, or `Error` if the policy is invalid or there is no free slot.
+    ///
+    Status setRetryPolicy(uint8_t address, const RetryPolicy &policy);
+
+    /// Remove the retry policy for a device.
+    ///
+    /// @param address The 7bit address of the device.
+    ///
+    void removeRetryPolicy(uint8_t address);
+
+    /// Check if the circuit for a device is open.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @return `true` if transactions with the device currently fail immediately.
+    ///
+    bool isCircuitOpen(uint8_t address) const;
+
+    /// Close the circuit for a device, e.g. after the device was reconnected.
+    ///
+    /// @param address The 7bit address of the device.
+    ///
+    void resetCircuit(uint8_t address);
+
+#ifdef HAL_FEATHER_M0_WIRE_STATISTICS
+public: // Statistics.
+    /// Access the collected statistics.
+    ///
+    /// Only available if the library is compiled with `HAL_FEATHER_M0_WIRE_STATISTICS`.
+    ///
+    inline const WireStatistics& getStatistics() const { return _statistics; }
+
+    /// Reset the collected statistics.
+    ///
+    inline void resetStatistics() { _statistics.reset(); }
+#endif
+
+public: // Batch transfers.
+    /// Execute a batch of register transfers.
+    ///
+    /// All transfers are executed back-to-back, separated by repeated start conditions. Only
+    /// the last transfer is terminated by a stop condition. A NACK for one transfer does not
+    /// stop the batch, it is recorded in the `status` field of the transfer. A timeout or bus
+    /// error ends the batch, the remaining transfers get the same status.
+    ///
+    /// Transfers to devices with an open circuit (see `setRetryPolicy`) are skipped with
+    /// `AddressNotFound`. The results update the circuits, but failed transfers are not repeated.
+    ///
+    /// In high-speed mode, the bus stays in high-speed mode until the final stop condition.
+    /// Do not mix devices which only support fast mode into such a batch.
+    ///
+    /// @param transfers The array with the transfers.
+    /// @param count The number of transfers in the array.
+    /// @param busCycles Optional pointer to receive the total time on the bus in clock cycles.
+    ///     Use `ClockCycles::toMicroseconds` to convert the value.
+    /// @return `Success` if all transfers were successful, otherwise the status of
+    ///     the first failed transfer.
+    ///
+    Status transferBatch(RegisterTransfer *transfers, uint8_t count, uint32_t *busCycles = nullptr);
+
+public: // Asynchronous transactions.
+    /// Start an asynchronous write of bytes.
+    ///
+    /// The transaction is driven by the MB/SB/ERROR interrupts of the SERCOM interface. This call
+    /// does not wait for the bus, it only sends the address, so it can be used from interrupts.
+    /// If the bus is not free, e.g. used by another master, it returns `Timeout` immediately;
+    /// use `isBusFree()` to check this first. Poll `isAsyncBusy()` or pass a callback to get
+    /// notified about the result. The data must stay valid until the transaction
+    /// is finished. Do not call any of the blocking methods while an asynchronous transaction is
+    /// in progress.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param data The data to write.
+    /// @param count The number of bytes to write.
+    /// @param callback An optional callback, called from the interrupt if the transaction is finished.
+    /// @param context A context pointer passed to the callback.
+    /// @return `Success` if the transaction was started, `Error` if another transaction
+    ///     is in progress or there is a bus error, or `Timeout` if the bus is not free.
+    ///
+    Status writeBytesAsync(uint8_t address, const uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start an asynchronous write of register data.
+    ///
+    /// @see writeBytesAsync
+    ///
+    Status writeRegisterDataAsync(uint8_t address, uint8_t registerAddress, const uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start an asynchronous read of bytes.
+    ///
+    /// @see writeBytesAsync
+    ///
+    Status readBytesAsync(uint8_t address, uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start an asynchronous read of register data.
+    ///
+    /// Writes the register address and reads the data after a repeated start.
+    ///
+    /// @see writeBytesAsync
+    ///
+    Status readRegisterDataAsync(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Set the DMA channel used for block transfers.
+    ///
+    /// This initializes the DMA controller and reserves the channel for this interface.
+    /// The channel must not be used for anything else.
+    ///
+    /// @param channel The DMA channel index, 0-11.
+    /// @return `Success`, `Error` if the channel index is invalid or `Timeout` if the DMA controller does not respond.
+    ///
+    Status setDmaChannel(uint8_t channel);
+
+    /// Start a DMA write of bytes.
+    ///
+    /// The whole block is moved by the DMA controller, using the hardware length counter of
+    /// the SERCOM interface. The interface sends the stop condition automatically after the
+    /// last byte. The transaction is reported like the other asynchronous transactions.
+    ///
+    /// While the DMA controller writes the data, only the error interrupt of the interface is
+    /// enabled. A NACK stops the transfer with a length error. The MB interrupt is enabled
+    /// after the DMA transfer is complete and waits for the acknowledge of the last byte.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param data The data to write.
+    /// @param count The number of bytes to write, 1-255.
+    /// @param callback An optional callback, called from the interrupt if the transaction is finished.
+    /// @param context A context pointer passed to the callback.
+    /// @return `Success` if the transaction was started, `Error` if no DMA channel is set or
+    ///     another transaction is in progress, or any error from waiting for the bus.
+    ///
+    Status writeBytesDma(uint8_t address, const uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start a DMA write of register data.
+    ///
+    /// The register address and the data are sent using a chain of two DMA descriptors.
+    ///
+    /// @param count The number of bytes to write, 1-254.
+    /// @see writeBytesDma
+    ///
+    Status writeRegisterDataDma(uint8_t address, uint8_t registerAddress, const uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start a DMA read of bytes.
+    ///
+    /// @see writeBytesDma
+    ///
+    Status readBytesDma(uint8_t address, uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Start a DMA read of register data.
+    ///
+    /// The register address is written by the interrupt handler, the data is read using DMA
+    /// after a repeated start.
+    ///
+    /// @see writeBytesDma
+    ///
+    Status readRegisterDataDma(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count,
+        AsyncCallback callback = nullptr, void *context = nullptr);
+
+    /// Check if an asynchronous transaction is in progress.
+    ///
+    inline bool isAsyncBusy() const { return _asyncPhase != AsyncPhase::Idle; }
+
+    /// Check if the bus is free to start a transaction without waiting.
+    ///
+    /// @return `true` if the bus is idle or owned by this interface.
+    ///
+    bool isBusFree() const;
+
+    /// Get the status of the last finished asynchronous transaction.
+    ///
+    inline Status getAsyncStatus() const { return _asyncStatus; }
+
+    /// Handle the SERCOM interrupt.
+    ///
+    /// This is called from the interrupt handler and advances the asynchronous transaction.
+    ///
+    void handleInterrupt();
+
+private:
+    /// The phase of an asynchronous transaction.
+    ///
+    enum class AsyncPhase : uint8_t {
+        Idle, ///< No transaction in progress.
+        Address, ///< The write address was sent.
+        Write, ///< Writing the register and data bytes.
+        ReadAddress, ///< The read address was sent.
+        Read, ///< Reading data bytes.
+        DmaWrite, ///< The DMA controller writes the data.
+        DmaRead, ///< The DMA controller reads the data.
+    };
+
+    /// The state of an asynchronous transaction.
+    ///
+    struct AsyncTransaction {
+        AsyncCallback callback; ///< The callback for the result.
+        void *context; ///< The context for the callback.
+        const uint8_t *writeData; ///< The data to write, or `nullptr`.
+        uint8_t *readData; ///< The buffer for read data, or `nullptr`.
+        uint8_t address; ///< The 7bit address of the device.
+        uint8_t registerAddress; ///< The register address to send first.
+        bool sendRegister; ///< If the register address has to be sent.
+        uint8_t count; ///< The number of bytes to transfer.
+        uint8_t index; ///< The index of the next byte to transfer.
+        bool useDma; ///< If the data is transferred using DMA.
+    };
+
+    /// The marker for no assigned DMA channel.
+    ///
+    static constexpr uint8_t cNoDmaChannel = 0xffu;
+
 private:
+    /// Get the index of the used SERCOM interface.
+    ///
+    inline uint8_t getSercomIndex() const { return getSercomIndex(_interface); }
+
+    /// Start an asynchronous transaction with the prepared state.
+    ///
+    Status startAsync();
+
+    /// Finish the asynchronous transaction.
+    ///
+    void finishAsync(Status status);
+
+    /// Reset and configure the interface, without touching an asynchronous transaction.
+    ///
+    Status resetInterface();
+
+    /// Start the DMA transfer for the prepared transaction.
+    ///
+    /// Writes the address with the length counter enabled, which starts the transfer.
+    ///
+    /// @param read `true` to read the data, `false` to write the register and data.
+    /// @return `Success` or `Timeout` if the DMA channel could not be reset.
+    ///
+    Status startDma(bool read);
+
+    /// Handle the end of the DMA transfer.
+    ///
+    /// Finishes a read, or enables the MB interrupt for the last byte of a write.
+    ///
+    void handleDmaComplete(bool success);
+
+private:
+    /// Calculate the baud values for the frequency and rise time.
+    ///
+    /// In high-speed mode, the result is for the fast mode master code, `highSpeedResult`
+    /// gets the values for the high-speed transfers.
+    ///
+    WireBaud::Result calculateBaud(uint32_t frequencyHz, Nanoseconds riseTime, WireBaud::Result &highSpeedResult) const;
+
     /// Set the baud registers based on the frequency and rise time.
     ///
-    void setBaudRegister(uint32_t frequencyHz, Nanoseconds riseTime);
+    /// @return `Success` or `Error` if the frequency can not be reached with the clock.
+    ///
+    Status setBaudRegister(uint32_t frequencyHz, Nanoseconds riseTime);
+
+    /// Check if a transfer to the given address uses high-speed mode.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @return `true` if high-speed mode is enabled and the device is no fallback device.
+    ///
+    bool isHighSpeedAddress(uint8_t address) const;
+
+    /// Write the address register.
+    ///
+    /// @param addressData The address with the read/write bit.
+    /// @param highSpeed `true` to send the master code and continue in high-speed mode.
+    ///
+    void writeAddressRegister(uint8_t addressData, bool highSpeed);
+
+    /// Send the address and wait until it was sent.
+    ///
+    /// In high-speed mode, a device which does not acknowledge the address is tried again
+    /// in fast mode. If it acknowledges, all further transfers to this device use fast mode.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param read `true` for a read, `false` for a write.
+    /// @return For a write, the status of waiting for MB, check `RXNACK` for the acknowledge.
+    ///     For a read, the status of waiting for SB, which is `NoAcknowledge` on a NACK.
+    ///
+    Status sendAddress(uint8_t address, bool read);
+
+    /// Check if the result of a transaction is caused by a fault on the bus.
+    ///
+    /// @param status The result of the transaction.
+    /// @return `true` for a timeout, or an error with a lost arbitration or bus error.
+    ///
+    bool isBusFault(Status status) const;
+
+    /// Track the result of a transaction for the automatic bus recovery.
+    ///
+    /// @param status The result of the transaction.
+    /// @return The unchanged result.
+    ///
+    Status trackResult(Status status);
+
+    /// Run a complete transaction.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @param function The function executing the transaction.
+    /// @return The status of the transaction.
+    ///
+    template<typename Function>
+    inline Status runTransaction(uint8_t address, Function function) {
+        auto retry = findRetryEntry(address);
+        if (retry != nullptr && !isTransactionAllowed(*retry)) {
+            return Status::AddressNotFound;
+        }
+        // A trial transaction of an open circuit gets a single attempt.
+        const bool isTrial = (retry != nullptr && retry->isOpen);
+        Status status;
+        uint8_t attempt = 0;
+        do {
+            beginStatistics(address);
+            status = function();
+            endStatistics(status);
+            trackResult(status);
+        } while (retry != nullptr && !isTrial && prepareRetry(*retry, status, ++attempt));
+        if (retry != nullptr) {
+            updateCircuit(*retry, status);
+        }
+        return status;
+    }
+
+    /// The retry state of a device.
+    ///
+    struct RetryEntry {
+        bool isUsed; ///< If this entry is used.
+        uint8_t address; ///< The 7bit address of the device.
+        RetryPolicy policy; ///< The policy.
+        uint8_t failureCount; ///< The number of failed transactions in a row.
+        bool isOpen; ///< If the circuit is open.
+        uint32_t openTick; ///< The millisecond tick when the circuit was opened.
+    };
+
+    /// Find the retry entry for a device.
+    ///
+    /// @return The entry, or `nullptr` if there is no policy for the device.
+    ///
+    RetryEntry* findRetryEntry(uint8_t address);
+
+    /// Check if the circuit allows a transaction.
+    ///
+    bool isTransactionAllowed(const RetryEntry &entry) const;
+
+    /// Check if a transaction has to be repeated and wait for the backoff.
+    ///
+    /// @param entry The retry entry.
+    /// @param status The status of the last attempt.
+    /// @param attempt The number of attempts so far.
+    /// @return `true` if the transaction has to be repeated.
+    ///
+    bool prepareRetry(const RetryEntry &entry, Status status, uint8_t attempt);
+
+    /// Update the circuit with the final result of a transaction.
+    ///
+    void updateCircuit(RetryEntry &entry, Status status);
+
+#ifdef HAL_FEATHER_M0_WIRE_STATISTICS
+    /// @name Statistics hooks, compiled to nothing without `HAL_FEATHER_M0_WIRE_STATISTICS`.
+    /// @{
+    inline void beginStatistics(uint8_t address) { _statistics.begin(address); }
+    inline void enterPhase(WireStatistics::Phase phase) { _statistics.enterPhase(phase); }
+    inline void addBytes(uint16_t count) { _statistics.addBytes(count); }
+    inline void endStatistics(Status status) { _statistics.end(status); }
+    /// @}
+#else
+    inline void beginStatistics(uint8_t) {}
+    inline void enterPhase(WireStatistics::Phase) {}
+    inline void addBytes(uint16_t) {}
+    inline void endStatistics(Status) {}
+#endif
+
+    /// Read bytes after the read address was acknowledged.
+    ///
+    /// Expects the ACK action set before the address was sent. All bytes except the last
+    /// are streamed using smart mode, the last byte is answered with a NACK.
+    ///
+    /// @param data The buffer for the data.
+    /// @param count The number of bytes to read.
+    /// @param stop `true` to end with a stop condition, `false` to keep the bus for a repeated start.
+    ///
+    Status readBytesAfterAcknowledge(uint8_t *data, uint16_t count, bool stop = true);
+
+    /// Stream bytes into a ring buffer after the read address was acknowledged.
+    ///
+    /// @param count The number of bytes to read.
+    /// @param buffer The ring buffer for the data.
+    /// @param callback The callback to drain the buffer.
+    /// @param context A context pointer passed to the callback.
+    /// @param storedCount A counter, incremented for each byte stored in the ring buffer.
+    ///
+    Status readStreamAfterAcknowledge(uint32_t count, ReadRingBuffer &buffer, StreamCallback callback, void *context,
+        uint32_t &storedCount);
+
+    /// Run a SMBus transaction with optional PEC calculation.
+    ///
+    template<typename Function>
+    inline Status runSmBusTransaction(uint8_t address, bool usePec, Function function) {
+        const auto status = runTransaction(address, [this, usePec, function]() -> Status {
+            _pecActive = usePec;
+            _pec = 0;
+            return function();
+        });
+        _pecActive = false;
+        return status;
+    }
+
+    /// Add a byte to the PEC if the calculation is active.
+    ///
+    inline void updatePec(uint8_t data) {
+        if (_pecActive) {
+            _pec = SmBusPec::update(_pec, data);
+        }
+    }
+
+    /// Send the command and a repeated start with the read address.
+    ///
+    Status smBusStartRead(uint8_t address, uint8_t command);
+
+    /// Send the PEC if the calculation is active, and stop the transaction.
+    ///
+    Status smBusWriteEnd();
+
+    /// Read bytes after the read address and check the PEC if the calculation is active.
+    ///
+    /// @param data The buffer for the data, with space for one more byte for the PEC.
+    /// @param count The number of data bytes.
+    ///
+    Status smBusReadEnd(uint8_t *data, uint8_t count);
+
+    /// Read the next byte in smart mode.
+    ///
+    /// @param value The variable for the byte.
+    /// @param isLast `true` to answer the byte with a NACK and stop the transaction.
+    ///
+    Status readNextByte(uint8_t &value, bool isLast);
+
+    /// Start a write and send a 16bit memory address.
+    ///
+    Status writeMemoryAddress(uint8_t address, uint16_t memoryAddress);
 
-    /// Read bytes after.
+    /// Execute a single transfer of a batch, without start and stop conditions.
     ///
-    Status readBytesAfterAcknowledge(uint8_t *data, uint8_t count);
+    Status transferBatchEntry(const RegisterTransfer &transfer);
 
 private:
     const Interface _interface; ///< The interface to use.
@@ -112,7 +889,27 @@ private:
     const GPIO::PinNumber _pinSDA; ///< The arduino pin number for the SDA pin.
     const GPIO::PinNumber _pinSCL; ///< The arduino pin number for the SCL pin.
     uint32_t _frequencyHz; ///< The current speed.
+    uint8_t _clockGenerator; ///< The generic clock generator for the interface.
+    uint32_t _clockFrequencyHz; ///< The frequency of the generic clock.
+    WireBaud::Result _baudResult; ///< The result of the last baud rate calculation.
     Nanoseconds _riseTime; ///< The rise time.
+    bool _highSpeed; ///< If the interface is configured for high-speed mode.
+    uint32_t _highSpeedFallback[4]; ///< Bitmask of the devices which do not support high-speed mode.
+    uint8_t _recoveryThreshold; ///< The number of failures until the bus is recovered, or zero.
+    uint8_t _failureCount; ///< The number of consecutive failures.
+    uint32_t _recoveryCount; ///< The number of bus recoveries.
+    RetryEntry _retryEntries[cRetryPolicyCount]; ///< The retry policies of the devices.
+    bool _pecActive; ///< If the PEC is calculated for the current transaction.
+    uint8_t _pec; ///< The PEC of the current transaction.
+    AsyncTransaction _async; ///< The current asynchronous transaction.
+    volatile AsyncPhase _asyncPhase; ///< The phase of the asynchronous transaction.
+    volatile Status _asyncStatus; ///< The status of the last asynchronous transaction.
+    uint8_t _dmaChannel; ///< The DMA channel for block transfers or `cNoDmaChannel`.
+    __attribute__((aligned(16)))
+    DmacDescriptor _dmaDescriptor; ///< The second descriptor of a DMA chain.
+#ifdef HAL_FEATHER_M0_WIRE_STATISTICS
+    WireStatistics _statistics; ///< The collected statistics.
+#endif
 };
 
 
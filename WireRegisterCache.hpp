@@ -0,0 +1,274 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "hal-common/WireMaster.hpp"
+#include "hal-common/StatusTools.hpp"
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// A register shadow cache for an I2C device.
+///
+/// Reads of registers marked as cacheable are served from RAM after the first read.
+/// Writes go through to the device and update the cache. Changes can also be collected
+/// with `setDeferred()` and written with `syncDirty()`, which merges consecutive dirty
+/// registers into one transaction.
+///
+/// Only mark registers as cacheable if the device never changes them by itself. Status,
+/// data and self-clearing registers must not be cached.
+///
+/// @tparam tRegisterCount The number of registers of the device, starting at address zero.
+///
+template<uint16_t tRegisterCount>
+class WireRegisterCache
+{
+    static_assert(tRegisterCount > 0 && tRegisterCount <= 256, "The register count must be in the range 1-256.");
+
+public:
+    /// The status.
+    ///
+    using Status = WireMaster::Status;
+
+public:
+    /// Create a new register cache.
+    ///
+    /// Initially no register is cacheable.
+    ///
+    /// @param bus The bus to access the device.
+    /// @param address The 7bit address of the device.
+    ///
+    WireRegisterCache(WireMaster &bus, uint8_t address)
+        : _bus(bus), _address(address), _burstWrite(true), _values(), _cacheable(), _valid(), _dirty()
+    {
+    }
+
+public:
+    /// Mark a range of registers as cacheable.
+    ///
+    /// @param firstRegister The first register.
+    /// @param count The number of registers.
+    /// @param cacheable `true` to cache the registers, `false` to read them always from the device.
+    ///
+    void setCacheable(uint8_t firstRegister, uint16_t count = 1, bool cacheable = true) {
+        for (uint16_t i = firstRegister; i < firstRegister + count && i < tRegisterCount; ++i) {
+            setBit(_cacheable, i, cacheable);
+            if (!cacheable) {
+                setBit(_valid, i, false);
+                setBit(_dirty, i, false);
+            }
+        }
+    }
+
+    /// Set if the device increments the register address for multi-byte writes.
+    ///
+    /// If enabled, which is the default, `syncDirty()` writes consecutive registers in
+    /// one transaction. Otherwise every register is written separately.
+    ///
+    void setBurstWrite(bool enabled) { _burstWrite = enabled; }
+
+    /// Read a register.
+    ///
+    /// @param registerAddress The register address.
+    /// @param value The variable for the value.
+    /// @return `Success` or the error from the bus.
+    ///
+    Status read(uint8_t registerAddress, uint8_t &value) {
+        if (registerAddress >= tRegisterCount) {
+            return Status::Error;
+        }
+        if (getBit(_valid, registerAddress)) {
+            value = _values[registerAddress];
+            return Status::Success;
+        }
+        const auto status = _bus.readRegisterData(_address, registerAddress, &value, 1);
+        if (isSuccessful(status) && getBit(_cacheable, registerAddress)) {
+            _values[registerAddress] = value;
+            setBit(_valid, registerAddress, true);
+        }
+        return status;
+    }
+
+    /// Write a register to the device.
+    ///
+    /// The value is written immediately and updates the cache. A deferred value of the register
+    /// is replaced. If the write fails, the cached and the deferred value are discarded.
+    ///
+    /// @param registerAddress The register address.
+    /// @param value The new value.
+    /// @return `Success` or the error from the bus.
+    ///
+    Status write(uint8_t registerAddress, uint8_t value) {
+        if (registerAddress >= tRegisterCount) {
+            return Status::Error;
+        }
+        const auto status = _bus.writeRegisterData(_address, registerAddress, value);
+        if (getBit(_cacheable, registerAddress)) {
+            if (isSuccessful(status)) {
+                _values[registerAddress] = value;
+                setBit(_valid, registerAddress, true);
+                setBit(_dirty, registerAddress, false);
+            } else {
+                // The state of the device is unknown, never write an older deferred value over it.
+                setBit(_valid, registerAddress, false);
+                setBit(_dirty, registerAddress, false);
+            }
+        }
+        return status;
+    }
+
+    /// Change bits in a register.
+    ///
+    /// Reads the register (from the cache if possible) and writes the value if it changed.
+    ///
+    /// @param registerAddress The register address.
+    /// @param mask The bits to change.
+    /// @param bits The new values for the bits in the mask.
+    /// @return `Success` or the error from the bus.
+    ///
+    Status modify(uint8_t registerAddress, uint8_t mask, uint8_t bits) {
+        uint8_t value;
+        Status status;
+        if (hasError(status = read(registerAddress, value))) return status;
+        const uint8_t newValue = static_cast<uint8_t>((value & ~mask) | (bits & mask));
+        if (newValue == value) {
+            return Status::Success;
+        }
+        return write(registerAddress, newValue);
+    }
+
+    /// Set a cacheable register without writing it to the device.
+    ///
+    /// The register is marked as dirty and written with the next call of `syncDirty()`.
+    ///
+    /// @param registerAddress The register address.
+    /// @param value The new value.
+    /// @return `Success`, or `Error` if the register is not cacheable.
+    ///
+    Status setDeferred(uint8_t registerAddress, uint8_t value) {
+        if (registerAddress >= tRegisterCount || !getBit(_cacheable, registerAddress)) {
+            return Status::Error;
+        }
+        _values[registerAddress] = value;
+        setBit(_valid, registerAddress, true);
+        setBit(_dirty, registerAddress, true);
+        return Status::Success;
+    }
+
+    /// Write all dirty registers to the device.
+    ///
+    /// @return `Success` or the first error from the bus. Registers which were not
+    ///     written stay dirty.
+    ///
+    Status syncDirty() {
+        uint16_t index = 0;
+        while (index < tRegisterCount) {
+            if (!getBit(_dirty, index)) {
+                ++index;
+                continue;
+            }
+            uint16_t count = 1;
+            if (_burstWrite) {
+                while (index + count < tRegisterCount && count < 255 && getBit(_dirty, index + count)) {
+                    ++count;
+                }
+            }
+            const auto status = _bus.writeRegisterData(_address, static_cast<uint8_t>(index),
+                &_values[index], static_cast<uint8_t>(count));
+            if (hasError(status)) {
+                return status;
+            }
+            for (uint16_t i = index; i < index + count; ++i) {
+                setBit(_dirty, i, false);
+            }
+            index += count;
+        }
+        return Status::Success;
+    }
+
+    /// Check if there are dirty registers.
+    ///
+    bool hasDirty() const {
+        for (auto bits : _dirty) {
+            if (bits != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Invalidate a cached register.
+    ///
+    /// The next read gets the value from the device. A dirty value is discarded.
+    ///
+    void invalidate(uint8_t registerAddress) {
+        if (registerAddress < tRegisterCount) {
+            setBit(_valid, registerAddress, false);
+            setBit(_dirty, registerAddress, false);
+        }
+    }
+
+    /// Invalidate all cached registers, e.g. after a reset of the device.
+    ///
+    void invalidateAll() {
+        for (uint8_t i = 0; i < cMaskSize; ++i) {
+            _valid[i] = 0;
+            _dirty[i] = 0;
+        }
+    }
+
+private:
+    /// The number of words in a bit mask.
+    ///
+    static constexpr uint8_t cMaskSize = static_cast<uint8_t>((tRegisterCount + 31u) / 32u);
+
+    /// A bit mask with one bit for each register.
+    ///
+    using Mask = uint32_t[cMaskSize];
+
+    static inline bool getBit(const Mask &mask, uint16_t index) {
+        return (mask[index >> 5u] & (static_cast<uint32_t>(1) << (index & 0x1fu))) != 0;
+    }
+
+    static inline void setBit(Mask &mask, uint16_t index, bool value) {
+        const uint32_t bit = (static_cast<uint32_t>(1) << (index & 0x1fu));
+        if (value) {
+            mask[index >> 5u] |= bit;
+        } else {
+            mask[index >> 5u] &= ~bit;
+        }
+    }
+
+private:
+    WireMaster &_bus; ///< The bus to access the device.
+    const uint8_t _address; ///< The 7bit address of the device.
+    bool _burstWrite; ///< If consecutive registers are written in one transaction.
+    uint8_t _values[tRegisterCount]; ///< The cached values.
+    Mask _cacheable; ///< The cacheable registers.
+    Mask _valid; ///< The registers with a valid cached value.
+    Mask _dirty; ///< The registers with a value not written to the device.
+};
+
+
+}
+
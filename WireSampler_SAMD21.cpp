@@ -0,0 +1,289 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "WireSampler_SAMD21.hpp"
+
+
+#include "ClockCycles.hpp"
+#include "SpinDeadline_SAMD21.hpp"
+
+#include "hal-core/Chip.hpp"
+#include "hal-common/StatusTools.hpp"
+
+
+namespace lr {
+
+
+namespace {
+
+
+/// The running sampler.
+///
+WireSampler *gActiveSampler = nullptr;
+
+
+/// Get a timestamp with microsecond resolution.
+///
+/// @param milliseconds The variable for the milliseconds.
+/// @param microseconds The variable for the microseconds part.
+///
+inline void getTimestamp(uint32_t &milliseconds, uint16_t &microseconds)
+{
+    // TC3 has a higher priority than SysTick, so a pending SysTick wrap has to be counted.
+    uint32_t cycles;
+    ClockCycles::getTickAndCycles(milliseconds, cycles);
+    microseconds = static_cast<uint16_t>(cycles / ClockCycles::getPerMicrosecond());
+    if (microseconds > 999) {
+        microseconds = 999;
+    }
+}
+
+
+/// Wait until the synchronization of TC3 is finished.
+///
+/// @return `true` on success, `false` on a timeout.
+///
+inline bool waitForTimerSync()
+{
+    SpinDeadline syncTimer(10_ms);
+    while (TC3->COUNT16.STATUS.bit.SYNCBUSY) {
+        if (syncTimer.hasTimeout()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/// Wait until the synchronization of the generic clock controller is finished.
+///
+/// @return `true` on success, `false` on a timeout.
+///
+inline bool waitForClockSync()
+{
+    SpinDeadline syncTimer(10_ms);
+    while (GCLK->STATUS.reg & GCLK_STATUS_SYNCBUSY) {
+        if (syncTimer.hasTimeout()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/// Wait until the software reset of TC3 is finished.
+///
+/// @return `true` on success, `false` on a timeout.
+///
+inline bool waitForTimerReset()
+{
+    SpinDeadline resetTimer(10_ms);
+    while (TC3->COUNT16.CTRLA.bit.SWRST) {
+        if (resetTimer.hasTimeout()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+}
+
+
+WireSampler::WireSampler()
+    : _sensors(), _sensorCount(0), _tick(0)
+{
+}
+
+
+WireSampler::Status WireSampler::addSensor(WireMaster_SAMD21 &bus, uint8_t address, uint8_t registerAddress,
+    uint8_t count, Milliseconds period)
+{
+    if (gActiveSampler == this || _sensorCount >= cSensorCount) {
+        return Status::Error;
+    }
+    if (count == 0 || count > cSampleSize || period.ticks() == 0 || period.ticks() > 0x7fffu) {
+        return Status::Error;
+    }
+    auto &sensor = _sensors[_sensorCount];
+    sensor.sampler = this;
+    sensor.bus = &bus;
+    sensor.address = address;
+    sensor.registerAddress = registerAddress;
+    sensor.count = count;
+    sensor.period = static_cast<uint16_t>(period.ticks());
+    sensor.nextTick = 0;
+    sensor.isReading = false;
+    sensor.head = 0;
+    sensor.tail = 0;
+    sensor.droppedCount = 0;
+    ++_sensorCount;
+    return Status::Success;
+}
+
+
+WireSampler::Status WireSampler::start()
+{
+    if (gActiveSampler != nullptr) {
+        return Status::Error;
+    }
+    _tick = 0;
+    for (uint8_t i = 0; i < _sensorCount; ++i) {
+        _sensors[i].nextTick = 1;
+    }
+    // Enable the bus clock and the generic clock for the timer.
+    PM->APBCMASK.reg |= PM_APBCMASK_TC3;
+    GCLK->CLKCTRL.reg =
+        GCLK_CLKCTRL_ID(GCLK_CLKCTRL_ID_TCC2_TC3_Val) |
+        GCLK_CLKCTRL_GEN_GCLK0 | // Source is clock generator 0
+        GCLK_CLKCTRL_CLKEN; // Enable it.
+    if (!waitForClockSync()) {
+        return Status::Timeout;
+    }
+    // Reset the timer.
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    if (!waitForTimerReset()) {
+        return Status::Timeout;
+    }
+    // 48MHz / 64 = 750kHz, the counter is reset at CC0 for a 1ms period.
+    TC3->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_MFRQ | TC_CTRLA_PRESCALER_DIV64;
+    if (!waitForTimerSync()) {
+        return Status::Timeout;
+    }
+    TC3->COUNT16.CC[0].reg = static_cast<uint16_t>((ClockCycles::cSystemCoreClock / 64u / 1000u) - 1u);
+    if (!waitForTimerSync()) {
+        return Status::Timeout;
+    }
+    gActiveSampler = this;
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    TC3->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+    NVIC_ClearPendingIRQ(TC3_IRQn);
+    NVIC_EnableIRQ(TC3_IRQn);
+    TC3->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+    // The timer is running, even if the enable is not synchronized yet.
+    waitForTimerSync();
+    return Status::Success;
+}
+
+
+void WireSampler::stop()
+{
+    if (gActiveSampler != this) {
+        return;
+    }
+    NVIC_DisableIRQ(TC3_IRQn);
+    TC3->COUNT16.INTENCLR.reg = TC_INTENCLR_MC0;
+    TC3->COUNT16.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    waitForTimerSync(); // Ignore timeout, the interrupt is disabled.
+    gActiveSampler = nullptr;
+}
+
+
+bool WireSampler::readSample(uint8_t sensorIndex, Sample &sample)
+{
+    if (sensorIndex >= _sensorCount) {
+        return false;
+    }
+    auto &sensor = _sensors[sensorIndex];
+    const uint8_t tail = sensor.tail;
+    if (tail == sensor.head) {
+        return false;
+    }
+    sample = sensor.samples[tail];
+    sensor.tail = (tail + 1u) & (cQueueSize - 1u);
+    return true;
+}
+
+
+uint32_t WireSampler::getDroppedCount(uint8_t sensorIndex) const
+{
+    if (sensorIndex >= _sensorCount) {
+        return 0;
+    }
+    return _sensors[sensorIndex].droppedCount;
+}
+
+
+void WireSampler::handleTimerInterrupt()
+{
+    TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+    const uint16_t tick = _tick + 1u;
+    _tick = tick;
+    for (uint8_t i = 0; i < _sensorCount; ++i) {
+        auto &sensor = _sensors[i];
+        if (static_cast<int16_t>(tick - sensor.nextTick) < 0) {
+            continue;
+        }
+        // Skip the sensor until the bus is free, never wait for the bus in the interrupt.
+        if (sensor.isReading || sensor.bus->isAsyncBusy() || !sensor.bus->isBusFree()) {
+            continue;
+        }
+        sensor.nextTick = static_cast<uint16_t>(sensor.nextTick + sensor.period);
+        // Do not accumulate missed periods after a long busy bus.
+        if (static_cast<int16_t>(tick - sensor.nextTick) >= 0) {
+            sensor.nextTick = static_cast<uint16_t>(tick + sensor.period);
+        }
+        startRead(sensor);
+    }
+}
+
+
+void WireSampler::startRead(Sensor &sensor)
+{
+    const uint8_t head = sensor.head;
+    const uint8_t nextHead = (head + 1u) & (cQueueSize - 1u);
+    if (nextHead == sensor.tail) {
+        ++sensor.droppedCount;
+        return;
+    }
+    // Read directly into the next queue slot, it is published in the callback.
+    auto &sample = sensor.samples[head];
+    getTimestamp(sample.milliseconds, sample.microseconds);
+    sample.count = sensor.count;
+    sensor.isReading = true;
+    const auto status = sensor.bus->readRegisterDataAsync(sensor.address, sensor.registerAddress,
+        sample.data, sensor.count, &WireSampler::onReadComplete, &sensor);
+    if (hasError(status)) {
+        // The read did not start, publish the error.
+        onReadComplete(&sensor, status);
+    }
+}
+
+
+void WireSampler::onReadComplete(void *context, WireMaster::Status status)
+{
+    auto &sensor = *static_cast<Sensor*>(context);
+    const uint8_t head = sensor.head;
+    sensor.samples[head].status = status;
+    sensor.head = (head + 1u) & (cQueueSize - 1u);
+    sensor.isReading = false;
+}
+
+
+}
+
+
+/// The interrupt handler for TC3.
+///
+void TC3_Handler()
+{
+    if (lr::gActiveSampler != nullptr) {
+        lr::gActiveSampler->handleTimerInterrupt();
+    }
+}
+
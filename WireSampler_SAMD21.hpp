@@ -0,0 +1,170 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "WireMaster_SAMD21.hpp"
+
+#include "hal-common/Timer.hpp"
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// A sampling engine for periodic I2C reads.
+///
+/// The sampler runs a table of periodic register reads from the interrupt of the TC3 timer,
+/// which is configured for a 1ms tick. The reads are asynchronous transactions, so reads
+/// on different buses run at the same time. Every result is stored with a timestamp in a
+/// single-producer/single-consumer queue for each sensor. The application just drains
+/// these queues with `readSample()`.
+///
+/// If a bus is still busy when a sensor is due, the read is started with the next tick.
+/// If the queue of a sensor is full, the sample is dropped and counted.
+///
+/// @note Only one sampler can run at a time. The sampler uses TC3 exclusively.
+/// Do not use the blocking methods of a bus while the sampler is running.
+///
+class WireSampler
+{
+public:
+    /// The status of a sampler call.
+    ///
+    enum class Status : uint8_t {
+        Success, ///< The call was successful.
+        Error, ///< Invalid parameter, no free sensor slot or the sampler is running.
+        Timeout, ///< The synchronization of the timer did not finish.
+    };
+
+    /// The maximum number of sensors.
+    ///
+    static constexpr uint8_t cSensorCount = 8;
+
+    /// The maximum number of bytes per sample.
+    ///
+    static constexpr uint8_t cSampleSize = 12;
+
+    /// The number of samples in each queue, must be a power of two.
+    ///
+    static constexpr uint8_t cQueueSize = 8;
+
+    static_assert((cQueueSize & (cQueueSize - 1)) == 0, "The queue size must be a power of two.");
+
+    /// One sample.
+    ///
+    struct Sample {
+        uint32_t milliseconds; ///< The timestamp of the start of the read, from `Timer::tickMilliseconds()`.
+        uint16_t microseconds; ///< The microseconds part of the timestamp, 0-999.
+        WireMaster::Status status; ///< The status of the read.
+        uint8_t count; ///< The number of bytes in `data`.
+        uint8_t data[cSampleSize]; ///< The read data.
+    };
+
+public:
+    /// Create an empty sampler.
+    ///
+    WireSampler();
+
+    // It makes no sense to copy or move the sampler, the interrupts keep pointers to it.
+    WireSampler(const WireSampler&) = delete;
+    WireSampler& operator=(const WireSampler&) = delete;
+
+public:
+    /// Add a sensor to the sampling table.
+    ///
+    /// Sensors are numbered in the order they are added. The bus has to be initialized.
+    ///
+    /// @param bus The bus of the sensor.
+    /// @param address The 7bit address of the sensor.
+    /// @param registerAddress The first register to read.
+    /// @param count The number of bytes to read, 1-`cSampleSize`.
+    /// @param period The sampling period, at least 1ms.
+    /// @return `Success` or `Error`.
+    ///
+    Status addSensor(WireMaster_SAMD21 &bus, uint8_t address, uint8_t registerAddress, uint8_t count,
+        Milliseconds period);
+
+    /// Start the sampling.
+    ///
+    /// Configures TC3 for a 1ms interrupt. All sensors are read with the first tick.
+    ///
+    /// @return `Success`, `Error` if another sampler is running or `Timeout` if the timer does not respond.
+    ///
+    Status start();
+
+    /// Stop the sampling.
+    ///
+    /// Running reads are finished, but no new reads are started.
+    ///
+    void stop();
+
+    /// Read the next sample of a sensor.
+    ///
+    /// @param sensorIndex The index of the sensor.
+    /// @param sample The variable for the sample.
+    /// @return `true` if a sample was read, `false` if the queue is empty.
+    ///
+    bool readSample(uint8_t sensorIndex, Sample &sample);
+
+    /// Get the number of dropped samples of a sensor, because its queue was full.
+    ///
+    uint32_t getDroppedCount(uint8_t sensorIndex) const;
+
+    /// Handle the timer interrupt.
+    ///
+    void handleTimerInterrupt();
+
+private:
+    /// One sensor with its queue.
+    ///
+    struct Sensor {
+        WireSampler *sampler; ///< The sampler.
+        WireMaster_SAMD21 *bus; ///< The bus of the sensor.
+        uint8_t address; ///< The 7bit address.
+        uint8_t registerAddress; ///< The first register to read.
+        uint8_t count; ///< The number of bytes to read.
+        uint16_t period; ///< The period in milliseconds.
+        uint16_t nextTick; ///< The tick when the next read is due.
+        volatile bool isReading; ///< If a read is running.
+        Sample samples[cQueueSize]; ///< The sample queue.
+        volatile uint8_t head; ///< The write position, only changed by the producer.
+        volatile uint8_t tail; ///< The read position, only changed by the consumer.
+        volatile uint32_t droppedCount; ///< The number of dropped samples.
+    };
+
+private:
+    /// Start the read of a sensor.
+    ///
+    void startRead(Sensor &sensor);
+
+    /// The callback for finished reads.
+    ///
+    static void onReadComplete(void *context, WireMaster::Status status);
+
+private:
+    Sensor _sensors[cSensorCount]; ///< The sensors.
+    uint8_t _sensorCount; ///< The number of sensors.
+    volatile uint16_t _tick; ///< The current tick.
+};
+
+
+}
+
@@ -0,0 +1,178 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "WireScheduler_SAMD21.hpp"
+
+
+#include "hal-common/InterruptLock.hpp"
+#include "hal-common/StatusTools.hpp"
+
+
+namespace lr {
+
+
+WireScheduler::WireScheduler()
+    : _buses(), _busCount(0), _completions(), _completionHead(0), _completionCount(0), _droppedCount(0)
+{
+}
+
+
+WireScheduler::Status WireScheduler::addBus(WireMaster_SAMD21 &bus)
+{
+    if (_busCount >= cBusCount) {
+        return Status::Error;
+    }
+    auto &entry = _buses[_busCount];
+    entry.scheduler = this;
+    entry.master = &bus;
+    entry.index = _busCount;
+    entry.head = 0;
+    entry.count = 0;
+    entry.isActive = false;
+    entry.activeTag = 0;
+    ++_busCount;
+    return Status::Success;
+}
+
+
+WireScheduler::Status WireScheduler::submit(uint8_t busIndex, const Request &request)
+{
+    if (busIndex >= _busCount) {
+        return Status::Error;
+    }
+    auto &bus = _buses[busIndex];
+    InterruptLock lock;
+    if (bus.count >= cRequestQueueSize) {
+        return Status::QueueFull;
+    }
+    bus.requests[(bus.head + bus.count) % cRequestQueueSize] = request;
+    ++bus.count;
+    startNext(bus);
+    return Status::Success;
+}
+
+
+void WireScheduler::poll()
+{
+    InterruptLock lock;
+    for (uint8_t i = 0; i < _busCount; ++i) {
+        startNext(_buses[i]);
+    }
+}
+
+
+bool WireScheduler::getCompletion(Completion &completion)
+{
+    poll();
+    InterruptLock lock;
+    if (_completionCount == 0) {
+        return false;
+    }
+    completion = _completions[_completionHead];
+    _completionHead = (_completionHead + 1) % cCompletionQueueSize;
+    --_completionCount;
+    return true;
+}
+
+
+bool WireScheduler::isIdle() const
+{
+    InterruptLock lock;
+    for (uint8_t i = 0; i < _busCount; ++i) {
+        if (_buses[i].isActive || _buses[i].count > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void WireScheduler::startNext(Bus &bus)
+{
+    while (!bus.isActive && bus.count > 0) {
+        // Keep the request until the bus is free, never wait for the bus here.
+        if (!bus.master->isBusFree()) {
+            return;
+        }
+        const auto request = bus.requests[bus.head];
+        bus.head = (bus.head + 1) % cRequestQueueSize;
+        --bus.count;
+        bus.activeTag = request.tag;
+        bus.isActive = true;
+        const auto status = startRequest(bus, request);
+        if (hasError(status)) {
+            // The transaction did not start, report the error and continue with the next one.
+            bus.isActive = false;
+            addCompletion(bus.index, request.tag, status);
+        }
+    }
+}
+
+
+WireMaster::Status WireScheduler::startRequest(Bus &bus, const Request &request)
+{
+    auto &master = *bus.master;
+    switch (request.operation) {
+    case Operation::Write:
+        return master.writeBytesAsync(request.address, request.data, request.count,
+            &WireScheduler::onTransactionComplete, &bus);
+    case Operation::WriteRegister:
+        return master.writeRegisterDataAsync(request.address, request.registerAddress, request.data, request.count,
+            &WireScheduler::onTransactionComplete, &bus);
+    case Operation::Read:
+        return master.readBytesAsync(request.address, request.data, request.count,
+            &WireScheduler::onTransactionComplete, &bus);
+    case Operation::ReadRegister:
+        return master.readRegisterDataAsync(request.address, request.registerAddress, request.data, request.count,
+            &WireScheduler::onTransactionComplete, &bus);
+    default:
+        break;
+    }
+    return WireMaster::Status::Error;
+}
+
+
+void WireScheduler::addCompletion(uint8_t busIndex, uint16_t tag, WireMaster::Status status)
+{
+    if (_completionCount >= cCompletionQueueSize) {
+        // Drop the oldest completion.
+        _completionHead = (_completionHead + 1) % cCompletionQueueSize;
+        --_completionCount;
+        ++_droppedCount;
+    }
+    auto &completion = _completions[(_completionHead + _completionCount) % cCompletionQueueSize];
+    completion.tag = tag;
+    completion.bus = busIndex;
+    completion.status = status;
+    ++_completionCount;
+}
+
+
+void WireScheduler::onTransactionComplete(void *context, WireMaster::Status status)
+{
+    auto &bus = *static_cast<Bus*>(context);
+    auto &scheduler = *bus.scheduler;
+    InterruptLock lock;
+    bus.isActive = false;
+    scheduler.addCompletion(bus.index, bus.activeTag, status);
+    scheduler.startNext(bus);
+}
+
+
+}
+
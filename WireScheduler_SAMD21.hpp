@@ -0,0 +1,209 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+
+#include "WireMaster_SAMD21.hpp"
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// A scheduler for transactions on multiple I2C buses.
+///
+/// Each bus has its own queue of requests. The scheduler starts the requests using the
+/// asynchronous transactions of `WireMaster_SAMD21`, and starts the next request of a bus
+/// directly from the completion interrupt. This way transactions on different SERCOM
+/// interfaces run at the same time, and the total latency is the latency of the slowest
+/// bus instead of the sum of all buses.
+///
+/// The results of all buses are collected in a single completion queue.
+///
+/// Starting a request never waits for a bus. If a bus is used by another master, the
+/// request stays in the queue and is started by the next call of `poll()`, which is
+/// also done by `submit()` and `getCompletion()`.
+///
+/// Example:
+/// ```
+/// WireScheduler gScheduler;
+/// gScheduler.addBus(gWireA);
+/// gScheduler.addBus(gWireB);
+/// gScheduler.submit(0, {1, 0x40, 0x00, WireScheduler::Operation::ReadRegister, bufferA, 6});
+/// gScheduler.submit(1, {2, 0x40, 0x00, WireScheduler::Operation::ReadRegister, bufferB, 6});
+/// WireScheduler::Completion completion;
+/// while (gScheduler.getCompletion(completion)) { ... }
+/// ```
+///
+/// @note Do not use the blocking methods of a bus while it is used by the scheduler.
+///
+class WireScheduler
+{
+public:
+    /// The status of a scheduler call.
+    ///
+    enum class Status : uint8_t {
+        Success, ///< The call was successful.
+        Error, ///< Invalid parameter or no free bus slot.
+        QueueFull, ///< The request queue of the bus is full.
+    };
+
+    /// The maximum number of buses.
+    ///
+    static constexpr uint8_t cBusCount = 6;
+
+    /// The size of the request queue for each bus.
+    ///
+    static constexpr uint8_t cRequestQueueSize = 8;
+
+    /// The size of the completion queue.
+    ///
+    static constexpr uint8_t cCompletionQueueSize = 16;
+
+    /// The operation of a request.
+    ///
+    enum class Operation : uint8_t {
+        Write, ///< Write the bytes.
+        WriteRegister, ///< Write the register address and the bytes.
+        Read, ///< Read the bytes.
+        ReadRegister, ///< Write the register address and read the bytes after a repeated start.
+    };
+
+    /// A request for a transaction.
+    ///
+    struct Request {
+        uint16_t tag; ///< A tag to identify the request in the completion queue.
+        uint8_t address; ///< The 7bit address of the device.
+        uint8_t registerAddress; ///< The register address for the register operations.
+        Operation operation; ///< The operation.
+        uint8_t *data; ///< The data buffer, must stay valid until the request is completed.
+        uint8_t count; ///< The number of bytes.
+    };
+
+    /// A completed request.
+    ///
+    struct Completion {
+        uint16_t tag; ///< The tag of the request.
+        uint8_t bus; ///< The index of the bus.
+        WireMaster::Status status; ///< The result of the transaction.
+    };
+
+public:
+    /// Create a new scheduler without buses.
+    ///
+    WireScheduler();
+
+    // It makes no sense to copy or move the scheduler, the buses keep pointers to it.
+    WireScheduler(const WireScheduler&) = delete;
+    WireScheduler& operator=(const WireScheduler&) = delete;
+
+public:
+    /// Add a bus to the scheduler.
+    ///
+    /// The bus has to be initialized. Buses are numbered in the order they are added.
+    ///
+    /// @param bus The bus to add.
+    /// @return `Success` or `Error` if all bus slots are used.
+    ///
+    Status addBus(WireMaster_SAMD21 &bus);
+
+    /// Submit a request for a bus.
+    ///
+    /// If the bus is idle, the transaction is started immediately.
+    ///
+    /// @param busIndex The index of the bus.
+    /// @param request The request.
+    /// @return `Success`, `QueueFull` if the queue of the bus is full or
+    ///     `Error` for an invalid bus index.
+    ///
+    Status submit(uint8_t busIndex, const Request &request);
+
+    /// Start the queued requests of all buses which are free.
+    ///
+    /// Call this regularly if the buses are shared with other masters.
+    ///
+    void poll();
+
+    /// Get the next completed request.
+    ///
+    /// This also calls `poll()`. If the completion queue overflows, the oldest completions
+    /// are dropped.
+    ///
+    /// @param completion The variable to store the completion.
+    /// @return `true` if a completion was returned, `false` if the queue is empty.
+    ///
+    bool getCompletion(Completion &completion);
+
+    /// Check if all requests are completed.
+    ///
+    bool isIdle() const;
+
+    /// Get the number of completions which were dropped because the queue was full.
+    ///
+    inline uint32_t getDroppedCount() const { return _droppedCount; }
+
+private:
+    /// The state of one bus.
+    ///
+    struct Bus {
+        WireScheduler *scheduler; ///< The scheduler of this bus.
+        WireMaster_SAMD21 *master; ///< The bus.
+        uint8_t index; ///< The index of this bus.
+        Request requests[cRequestQueueSize]; ///< The queue with the requests.
+        uint8_t head; ///< The index of the next request.
+        uint8_t count; ///< The number of queued requests.
+        volatile bool isActive; ///< If a transaction is running.
+        uint16_t activeTag; ///< The tag of the running transaction.
+    };
+
+private:
+    /// Start the next request of a bus, if the bus is idle.
+    ///
+    /// If the bus is used by another master, the request stays in the queue. Must be called
+    /// with disabled interrupts.
+    ///
+    void startNext(Bus &bus);
+
+    /// Start a request.
+    ///
+    static WireMaster::Status startRequest(Bus &bus, const Request &request);
+
+    /// Add a completion to the completion queue.
+    ///
+    /// Must be called with disabled interrupts.
+    ///
+    void addCompletion(uint8_t busIndex, uint16_t tag, WireMaster::Status status);
+
+    /// The callback for finished transactions.
+    ///
+    static void onTransactionComplete(void *context, WireMaster::Status status);
+
+private:
+    Bus _buses[cBusCount]; ///< The buses.
+    uint8_t _busCount; ///< The number of buses.
+    Completion _completions[cCompletionQueueSize]; ///< The completion queue.
+    uint8_t _completionHead; ///< The index of the next completion.
+    volatile uint8_t _completionCount; ///< The number of completions in the queue.
+    uint32_t _droppedCount; ///< The number of dropped completions.
+};
+
+
+}
+
@@ -0,0 +1,214 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "WireSlave_SAMD21.hpp"
+
+
+#include "GPIO_SAMD21.hpp"
+#include "SercomInterrupt_SAMD21.hpp"
+#include "SpinDeadline_SAMD21.hpp"
+
+
+namespace lr {
+
+
+namespace {
+
+
+/// The value returned for registers outside of the register file.
+///
+const uint8_t cUnmappedValue = 0xffu;
+
+
+/// The command to send.
+///
+enum class Command : uint8_t {
+    WaitForStart = 0x2, ///< Wait for any start condition.
+    Continue = 0x3, ///< Execute the acknowledge action and continue the transfer.
+};
+
+
+/// Send a command with an ACK.
+///
+/// @param sercom The SERCOM interface to use.
+/// @param command The command to send.
+///
+inline void sendCommand(Sercom *sercom, Command command)
+{
+    sercom->I2CS.CTRLB.reg = SERCOM_I2CS_CTRLB_SMEN|SERCOM_I2CS_CTRLB_CMD(static_cast<uint8_t>(command));
+}
+
+
+}
+
+
+WireSlave_SAMD21::WireSlave_SAMD21(Interface interface, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL)
+:
+    _interface(interface),
+    _sercom(WireMaster_SAMD21::getSercom(interface)),
+    _pinSDA(pinSDA),
+    _pinSCL(pinSCL),
+    _registers(nullptr),
+    _size(0),
+    _writableSize(0),
+    _pointer(0),
+    _expectPointer(true),
+    _writeCount(0)
+{
+}
+
+
+void WireSlave_SAMD21::setRegisterFile(uint8_t *registers, uint16_t size, uint16_t writableSize)
+{
+    _registers = registers;
+    _size = (size > 0x100u) ? 0x100u : size;
+    _writableSize = (writableSize > _size) ? _size : writableSize;
+}
+
+
+WireSlave_SAMD21::Status WireSlave_SAMD21::initialize(uint8_t address)
+{
+    // Enable the clock for the SERCOM interface.
+    GCLK->CLKCTRL.reg =
+        GCLK_CLKCTRL_ID(WireMaster_SAMD21::getClockId(_interface)) |
+        GCLK_CLKCTRL_GEN_GCLK0 | // Source is clock generator 0
+        GCLK_CLKCTRL_CLKEN; // Enable it.
+    SpinDeadline gclkTimer(10_ms);
+    while (GCLK->STATUS.reg & GCLK_STATUS_SYNCBUSY) {
+        if (gclkTimer.hasTimeout()) {
+            return Status::Timeout;
+        }
+    }
+
+    // Reset the interface.
+    _sercom->I2CS.CTRLA.bit.SWRST = 1;
+    SpinDeadline opTimer(100_ms);
+    while (_sercom->I2CS.CTRLA.bit.SWRST||_sercom->I2CS.SYNCBUSY.bit.SWRST) {
+        if (opTimer.hasTimeout()) {
+            return Status::Timeout;
+        }
+    }
+
+    // Configure slave mode.
+    _sercom->I2CS.CTRLA.reg =
+        SERCOM_I2CS_CTRLA_MODE(SERCOM_I2CS_CTRLA_MODE_I2C_SLAVE_Val)| // Act as slave on the bus.
+        SERCOM_I2CS_CTRLA_SDAHOLD(0x2)| // SDA hold time 300-600ns
+        SERCOM_I2CS_CTRLA_LOWTOUTEN; // Enable time-out if the clock held low.
+    // Enable smart mode, ACK is sent when DATA is accessed.
+    _sercom->I2CS.CTRLB.reg = SERCOM_I2CS_CTRLB_SMEN;
+    // Match only the one address.
+    _sercom->I2CS.ADDR.reg = SERCOM_I2CS_ADDR_ADDR(address);
+    // Enable the interrupts.
+    _sercom->I2CS.INTENSET.reg = SERCOM_I2CS_INTENSET_AMATCH|SERCOM_I2CS_INTENSET_DRDY|
+        SERCOM_I2CS_INTENSET_PREC|SERCOM_I2CS_INTENSET_ERROR;
+    SercomInterrupt::setCallback(WireMaster_SAMD21::getSercomIndex(_interface), [](void *context) {
+        static_cast<WireSlave_SAMD21*>(context)->handleInterrupt();
+    }, this);
+    _expectPointer = true;
+
+    // Enable the SERCOM interface.
+    _sercom->I2CS.CTRLA.bit.ENABLE = 1;
+    SpinDeadline syncTimer(10_ms);
+    while (_sercom->I2CS.SYNCBUSY.bit.ENABLE != 0) {
+        if (syncTimer.hasTimeout()) {
+            return Status::Timeout;
+        }
+    }
+
+    // Set the pin peripheral mode.
+    GPIO::setFunction(_pinSDA, WireMaster_SAMD21::getPinFunction(_interface));
+    GPIO::setFunction(_pinSCL, WireMaster_SAMD21::getPinFunction(_interface));
+    return Status::Success;
+}
+
+
+void WireSlave_SAMD21::disable()
+{
+    SercomInterrupt::setCallback(WireMaster_SAMD21::getSercomIndex(_interface), nullptr, nullptr);
+    _sercom->I2CS.INTENCLR.reg = SERCOM_I2CS_INTENCLR_AMATCH|SERCOM_I2CS_INTENCLR_DRDY|
+        SERCOM_I2CS_INTENCLR_PREC|SERCOM_I2CS_INTENCLR_ERROR;
+    _sercom->I2CS.CTRLA.bit.ENABLE = 0;
+}
+
+
+void WireSlave_SAMD21::handleInterrupt()
+{
+    const auto flags = _sercom->I2CS.INTFLAG.reg;
+    if ((flags & SERCOM_I2CS_INTFLAG_ERROR) != 0) {
+        _sercom->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_ERROR;
+    }
+    if ((flags & SERCOM_I2CS_INTFLAG_AMATCH) != 0) {
+        // A new write starts with the register pointer, a read continues at the pointer.
+        if (!_sercom->I2CS.STATUS.bit.DIR) {
+            _expectPointer = true;
+        }
+        // Acknowledge the address.
+        sendCommand(_sercom, Command::Continue);
+        return;
+    }
+    if ((flags & SERCOM_I2CS_INTFLAG_DRDY) != 0) {
+        if (_sercom->I2CS.STATUS.bit.DIR) {
+            // The master reads, stop sending if it did not acknowledge the last byte.
+            if (_sercom->I2CS.STATUS.bit.RXNACK && !_sercom->I2CS.STATUS.bit.SR) {
+                sendCommand(_sercom, Command::WaitForStart);
+            } else {
+                // Writing the data continues the transfer in smart mode.
+                _sercom->I2CS.DATA.reg = readRegister();
+            }
+        } else {
+            // Reading the data sends the ACK in smart mode.
+            const uint8_t value = _sercom->I2CS.DATA.reg;
+            if (_expectPointer) {
+                _pointer = value;
+                _expectPointer = false;
+            } else {
+                writeRegister(value);
+            }
+        }
+        return;
+    }
+    if ((flags & SERCOM_I2CS_INTFLAG_PREC) != 0) {
+        _sercom->I2CS.INTFLAG.reg = SERCOM_I2CS_INTFLAG_PREC;
+        _expectPointer = true;
+    }
+}
+
+
+uint8_t WireSlave_SAMD21::readRegister()
+{
+    const uint8_t pointer = _pointer;
+    _pointer = pointer + 1;
+    if (pointer >= _size) {
+        return cUnmappedValue;
+    }
+    return _registers[pointer];
+}
+
+
+void WireSlave_SAMD21::writeRegister(uint8_t value)
+{
+    const uint8_t pointer = _pointer;
+    _pointer = pointer + 1;
+    if (pointer < _writableSize) {
+        _registers[pointer] = value;
+        _writeCount = _writeCount + 1;
+    }
+}
+
+
+}
+
@@ -0,0 +1,131 @@
+#pragma once
+//
+// Wire Slave - SAM D21
+// ---------------------------------------------------------------------------
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "WireMaster_SAMD21.hpp"
+
+#include "hal-core/Chip.hpp"
+
+
+namespace lr {
+
+
+/// An interrupt driven I2C slave for SAM D21 chips.
+///
+/// The slave emulates a register file, like most I2C devices. The first byte a master
+/// writes sets the register pointer, all following bytes are written to the register
+/// file. A read returns the bytes from the register file, starting at the register
+/// pointer. The pointer is incremented after each byte.
+///
+/// All requests are answered from the interrupt handler, directly from the register file
+/// memory. There are no callbacks into the application.
+///
+class WireSlave_SAMD21
+{
+public:
+    /// The SERCOM interface to use.
+    ///
+    using Interface = WireMaster_SAMD21::Interface;
+
+    /// The status of a call.
+    ///
+    enum class Status : uint8_t {
+        Success, ///< The call was successful.
+        Error, ///< There was an error.
+        Timeout, ///< The call timed out.
+    };
+
+public:
+    /// Create a new I2C slave instance.
+    ///
+    /// @param interface The SERCOM inerface to use.
+    /// @param pinSDA The arduino pin number for the used SDA pin.
+    /// @param pinSCL The arduino pin number for the used SCL pin.
+    ///
+    WireSlave_SAMD21(Interface interface, GPIO::PinNumber pinSDA, GPIO::PinNumber pinSCL);
+
+    /// Create a new I2C slave instance.
+    ///
+    template<typename PinType>
+    inline WireSlave_SAMD21(Interface interface, PinType pinSDA, PinType pinSCL)
+        : WireSlave_SAMD21(interface, static_cast<GPIO::PinNumber>(pinSDA), static_cast<GPIO::PinNumber>(pinSCL))
+    {
+    }
+
+public:
+    /// Set the register file.
+    ///
+    /// Call this before `initialize()`. The memory must stay valid as long the slave is
+    /// enabled. Reads beyond the size return `0xff`, writes beyond the size are ignored.
+    ///
+    /// @param registers The memory for the register file.
+    /// @param size The size of the register file, up to 256 bytes.
+    /// @param writableSize The number of registers, from the start, the master can write.
+    ///
+    void setRegisterFile(uint8_t *registers, uint16_t size, uint16_t writableSize);
+
+    /// Initialize the slave and start listening on the bus.
+    ///
+    /// @param address The 7bit address of this slave.
+    /// @return `Success`, or `Timeout` if the interface does not respond.
+    ///
+    Status initialize(uint8_t address);
+
+    /// Disable the slave.
+    ///
+    void disable();
+
+    /// Get the number of bytes written by the master.
+    ///
+    /// The counter is incremented for every byte written into the register file. Compare it
+    /// with a previous value, to detect changes.
+    ///
+    inline uint32_t getWriteCount() const { return _writeCount; }
+
+    /// Handle the SERCOM interrupt.
+    ///
+    void handleInterrupt();
+
+private:
+    /// Read the register at the current pointer and increment it.
+    ///
+    uint8_t readRegister();
+
+    /// Write the register at the current pointer and increment it.
+    ///
+    void writeRegister(uint8_t value);
+
+private:
+    const Interface _interface; ///< The interface to use.
+    Sercom *_sercom; ///< The link to the low level SERCOM interface.
+    const GPIO::PinNumber _pinSDA; ///< The arduino pin number for the SDA pin.
+    const GPIO::PinNumber _pinSCL; ///< The arduino pin number for the SCL pin.
+    uint8_t *_registers; ///< The register file.
+    uint16_t _size; ///< The size of the register file.
+    uint16_t _writableSize; ///< The number of writable registers.
+    volatile uint8_t _pointer; ///< The register pointer.
+    volatile bool _expectPointer; ///< If the next written byte is the register pointer.
+    volatile uint32_t _writeCount; ///< The number of written bytes.
+};
+
+
+}
+
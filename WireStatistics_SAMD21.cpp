@@ -0,0 +1,154 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+#include "WireStatistics_SAMD21.hpp"
+
+
+#include "ClockCycles.hpp"
+
+
+namespace lr {
+
+
+WireStatistics::WireStatistics()
+{
+    reset();
+}
+
+
+const WireStatistics::Device* WireStatistics::getDevice(uint8_t address) const
+{
+    for (uint8_t i = 0; i < _deviceCount; ++i) {
+        if (_devices[i].address == address) {
+            return &_devices[i];
+        }
+    }
+    return nullptr;
+}
+
+
+void WireStatistics::reset()
+{
+    for (auto &device : _devices) {
+        device = Device();
+    }
+    _deviceCount = 0;
+    _untrackedCount = 0;
+    _address = 0;
+    _phase = Phase::Ready;
+    _transactionStart = 0;
+    _phaseStart = 0;
+    for (auto &cycles : _phaseCycles) {
+        cycles = 0;
+    }
+    _bytes = 0;
+}
+
+
+void WireStatistics::begin(uint8_t address)
+{
+    _address = address;
+    _phase = Phase::Ready;
+    for (auto &cycles : _phaseCycles) {
+        cycles = 0;
+    }
+    _bytes = 0;
+    _transactionStart = ClockCycles::getCounter();
+    _phaseStart = _transactionStart;
+}
+
+
+void WireStatistics::enterPhase(Phase phase)
+{
+    const auto now = ClockCycles::getCounter();
+    _phaseCycles[static_cast<uint8_t>(_phase)] += (now - _phaseStart);
+    _phaseStart = now;
+    _phase = phase;
+}
+
+
+void WireStatistics::end(WireMaster::Status status)
+{
+    enterPhase(Phase::Ready);
+    auto device = findDevice(_address);
+    if (device == nullptr) {
+        ++_untrackedCount;
+        return;
+    }
+    const bool isFirst = (device->transactions == 0);
+    ++device->transactions;
+    device->bytes += _bytes;
+    switch (status) {
+    case WireMaster::Status::Success:
+        break;
+    case WireMaster::Status::NoAcknowledge:
+    case WireMaster::Status::AddressNotFound:
+        ++device->noAcknowledges;
+        break;
+    case WireMaster::Status::Timeout:
+        ++device->timeouts;
+        break;
+    default:
+        ++device->errors;
+        break;
+    }
+    const uint32_t totalCycles = _phaseStart - _transactionStart;
+    updateLatency(device->total, totalCycles, isFirst);
+    for (uint8_t i = 0; i < cPhaseCount; ++i) {
+        updateLatency(device->phases[i], _phaseCycles[i], isFirst);
+    }
+    const uint32_t microseconds = totalCycles / ClockCycles::getPerMicrosecond();
+    uint8_t bucket = 0;
+    while (bucket < (cHistogramSize - 1) && microseconds >= (static_cast<uint32_t>(32) << bucket)) {
+        ++bucket;
+    }
+    if (device->histogram[bucket] < UINT16_MAX) {
+        ++device->histogram[bucket];
+    }
+}
+
+
+WireStatistics::Device* WireStatistics::findDevice(uint8_t address)
+{
+    for (uint8_t i = 0; i < _deviceCount; ++i) {
+        if (_devices[i].address == address) {
+            return &_devices[i];
+        }
+    }
+    if (_deviceCount >= cDeviceCount) {
+        return nullptr;
+    }
+    auto device = &_devices[_deviceCount++];
+    device->address = address;
+    return device;
+}
+
+
+void WireStatistics::updateLatency(Latency &latency, uint32_t cycles, bool isFirst)
+{
+    if (isFirst || cycles < latency.minimum) {
+        latency.minimum = cycles;
+    }
+    if (isFirst || cycles > latency.maximum) {
+        latency.maximum = cycles;
+    }
+}
+
+
+}
+
@@ -0,0 +1,155 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "hal-common/WireMaster.hpp"
+
+#include <cstdint>
+
+
+namespace lr {
+
+
+/// Latency and error statistics for the I2C transactions per device address.
+///
+/// The statistics are only collected by `WireMaster_SAMD21` if the library is compiled
+/// with `HAL_FEATHER_M0_WIRE_STATISTICS` defined. Use the CMake function
+/// `hal_feature_wire_statistics()` to enable it. Without the definition, the driver
+/// contains no code and no data for the statistics.
+///
+/// All latencies are measured in clock cycles using `ClockCycles::getCounter()`.
+///
+class WireStatistics
+{
+public:
+    /// The phase of a transaction.
+    ///
+    enum class Phase : uint8_t {
+        Ready, ///< Waiting for the bus to be ready.
+        Address, ///< Sending the address and waiting for the acknowledge.
+        Data, ///< Sending or receiving the data bytes.
+        Stop, ///< Sending the stop condition and waiting for the idle bus.
+    };
+
+    /// The number of phases.
+    ///
+    static constexpr uint8_t cPhaseCount = 4;
+
+    /// The number of devices with statistics.
+    ///
+    static constexpr uint8_t cDeviceCount = 8;
+
+    /// The number of histogram buckets.
+    ///
+    /// Bucket `n` counts the transactions which took less than `32µs << n`, the last
+    /// bucket counts all longer transactions.
+    ///
+    static constexpr uint8_t cHistogramSize = 8;
+
+    /// The minimum and maximum latency of a phase.
+    ///
+    struct Latency {
+        uint32_t minimum; ///< The minimum latency in clock cycles.
+        uint32_t maximum; ///< The maximum latency in clock cycles.
+    };
+
+    /// The statistics of one device.
+    ///
+    struct Device {
+        uint8_t address; ///< The 7bit address of the device.
+        uint32_t transactions; ///< The number of transactions.
+        uint32_t bytes; ///< The number of data bytes moved.
+        uint16_t noAcknowledges; ///< Transactions failed with a NACK.
+        uint16_t timeouts; ///< Transactions failed with a timeout.
+        uint16_t errors; ///< Transactions failed with any other error.
+        Latency total; ///< The latency of the whole transaction.
+        Latency phases[cPhaseCount]; ///< The latency of each phase.
+        uint16_t histogram[cHistogramSize]; ///< The histogram of the transaction latency.
+    };
+
+public:
+    /// Create empty statistics.
+    ///
+    WireStatistics();
+
+public:
+    /// Get the statistics for a device.
+    ///
+    /// @param address The 7bit address of the device.
+    /// @return The statistics, or `nullptr` if there was no transaction with this device.
+    ///
+    const Device* getDevice(uint8_t address) const;
+
+    /// Get the number of transactions which were not recorded, because the table was full.
+    ///
+    inline uint32_t getUntrackedCount() const { return _untrackedCount; }
+
+    /// Reset all statistics.
+    ///
+    void reset();
+
+public: // Recording, used by the driver.
+    /// Start a new transaction.
+    ///
+    /// @param address The 7bit address of the device.
+    ///
+    void begin(uint8_t address);
+
+    /// Enter a new phase of the current transaction.
+    ///
+    /// The time since the last phase change is added to the current phase.
+    ///
+    /// @param phase The new phase.
+    ///
+    void enterPhase(Phase phase);
+
+    /// Add data bytes to the current transaction.
+    ///
+    inline void addBytes(uint16_t count) { _bytes += count; }
+
+    /// End the current transaction and record the statistics.
+    ///
+    /// @param status The result of the transaction.
+    ///
+    void end(WireMaster::Status status);
+
+private:
+    /// Find or allocate the entry for a device.
+    ///
+    Device* findDevice(uint8_t address);
+
+    /// Update a latency with a new value.
+    ///
+    static void updateLatency(Latency &latency, uint32_t cycles, bool isFirst);
+
+private:
+    Device _devices[cDeviceCount]; ///< The statistics for each device.
+    uint8_t _deviceCount; ///< The number of used entries.
+    uint32_t _untrackedCount; ///< The number of transactions not recorded.
+    uint8_t _address; ///< The address of the current transaction.
+    Phase _phase; ///< The current phase.
+    uint32_t _transactionStart; ///< The cycle counter at the start of the transaction.
+    uint32_t _phaseStart; ///< The cycle counter at the start of the current phase.
+    uint32_t _phaseCycles[cPhaseCount]; ///< The cycles for each phase of the current transaction.
+    uint32_t _bytes; ///< The bytes of the current transaction.
+};
+
+
+}
+
@@ -0,0 +1,67 @@
+# Compare the generated code of the pin access through the APB bridge and the IOBUS.
+#
+# Usage: cmake -DOBJDUMP=<objdump> -DOBJECT=<object file> -P ComparePinAccess.cmake
+#
+# Prints the instructions of each function from `PinAccessCode.cpp`. Fails if an IOBUS
+# variant has more instructions than the APB variant, or if it does not load an address
+# of the IOBUS alias (0x60000000) of the PORT registers (0x41004400).
+
+if(NOT OBJDUMP)
+    message(FATAL_ERROR "No objdump found, the toolchain has to set CMAKE_OBJDUMP.")
+endif()
+execute_process(COMMAND ${OBJDUMP} -d --no-show-raw-insn ${OBJECT}
+        OUTPUT_VARIABLE dump RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Could not disassemble ${OBJECT}.")
+endif()
+
+# Split the output into lines, objdump uses semicolons for comments.
+string(REPLACE ";" "#" dump "${dump}")
+string(REPLACE "\n" ";" lines "${dump}")
+
+# Collect the instructions and the literal words of each function.
+set(function "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^[0-9a-f]+ <([A-Za-z0-9_]+)>:$")
+        set(function "${CMAKE_MATCH_1}")
+        set(${function}_instructions "")
+        set(${function}_words "")
+    elseif(function AND line MATCHES "^ +[0-9a-f]+:\t\\.word\t0x([0-9a-f]+)")
+        list(APPEND ${function}_words "${CMAKE_MATCH_1}")
+    elseif(function AND line MATCHES "^ +[0-9a-f]+:\t(.+)$")
+        string(REGEX REPLACE "[ \t]+" " " instruction "${CMAKE_MATCH_1}")
+        list(APPEND ${function}_instructions "${instruction}")
+    endif()
+endforeach()
+
+set(failed FALSE)
+foreach(operation SetOutputHigh ToggleOutput)
+    set(apb pinAccessApb${operation})
+    set(ioBus pinAccessIoBus${operation})
+    foreach(name ${apb} ${ioBus})
+        list(LENGTH ${name}_instructions count)
+        set(${name}_count ${count})
+        message(STATUS "${name}: ${count} instructions, literals: ${${name}_words}")
+        foreach(instruction IN LISTS ${name}_instructions)
+            message(STATUS "    ${instruction}")
+        endforeach()
+    endforeach()
+    if(${apb}_count EQUAL 0 OR ${ioBus}_count EQUAL 0)
+        message(SEND_ERROR "The functions for ${operation} are missing in the disassembly.")
+        set(failed TRUE)
+    elseif(${ioBus}_count GREATER ${apb}_count)
+        message(SEND_ERROR "The IOBUS variant of ${operation} has more instructions than the APB variant.")
+        set(failed TRUE)
+    endif()
+    if(NOT "${${ioBus}_words}" MATCHES "(^|;)600000[0-9a-f][0-9a-f]")
+        message(SEND_ERROR "The IOBUS variant of ${operation} does not use the IOBUS address.")
+        set(failed TRUE)
+    endif()
+    if(NOT "${${apb}_words}" MATCHES "(^|;)410044[0-9a-f][0-9a-f]")
+        message(SEND_ERROR "The APB variant of ${operation} does not use the PORT address.")
+        set(failed TRUE)
+    endif()
+endforeach()
+if(failed)
+    message(FATAL_ERROR "The pin access comparison failed.")
+endif()
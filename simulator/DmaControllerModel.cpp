@@ -0,0 +1,311 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "DmaControllerModel.hpp"
+
+
+#include "I2cMasterModel.hpp"
+
+
+namespace lr::sim {
+
+
+namespace {
+
+
+/// The number of SERCOM interfaces with triggers.
+///
+constexpr uint8_t cSercomCount = 6;
+
+
+}
+
+
+DmaControllerModel::DmaControllerModel(Dmac &registers) noexcept
+    : _registers(registers), _channels(), _beatCount(0)
+{
+    _registers.CTRL.cell.connect(this, CTRL);
+    _registers.CHID.cell.connect(this, CHID);
+    _registers.CHCTRLA.cell.connect(this, CHCTRLA);
+    _registers.CHCTRLB.cell.connect(this, CHCTRLB);
+    _registers.CHINTENCLR.cell.connect(this, CHINTENCLR);
+    _registers.CHINTENSET.cell.connect(this, CHINTENSET);
+    _registers.CHINTFLAG.cell.connect(this, CHINTFLAG);
+    _registers.INTPEND.cell.connect(this, INTPEND);
+    _registers.INTSTATUS.cell.connect(this, INTSTATUS);
+    for (auto &channel : _channels) {
+        resetChannel(channel);
+    }
+}
+
+
+bool DmaControllerModel::isInterruptActive() const
+{
+    return getPendingChannel() < cChannelCount;
+}
+
+
+void DmaControllerModel::updateTriggers(Cycles now)
+{
+    for (auto &channel : _channels) {
+        if (channel.isEnabled && channel.beatTime == cNoEvent && isTriggerActive(channel)) {
+            channel.beatTime = now + cTriggerLatency;
+        }
+    }
+}
+
+
+Cycles DmaControllerModel::getNextEvent() const
+{
+    Cycles result = cNoEvent;
+    for (const auto &channel : _channels) {
+        if (channel.beatTime < result) {
+            result = channel.beatTime;
+        }
+    }
+    return result;
+}
+
+
+void DmaControllerModel::processEvents(Cycles now)
+{
+    for (auto &channel : _channels) {
+        if (channel.beatTime > now) {
+            continue;
+        }
+        channel.beatTime = cNoEvent;
+        // The trigger may be gone, e.g. if the channel was disabled.
+        if (channel.isEnabled && isTriggerActive(channel)) {
+            transferBeat(channel);
+        }
+    }
+}
+
+
+uint32_t DmaControllerModel::readRegister(uint8_t index, uint32_t stored)
+{
+    const auto &channel = _channels[_registers.CHID.cell.stored() % cChannelCount];
+    uint32_t value;
+    switch (index) {
+    case CTRL:
+        value = stored & ~DMAC_CTRL_SWRST; // The reset is immediate.
+        break;
+    case CHCTRLA:
+        value = channel.isEnabled ? DMAC_CHCTRLA_ENABLE : 0;
+        break;
+    case CHCTRLB:
+        value = channel.control;
+        break;
+    case CHINTENCLR:
+    case CHINTENSET:
+        value = channel.intEnable;
+        break;
+    case CHINTFLAG:
+        value = channel.intFlags;
+        break;
+    case INTPEND: {
+        const auto pending = getPendingChannel();
+        if (pending < cChannelCount) {
+            value = pending | (static_cast<uint32_t>(_channels[pending].intFlags & 0x7u) << 8u);
+        } else {
+            value = 0;
+        }
+        break;
+    }
+    case INTSTATUS:
+        value = 0;
+        for (uint8_t i = 0; i < cChannelCount; ++i) {
+            if ((_channels[i].intFlags & _channels[i].intEnable) != 0) {
+                value |= (1u << i);
+            }
+        }
+        break;
+    default:
+        value = stored;
+        break;
+    }
+    accessRegister();
+    return value;
+}
+
+
+void DmaControllerModel::writeRegister(uint8_t index, uint32_t &stored, uint32_t value)
+{
+    const auto channelIndex = static_cast<uint8_t>(_registers.CHID.cell.stored() % cChannelCount);
+    auto &channel = _channels[channelIndex];
+    switch (index) {
+    case CTRL:
+        if ((value & DMAC_CTRL_SWRST) != 0) {
+            for (auto &resetChannelState : _channels) {
+                resetChannel(resetChannelState);
+            }
+            stored = 0;
+        } else {
+            stored = value;
+        }
+        break;
+    case CHCTRLA:
+        if ((value & DMAC_CHCTRLA_SWRST) != 0) {
+            resetChannel(channel);
+        } else if ((value & DMAC_CHCTRLA_ENABLE) != 0) {
+            if (!channel.isEnabled) {
+                enableChannel(channelIndex);
+            }
+        } else {
+            channel.isEnabled = false;
+            channel.beatTime = cNoEvent;
+        }
+        break;
+    case CHCTRLB:
+        channel.control = value;
+        break;
+    case CHINTENCLR:
+        channel.intEnable &= static_cast<uint8_t>(~value);
+        break;
+    case CHINTENSET:
+        channel.intEnable |= static_cast<uint8_t>(value);
+        break;
+    case CHINTFLAG:
+        channel.intFlags &= static_cast<uint8_t>(~value);
+        break;
+    case INTPEND:
+    case INTSTATUS:
+        break; // Not simulated, or read-only.
+    default:
+        stored = value;
+        break;
+    }
+    accessRegister();
+}
+
+
+void DmaControllerModel::resetChannel(Channel &channel)
+{
+    channel.isEnabled = false;
+    channel.control = 0;
+    channel.intEnable = 0;
+    channel.intFlags = 0;
+    channel.descriptor = DmacDescriptor{};
+    channel.remaining = 0;
+    channel.beatTime = cNoEvent;
+}
+
+
+void DmaControllerModel::enableChannel(uint8_t channelIndex)
+{
+    auto &channel = _channels[channelIndex];
+    const auto table = reinterpret_cast<const DmacDescriptor*>(_registers.BASEADDR.reg);
+    if ((_registers.CTRL.cell.stored() & DMAC_CTRL_DMAENABLE) == 0 || table == nullptr ||
+        !loadDescriptor(channel, &table[channelIndex])) {
+        channel.intFlags |= DMAC_CHINTFLAG_TERR;
+        return;
+    }
+    channel.isEnabled = true;
+    updateTriggers(getCycles());
+}
+
+
+bool DmaControllerModel::loadDescriptor(Channel &channel, const DmacDescriptor *descriptor)
+{
+    channel.descriptor = *descriptor;
+    channel.remaining = channel.descriptor.BTCNT.reg;
+    return (channel.descriptor.BTCTRL.reg & DMAC_BTCTRL_VALID) != 0 && channel.remaining > 0;
+}
+
+
+bool DmaControllerModel::isTriggerActive(const Channel &channel) const
+{
+    const auto trigger = static_cast<uint8_t>((channel.control >> 8u) & 0x3fu);
+    if (trigger == 0 || trigger > cSercomCount * 2) {
+        return false; // Software triggers and other peripherals are not simulated.
+    }
+    const auto sercomIndex = static_cast<uint8_t>((trigger - 1u) / 2u);
+    auto &sercom = getI2cMaster(sercomIndex);
+    return ((trigger & 0x1u) != 0) ? sercom.isRxTriggerActive() : sercom.isTxTriggerActive();
+}
+
+
+void DmaControllerModel::transferBeat(Channel &channel)
+{
+    auto &descriptor = channel.descriptor;
+    const auto offset = static_cast<uintptr_t>(descriptor.BTCNT.reg - channel.remaining);
+    // With increment, the descriptor contains the address after the last byte.
+    auto source = descriptor.SRCADDR.reg;
+    if ((descriptor.BTCTRL.reg & DMAC_BTCTRL_SRCINC) != 0) {
+        source = source - descriptor.BTCNT.reg + offset;
+    }
+    auto destination = descriptor.DSTADDR.reg;
+    if ((descriptor.BTCTRL.reg & DMAC_BTCTRL_DSTINC) != 0) {
+        destination = destination - descriptor.BTCNT.reg + offset;
+    }
+    writeByte(destination, readByte(source));
+    ++_beatCount;
+    if (--channel.remaining > 0) {
+        return;
+    }
+    // The block is complete.
+    if ((descriptor.BTCTRL.reg & DMAC_BTCTRL_BLOCKACT_Msk) == DMAC_BTCTRL_BLOCKACT_INT) {
+        channel.intFlags |= DMAC_CHINTFLAG_TCMPL;
+    }
+    const auto next = reinterpret_cast<const DmacDescriptor*>(descriptor.DESCADDR.reg);
+    if (next == nullptr) {
+        channel.isEnabled = false;
+    } else if (!loadDescriptor(channel, next)) {
+        channel.isEnabled = false;
+        channel.intFlags |= DMAC_CHINTFLAG_TERR;
+    }
+}
+
+
+uint8_t DmaControllerModel::readByte(uintptr_t address)
+{
+    for (uint8_t i = 0; i < cSercomCount; ++i) {
+        auto &sercom = getI2cMaster(i);
+        if (sercom.isDataRegister(address)) {
+            return sercom.readData();
+        }
+    }
+    return *reinterpret_cast<const volatile uint8_t*>(address);
+}
+
+
+void DmaControllerModel::writeByte(uintptr_t address, uint8_t data)
+{
+    for (uint8_t i = 0; i < cSercomCount; ++i) {
+        auto &sercom = getI2cMaster(i);
+        if (sercom.isDataRegister(address)) {
+            sercom.writeData(data);
+            return;
+        }
+    }
+    *reinterpret_cast<volatile uint8_t*>(address) = data;
+}
+
+
+uint8_t DmaControllerModel::getPendingChannel() const
+{
+    for (uint8_t i = 0; i < cChannelCount; ++i) {
+        if ((_channels[i].intFlags & _channels[i].intEnable) != 0) {
+            return i;
+        }
+    }
+    return cChannelCount;
+}
+
+
+}
+
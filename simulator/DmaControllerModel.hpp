@@ -0,0 +1,148 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "Simulator.hpp"
+#include "Register.hpp"
+
+#include "hal-core/Chip.hpp"
+
+
+namespace lr::sim {
+
+
+/// The model of the DMA controller.
+///
+/// Channels are selected with `CHID`. An enabled channel loads its first descriptor from
+/// the table in `BASEADDR` and moves one byte for each trigger of a SERCOM interface, after
+/// a short latency. Descriptors are chained with `DESCADDR`, a block with the interrupt
+/// block action sets `TCMPL`. An invalid descriptor sets `TERR`.
+///
+/// The data registers of the SERCOM interfaces are accessed with their side effects, all
+/// other addresses are memory of the host. Priorities, the write-back table, software
+/// triggers and the CRC unit are not simulated.
+///
+class DmaControllerModel : public Peripheral
+{
+public:
+    /// The number of channels.
+    ///
+    static constexpr uint8_t cChannelCount = 12;
+
+    /// The cycles from a trigger to the transfer of the byte.
+    ///
+    static constexpr Cycles cTriggerLatency = 8;
+
+public:
+    /// Create the model.
+    ///
+    /// @param registers The registers of the controller.
+    ///
+    explicit DmaControllerModel(Dmac &registers) noexcept;
+
+public:
+    /// Check if the interrupt line is active.
+    ///
+    bool isInterruptActive() const;
+
+    /// Get the number of bytes moved since the start.
+    ///
+    inline uint32_t getBeatCount() const noexcept { return _beatCount; }
+
+    /// Check the trigger sources and schedule the transfers.
+    ///
+    void updateTriggers(Cycles now);
+
+    /// Get the time of the next event.
+    ///
+    Cycles getNextEvent() const;
+
+    /// Process the events up to the current time.
+    ///
+    void processEvents(Cycles now);
+
+public: // Peripheral
+    uint32_t readRegister(uint8_t index, uint32_t stored) override;
+    void writeRegister(uint8_t index, uint32_t &stored, uint32_t value) override;
+
+private:
+    /// The registers.
+    ///
+    enum Index : uint8_t {
+        CTRL, CHID, CHCTRLA, CHCTRLB, CHINTENCLR, CHINTENSET, CHINTFLAG, INTPEND, INTSTATUS
+    };
+
+    /// The state of a channel.
+    ///
+    struct Channel {
+        bool isEnabled; ///< If the channel is enabled.
+        uint32_t control; ///< The value of `CHCTRLB`.
+        uint8_t intEnable; ///< The enabled interrupts.
+        uint8_t intFlags; ///< The interrupt flags.
+        DmacDescriptor descriptor; ///< The active descriptor.
+        uint16_t remaining; ///< The remaining bytes of the active descriptor.
+        Cycles beatTime; ///< The time of the next transfer or `cNoEvent`.
+    };
+
+private:
+    /// Reset a channel.
+    ///
+    void resetChannel(Channel &channel);
+
+    /// Enable a channel and load its first descriptor.
+    ///
+    void enableChannel(uint8_t channelIndex);
+
+    /// Load a descriptor into a channel.
+    ///
+    /// @return `true` if the descriptor is valid.
+    ///
+    bool loadDescriptor(Channel &channel, const DmacDescriptor *descriptor);
+
+    /// Check if the trigger of a channel is active.
+    ///
+    bool isTriggerActive(const Channel &channel) const;
+
+    /// Move one byte for a channel.
+    ///
+    void transferBeat(Channel &channel);
+
+    /// Read a byte from an address.
+    ///
+    uint8_t readByte(uintptr_t address);
+
+    /// Write a byte to an address.
+    ///
+    void writeByte(uintptr_t address, uint8_t data);
+
+    /// Get the channel with a pending interrupt.
+    ///
+    /// @return The channel index or `cChannelCount` if there is no pending interrupt.
+    ///
+    uint8_t getPendingChannel() const;
+
+private:
+    Dmac &_registers; ///< The registers.
+    Channel _channels[cChannelCount]; ///< The channels.
+    uint32_t _beatCount; ///< The number of moved bytes.
+};
+
+
+}
+
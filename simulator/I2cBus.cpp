@@ -0,0 +1,171 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "I2cBus.hpp"
+
+
+#include <algorithm>
+
+
+namespace lr::sim {
+
+
+void I2cBus::attach(I2cDevice &device)
+{
+    _devices.push_back(&device);
+}
+
+
+void I2cBus::detach(I2cDevice &device)
+{
+    if (_selected == &device) {
+        _selected = nullptr;
+    }
+    _devices.erase(std::remove(_devices.begin(), _devices.end(), &device), _devices.end());
+}
+
+
+void I2cBus::resetCounters()
+{
+    _counters = {};
+    if (_isBusy) {
+        _busyStart = getCycles();
+    }
+}
+
+
+bool I2cBus::start(uint8_t addressData, bool highSpeed, bool repeated, Cycles startTime)
+{
+    if (repeated && _isBusy) {
+        ++_counters.repeatedStarts;
+    } else {
+        ++_counters.starts;
+        _isBusy = true;
+        _busyStart = startTime;
+    }
+    _selected = nullptr;
+    const auto address = static_cast<uint8_t>(addressData >> 1u);
+    const bool read = (addressData & 0x01u) != 0;
+    for (auto device : _devices) {
+        if (device->getAddress() != address) {
+            continue;
+        }
+        // A device without high-speed support does not see the address.
+        if (highSpeed && !device->supportsHighSpeed()) {
+            continue;
+        }
+        if (device->onStart(read)) {
+            _selected = device;
+            break;
+        }
+    }
+    if (_selected == nullptr) {
+        ++_counters.addressNacks;
+        return false;
+    }
+    return true;
+}
+
+
+bool I2cBus::write(uint8_t data)
+{
+    ++_counters.bytesWritten;
+    if (_selected == nullptr || !_selected->onWrite(data)) {
+        ++_counters.dataNacks;
+        return false;
+    }
+    return true;
+}
+
+
+uint8_t I2cBus::read()
+{
+    ++_counters.bytesRead;
+    if (_selected == nullptr) {
+        return 0xffu; // The line is pulled up.
+    }
+    return _selected->onRead();
+}
+
+
+void I2cBus::stop()
+{
+    ++_counters.stops;
+    if (_selected != nullptr) {
+        _selected->onStop();
+        _selected = nullptr;
+    }
+    endBusy();
+}
+
+
+void I2cBus::release()
+{
+    _selected = nullptr;
+    endBusy();
+}
+
+
+Cycles I2cBus::getStretchCycles() const
+{
+    return (_selected != nullptr) ? _selected->getStretchCycles() : 0;
+}
+
+
+bool I2cBus::isDataHeld() const
+{
+    return std::any_of(_devices.begin(), _devices.end(), [](const I2cDevice *device) {
+        return device->isHoldingData();
+    });
+}
+
+
+void I2cBus::setGpioLevels(bool sdaLow, bool sclLow)
+{
+    const bool sclRises = _gpioSclLow && !sclLow;
+    const bool sdaRises = _gpioSdaLow && !sdaLow;
+    _gpioSdaLow = sdaLow;
+    _gpioSclLow = sclLow;
+    if (sclRises) {
+        ++_counters.clockPulses;
+        for (auto device : _devices) {
+            device->onClockPulse();
+        }
+    }
+    // SDA going high while SCL is high is a stop condition.
+    if (sdaRises && !sclLow && !isDataHeld()) {
+        ++_counters.stops;
+        for (auto device : _devices) {
+            device->onStop();
+        }
+        _selected = nullptr;
+        endBusy();
+    }
+}
+
+
+void I2cBus::endBusy()
+{
+    if (_isBusy) {
+        _counters.busyCycles += getCycles() - _busyStart;
+        _isBusy = false;
+    }
+}
+
+
+}
+
@@ -0,0 +1,227 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "Simulator.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+namespace lr::sim {
+
+
+/// A virtual device on a simulated I2C bus.
+///
+/// The bus calls the methods of the device at the end of each phase of a transaction.
+///
+class I2cDevice
+{
+public:
+    /// Create a new device.
+    ///
+    /// @param address The 7bit address of the device.
+    ///
+    explicit I2cDevice(uint8_t address) noexcept : _address(address) {}
+
+    virtual ~I2cDevice() = default;
+
+public:
+    /// The 7bit address of the device.
+    ///
+    inline uint8_t getAddress() const noexcept { return _address; }
+
+    /// A start or repeated start with the address of this device.
+    ///
+    /// @param read If the master reads from the device.
+    /// @return `true` to acknowledge the address.
+    ///
+    virtual bool onStart(bool /*read*/) { return true; }
+
+    /// A byte written by the master.
+    ///
+    /// @param data The byte.
+    /// @return `true` to acknowledge the byte.
+    ///
+    virtual bool onWrite(uint8_t /*data*/) { return true; }
+
+    /// A byte read by the master.
+    ///
+    /// @return The byte to send.
+    ///
+    virtual uint8_t onRead() { return 0xffu; }
+
+    /// A stop condition, after the device was addressed.
+    ///
+    virtual void onStop() {}
+
+    /// The number of cycles this device stretches the clock for each byte.
+    ///
+    virtual Cycles getStretchCycles() const { return 0; }
+
+    /// Check if the device accepts transfers in high-speed mode.
+    ///
+    virtual bool supportsHighSpeed() const { return false; }
+
+    /// Check if the device holds SDA low.
+    ///
+    virtual bool isHoldingData() const { return false; }
+
+    /// A clock pulse on SCL, while the pins are used as GPIO for a bus recovery.
+    ///
+    virtual void onClockPulse() {}
+
+private:
+    uint8_t _address; ///< The 7bit address.
+};
+
+
+/// A simulated I2C bus, connecting a master with virtual devices.
+///
+/// The bus only forwards the phases of the transactions and counts them, the timing is
+/// part of the master model.
+///
+class I2cBus
+{
+public:
+    /// The counters of the bus.
+    ///
+    struct Counters {
+        uint32_t starts; ///< The number of start conditions, without repeated starts.
+        uint32_t repeatedStarts; ///< The number of repeated start conditions.
+        uint32_t stops; ///< The number of stop conditions.
+        uint32_t addressNacks; ///< The number of addresses without acknowledge.
+        uint32_t dataNacks; ///< The number of written bytes without acknowledge.
+        uint32_t bytesWritten; ///< The number of data bytes written by the master.
+        uint32_t bytesRead; ///< The number of data bytes read by the master.
+        uint32_t clockPulses; ///< The SCL pulses of a bus recovery.
+        uint64_t sclPeriods; ///< The SCL periods on the bus, including start and stop conditions.
+        Cycles busyCycles; ///< The CPU cycles between the start and stop conditions.
+    };
+
+public:
+    /// Create a new bus without devices.
+    ///
+    I2cBus() = default;
+
+    // No copies.
+    I2cBus(const I2cBus&) = delete;
+    I2cBus& operator=(const I2cBus&) = delete;
+
+public:
+    /// Attach a device to the bus.
+    ///
+    void attach(I2cDevice &device);
+
+    /// Detach a device from the bus.
+    ///
+    void detach(I2cDevice &device);
+
+    /// Set the rise time of the bus.
+    ///
+    /// @param cycles The rise time in CPU cycles.
+    ///
+    inline void setRiseCycles(Cycles cycles) noexcept { _riseCycles = cycles; }
+
+    /// Get the rise time of the bus.
+    ///
+    inline Cycles getRiseCycles() const noexcept { return _riseCycles; }
+
+    /// Access the counters.
+    ///
+    inline const Counters& getCounters() const noexcept { return _counters; }
+
+    /// Check if the bus is between a start and a stop condition.
+    ///
+    inline bool isBusy() const noexcept { return _isBusy; }
+
+    /// Reset all counters to zero.
+    ///
+    void resetCounters();
+
+public: // Master side.
+    /// Send a start condition and an address.
+    ///
+    /// @param addressData The address with the read bit.
+    /// @param highSpeed If the address is sent in high-speed mode.
+    /// @param repeated If this is a repeated start.
+    /// @param startTime The time of the start condition, before the address was sent.
+    /// @return `true` if a device acknowledged the address.
+    ///
+    bool start(uint8_t addressData, bool highSpeed, bool repeated, Cycles startTime);
+
+    /// Write a byte to the addressed device.
+    ///
+    /// @return `true` if the device acknowledged the byte.
+    ///
+    bool write(uint8_t data);
+
+    /// Read a byte from the addressed device.
+    ///
+    uint8_t read();
+
+    /// Send a stop condition.
+    ///
+    void stop();
+
+    /// Release the bus without a stop condition, e.g. after a reset of the master.
+    ///
+    void release();
+
+    /// Count SCL periods.
+    ///
+    inline void addSclPeriods(uint32_t periods) noexcept { _counters.sclPeriods += periods; }
+
+    /// Get the clock stretching of the addressed device.
+    ///
+    Cycles getStretchCycles() const;
+
+    /// Check if a device holds SDA low.
+    ///
+    bool isDataHeld() const;
+
+public: // GPIO side.
+    /// Update the levels the GPIO pins drive on the bus.
+    ///
+    /// Detects clock pulses and stop conditions of a bus recovery.
+    ///
+    /// @param sdaLow If the SDA pin drives the line low.
+    /// @param sclLow If the SCL pin drives the line low.
+    ///
+    void setGpioLevels(bool sdaLow, bool sclLow);
+
+private:
+    /// End the busy period of the bus.
+    ///
+    void endBusy();
+
+private:
+    std::vector<I2cDevice*> _devices; ///< The attached devices.
+    I2cDevice *_selected = nullptr; ///< The addressed device or `nullptr`.
+    Cycles _riseCycles = 4; ///< The rise time, 90ns at 48MHz.
+    Counters _counters = {}; ///< The counters.
+    bool _isBusy = false; ///< If the bus is between start and stop.
+    Cycles _busyStart = 0; ///< The time of the start condition.
+    bool _gpioSdaLow = false; ///< If the SDA pin drives the line low.
+    bool _gpioSclLow = false; ///< If the SCL pin drives the line low.
+};
+
+
+}
+
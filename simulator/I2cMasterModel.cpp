@@ -0,0 +1,557 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "I2cMasterModel.hpp"
+
+
+#include "I2cBus.hpp"
+
+
+namespace lr::sim {
+
+
+namespace {
+
+
+/// The cycles for the synchronization of a reset or enable.
+///
+constexpr Cycles cEnableSyncCycles = 12;
+
+/// The cycles for the synchronization of a system operation.
+///
+constexpr Cycles cSystemOperationSyncCycles = 6;
+
+/// The status bits which are cleared by writing a one.
+///
+constexpr uint16_t cStatusClearMask = SERCOM_I2CM_STATUS_BUSERR|SERCOM_I2CM_STATUS_ARBLOST|
+    SERCOM_I2CM_STATUS_LOWTOUT|SERCOM_I2CM_STATUS_MEXTTOUT|SERCOM_I2CM_STATUS_SEXTTOUT|SERCOM_I2CM_STATUS_LENERR;
+
+/// The stored bits of `CTRLB`, the command is executed and not stored.
+///
+constexpr uint32_t cCtrlbStoredMask = SERCOM_I2CM_CTRLB_SMEN|SERCOM_I2CM_CTRLB_QCEN|SERCOM_I2CM_CTRLB_ACKACT;
+
+/// The command for a read of `DATA` in smart mode.
+///
+constexpr uint8_t cSmartModeRead = 0;
+
+/// The command for a repeated start.
+///
+constexpr uint8_t cCommandRepeatedStart = 1;
+
+/// The command for a byte read.
+///
+constexpr uint8_t cCommandByteRead = 2;
+
+/// The command for a stop condition.
+///
+constexpr uint8_t cCommandStop = 3;
+
+
+}
+
+
+I2cMasterModel::I2cMasterModel(SercomI2cm &registers) noexcept
+    : _registers(registers), _bus(nullptr)
+{
+    _registers.CTRLA.cell.connect(this, CTRLA);
+    _registers.CTRLB.cell.connect(this, CTRLB);
+    _registers.BAUD.cell.connect(this, BAUD);
+    _registers.INTENCLR.cell.connect(this, INTENCLR);
+    _registers.INTENSET.cell.connect(this, INTENSET);
+    _registers.INTFLAG.cell.connect(this, INTFLAG);
+    _registers.STATUS.cell.connect(this, STATUS);
+    _registers.SYNCBUSY.cell.connect(this, SYNCBUSY);
+    _registers.ADDR.cell.connect(this, ADDR);
+    _registers.DATA.cell.connect(this, DATA);
+    _registers.DBGCTRL.cell.connect(this, DBGCTRL);
+    _busState = BusState::Unknown;
+    _operation = Operation::None;
+    softwareReset();
+}
+
+
+void I2cMasterModel::attachBus(I2cBus *bus)
+{
+    if (_bus != nullptr && _busState == BusState::Owner) {
+        _bus->release();
+    }
+    _bus = bus;
+}
+
+
+bool I2cMasterModel::isInterruptActive() const
+{
+    return (_intFlags & _intEnable) != 0;
+}
+
+
+bool I2cMasterModel::isRxTriggerActive() const
+{
+    return (_intFlags & SERCOM_I2CM_INTFLAG_SB) != 0;
+}
+
+
+bool I2cMasterModel::isTxTriggerActive() const
+{
+    return (_intFlags & SERCOM_I2CM_INTFLAG_MB) != 0 && _busState == BusState::Owner && !_isRead &&
+        _operation == Operation::None && (_status & SERCOM_I2CM_STATUS_RXNACK) == 0;
+}
+
+
+bool I2cMasterModel::isDataRegister(uintptr_t address) const
+{
+    return address == reinterpret_cast<uintptr_t>(&_registers.DATA.reg);
+}
+
+
+uint8_t I2cMasterModel::readData()
+{
+    const auto value = _data;
+    const bool smartMode = (_registers.CTRLB.cell.stored() & SERCOM_I2CM_CTRLB_SMEN) != 0;
+    if (isEnabled() && smartMode && (_intFlags & SERCOM_I2CM_INTFLAG_SB) != 0) {
+        _intFlags &= ~SERCOM_I2CM_INTFLAG_SB;
+        executeCommand(cSmartModeRead);
+    }
+    return value;
+}
+
+
+void I2cMasterModel::writeData(uint8_t data)
+{
+    if (!isEnabled() || _busState != BusState::Owner || _isRead || _operation != Operation::None) {
+        return;
+    }
+    _intFlags &= ~(SERCOM_I2CM_INTFLAG_MB|SERCOM_I2CM_INTFLAG_SB);
+    _pendingData = data;
+    startOperation(Operation::WriteByte, 9 * getSclPeriod(_isHighSpeed) + (_bus != nullptr ? _bus->getStretchCycles() : 0));
+    if (_bus != nullptr) {
+        _bus->addSclPeriods(9);
+    }
+}
+
+
+Cycles I2cMasterModel::getNextEvent() const
+{
+    return (_operation != Operation::None) ? _operationEnd : cNoEvent;
+}
+
+
+void I2cMasterModel::processEvents(Cycles now)
+{
+    while (_operation != Operation::None && _operationEnd <= now) {
+        finishOperation();
+    }
+}
+
+
+uint32_t I2cMasterModel::readRegister(uint8_t index, uint32_t stored)
+{
+    const auto now = getCycles();
+    uint32_t value;
+    switch (index) {
+    case CTRLA:
+        value = stored & ~SERCOM_I2CM_CTRLA_SWRST;
+        if (now < _syncEnd[SyncReset]) {
+            value |= SERCOM_I2CM_CTRLA_SWRST;
+        }
+        break;
+    case INTENCLR:
+    case INTENSET:
+        value = _intEnable;
+        break;
+    case INTFLAG:
+        value = _intFlags;
+        break;
+    case STATUS:
+        value = _status | SERCOM_I2CM_STATUS_BUSSTATE(static_cast<uint8_t>(getBusState()));
+        if (_busState == BusState::Owner && _operation == Operation::None &&
+            (_intFlags & (SERCOM_I2CM_INTFLAG_MB|SERCOM_I2CM_INTFLAG_SB)) != 0) {
+            value |= SERCOM_I2CM_STATUS_CLKHOLD;
+        }
+        break;
+    case SYNCBUSY:
+        value = 0;
+        for (uint8_t i = 0; i < 3; ++i) {
+            if (now < _syncEnd[i]) {
+                value |= (1u << i);
+            }
+        }
+        break;
+    case DATA:
+        value = readData();
+        break;
+    default:
+        value = stored;
+        break;
+    }
+    accessRegister();
+    return value;
+}
+
+
+void I2cMasterModel::writeRegister(uint8_t index, uint32_t &stored, uint32_t value)
+{
+    switch (index) {
+    case CTRLA:
+        if ((value & SERCOM_I2CM_CTRLA_SWRST) != 0) {
+            softwareReset();
+            startSync(SyncReset, cEnableSyncCycles);
+        } else {
+            const bool wasEnabled = isEnabled();
+            stored = value;
+            if (isEnabled() != wasEnabled) {
+                startSync(SyncEnable, cEnableSyncCycles);
+                if (_busState == BusState::Owner && _bus != nullptr) {
+                    _bus->release();
+                }
+                _operation = Operation::None;
+                _busState = BusState::Unknown;
+            }
+        }
+        break;
+    case CTRLB:
+        stored = value & cCtrlbStoredMask;
+        startSync(SyncSystemOperation, cSystemOperationSyncCycles);
+        if (isEnabled() && ((value >> 16u) & 0x3u) != 0) {
+            executeCommand(static_cast<uint8_t>((value >> 16u) & 0x3u));
+        }
+        break;
+    case INTENCLR:
+        _intEnable &= static_cast<uint8_t>(~value);
+        break;
+    case INTENSET:
+        _intEnable |= static_cast<uint8_t>(value);
+        break;
+    case INTFLAG:
+        _intFlags &= static_cast<uint8_t>(~value);
+        break;
+    case STATUS:
+        _status &= static_cast<uint16_t>(~(value & cStatusClearMask));
+        if (isEnabled() && ((value >> SERCOM_I2CM_STATUS_BUSSTATE_Pos) & 0x3u) == static_cast<uint8_t>(BusState::Idle)) {
+            startSync(SyncSystemOperation, cSystemOperationSyncCycles);
+            if (_busState == BusState::Owner && _bus != nullptr) {
+                _bus->release();
+            }
+            _operation = Operation::None;
+            _busState = BusState::Idle;
+        }
+        break;
+    case SYNCBUSY:
+        break; // Read-only.
+    case ADDR:
+        stored = value;
+        if (isEnabled()) {
+            startSync(SyncSystemOperation, cSystemOperationSyncCycles);
+            _intFlags &= ~(SERCOM_I2CM_INTFLAG_MB|SERCOM_I2CM_INTFLAG_SB);
+            _status &= ~SERCOM_I2CM_STATUS_LENERR;
+            _lengthCount = 0;
+            startAddress(_busState == BusState::Owner);
+        }
+        break;
+    case DATA:
+        stored = value;
+        startSync(SyncSystemOperation, cSystemOperationSyncCycles);
+        writeData(static_cast<uint8_t>(value));
+        break;
+    default:
+        stored = value;
+        break;
+    }
+    accessRegister();
+}
+
+
+void I2cMasterModel::softwareReset()
+{
+    if (_busState == BusState::Owner && _bus != nullptr) {
+        _bus->release();
+    }
+    _registers.CTRLA.cell.stored() = 0;
+    _registers.CTRLB.cell.stored() = 0;
+    _registers.BAUD.cell.stored() = 0;
+    _registers.ADDR.cell.stored() = 0;
+    _registers.DATA.cell.stored() = 0;
+    _registers.DBGCTRL.cell.stored() = 0;
+    for (auto &syncEnd : _syncEnd) {
+        syncEnd = 0;
+    }
+    _intEnable = 0;
+    _intFlags = 0;
+    _status = 0;
+    _busState = BusState::Unknown;
+    _data = 0;
+    _operation = Operation::None;
+    _operationStart = 0;
+    _operationEnd = 0;
+    _isRead = false;
+    _isHighSpeed = false;
+    _isRepeatedStart = false;
+    _ackPending = false;
+    _autoStop = false;
+    _lengthCount = 0;
+    _pendingData = 0;
+}
+
+
+void I2cMasterModel::startSync(Sync sync, Cycles cycles)
+{
+    _syncEnd[sync] = getCycles() + cycles;
+}
+
+
+bool I2cMasterModel::isEnabled() const
+{
+    return (_registers.CTRLA.cell.stored() & SERCOM_I2CM_CTRLA_ENABLE) != 0;
+}
+
+
+I2cMasterModel::BusState I2cMasterModel::getBusState() const
+{
+    if (!isEnabled()) {
+        return BusState::Unknown;
+    }
+    if (_busState == BusState::Owner) {
+        return BusState::Owner;
+    }
+    // Another participant holds the bus.
+    if (_bus != nullptr && _bus->isDataHeld()) {
+        return BusState::Busy;
+    }
+    return _busState;
+}
+
+
+Cycles I2cMasterModel::getSclPeriod(bool highSpeed) const
+{
+    const auto baud = _registers.BAUD.cell.stored();
+    if (highSpeed) {
+        const auto high = (baud >> 16u) & 0xffu;
+        auto low = (baud >> 24u) & 0xffu;
+        if (low == 0) {
+            low = high;
+        }
+        return 2u + high + low;
+    }
+    const auto high = baud & 0xffu;
+    auto low = (baud >> 8u) & 0xffu;
+    if (low == 0) {
+        low = high;
+    }
+    return 10u + high + low + (_bus != nullptr ? _bus->getRiseCycles() : 0);
+}
+
+
+void I2cMasterModel::startOperation(Operation operation, Cycles cycles)
+{
+    _operation = operation;
+    _operationStart = getCycles();
+    _operationEnd = _operationStart + cycles;
+}
+
+
+void I2cMasterModel::startAddress(bool repeated)
+{
+    const auto busState = getBusState();
+    if (busState == BusState::Unknown) {
+        // The interface waits for an idle bus, which never comes without a time-out.
+        return;
+    }
+    if (busState == BusState::Busy) {
+        // The start condition fails on a bus held by another participant.
+        _status |= SERCOM_I2CM_STATUS_ARBLOST;
+        _intFlags |= SERCOM_I2CM_INTFLAG_MB;
+        return;
+    }
+    const auto address = _registers.ADDR.cell.stored();
+    _isRead = (address & 0x01u) != 0;
+    _isRepeatedStart = repeated;
+    _ackPending = false;
+    _autoStop = false;
+    _busState = BusState::Owner;
+    Cycles cycles = 0;
+    uint32_t periods = 0;
+    const bool highSpeed = (address & SERCOM_I2CM_ADDR_HS) != 0;
+    if (highSpeed && !_isHighSpeed) {
+        // The master code is sent in fast mode, followed by a repeated start.
+        cycles += 10 * getSclPeriod(false);
+        periods += 10;
+        _isHighSpeed = true;
+    }
+    cycles += 10 * getSclPeriod(_isHighSpeed);
+    periods += 10;
+    if (_bus != nullptr) {
+        _bus->addSclPeriods(periods);
+    }
+    startOperation(Operation::Address, cycles);
+}
+
+
+void I2cMasterModel::executeCommand(uint8_t command)
+{
+    if (_busState != BusState::Owner) {
+        return;
+    }
+    if (_operation != Operation::None) {
+        // A stop is sent after the current phase, all other commands are ignored.
+        if (command == cCommandStop) {
+            _autoStop = true;
+        }
+        return;
+    }
+    _intFlags &= ~(SERCOM_I2CM_INTFLAG_MB|SERCOM_I2CM_INTFLAG_SB);
+    const bool nack = (_registers.CTRLB.cell.stored() & SERCOM_I2CM_CTRLB_ACKACT) != 0;
+    const uint32_t ackPeriods = _ackPending ? 1 : 0;
+    const Cycles period = getSclPeriod(_isHighSpeed);
+    switch (command) {
+    case cSmartModeRead:
+    case cCommandByteRead:
+        if (!_isRead || (command == cSmartModeRead && !_ackPending)) {
+            return;
+        }
+        _ackPending = false;
+        if (nack) {
+            startOperation(Operation::Nack, period);
+            if (_bus != nullptr) {
+                _bus->addSclPeriods(1);
+            }
+        } else {
+            startOperation(Operation::ReadByte, (8 + ackPeriods) * period +
+                (_bus != nullptr ? _bus->getStretchCycles() : 0));
+            if (_bus != nullptr) {
+                _bus->addSclPeriods(8 + ackPeriods);
+            }
+        }
+        break;
+    case cCommandRepeatedStart:
+        _ackPending = false;
+        // The interface sends the acknowledge action and repeats the address in `ADDR`.
+        startAddress(true);
+        if (_operation == Operation::Address) {
+            _operationEnd += ackPeriods * period;
+        }
+        break;
+    case cCommandStop:
+        _ackPending = false;
+        startOperation(Operation::Stop, (1 + ackPeriods) * period);
+        if (_bus != nullptr) {
+            _bus->addSclPeriods(1 + ackPeriods);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+
+void I2cMasterModel::finishOperation()
+{
+    const auto operation = _operation;
+    _operation = Operation::None;
+    const bool lengthEnabled = (_registers.ADDR.cell.stored() & SERCOM_I2CM_ADDR_LENEN) != 0;
+    switch (operation) {
+    case Operation::Address: {
+        const auto addressData = static_cast<uint8_t>(_registers.ADDR.cell.stored() & 0xffu);
+        const bool ack = (_bus != nullptr) && _bus->start(addressData, _isHighSpeed, _isRepeatedStart, _operationStart);
+        if (!ack) {
+            _status |= SERCOM_I2CM_STATUS_RXNACK;
+            if (lengthEnabled && !_isRead) {
+                // The length counter ends the transfer with a stop condition.
+                _status |= SERCOM_I2CM_STATUS_LENERR;
+                _intFlags |= SERCOM_I2CM_INTFLAG_ERROR;
+                executeCommand(cCommandStop);
+            } else {
+                _intFlags |= SERCOM_I2CM_INTFLAG_MB;
+            }
+        } else {
+            _status &= ~SERCOM_I2CM_STATUS_RXNACK;
+            if (_isRead) {
+                // Receive the first byte.
+                startOperation(Operation::ReadByte, 8 * getSclPeriod(_isHighSpeed) +
+                    (_bus != nullptr ? _bus->getStretchCycles() : 0));
+                if (_bus != nullptr) {
+                    _bus->addSclPeriods(8);
+                }
+            } else {
+                _intFlags |= SERCOM_I2CM_INTFLAG_MB;
+            }
+        }
+        break;
+    }
+    case Operation::WriteByte: {
+        const bool ack = (_bus != nullptr) && _bus->write(_pendingData);
+        const bool isLast = lengthEnabled && countLength();
+        if (!ack) {
+            _status |= SERCOM_I2CM_STATUS_RXNACK;
+            if (lengthEnabled) {
+                _status |= SERCOM_I2CM_STATUS_LENERR;
+                _intFlags |= SERCOM_I2CM_INTFLAG_ERROR;
+                executeCommand(cCommandStop);
+            } else {
+                _intFlags |= SERCOM_I2CM_INTFLAG_MB;
+            }
+        } else {
+            _status &= ~SERCOM_I2CM_STATUS_RXNACK;
+            _intFlags |= SERCOM_I2CM_INTFLAG_MB;
+            if (isLast) {
+                _autoStop = true;
+            }
+        }
+        break;
+    }
+    case Operation::ReadByte: {
+        _data = (_bus != nullptr) ? _bus->read() : 0xffu;
+        _ackPending = true;
+        _intFlags |= SERCOM_I2CM_INTFLAG_SB;
+        if (lengthEnabled && countLength()) {
+            // Send a NACK and the stop condition, the byte stays in the data register.
+            _autoStop = true;
+        }
+        break;
+    }
+    case Operation::Nack:
+        break; // The interface holds the bus until the next command.
+    case Operation::Stop:
+        if (_bus != nullptr) {
+            _bus->stop();
+        }
+        _busState = BusState::Idle;
+        _isRead = false;
+        _isHighSpeed = false;
+        break;
+    default:
+        break;
+    }
+    if (_autoStop && _operation == Operation::None && _busState == BusState::Owner) {
+        // The flags stay set, while the interface sends the stop condition.
+        const auto flags = _intFlags;
+        _autoStop = false;
+        executeCommand(cCommandStop);
+        _intFlags = flags;
+    }
+}
+
+
+bool I2cMasterModel::countLength()
+{
+    const auto length = static_cast<uint8_t>((_registers.ADDR.cell.stored() >> 16u) & 0xffu);
+    ++_lengthCount;
+    return _lengthCount >= length;
+}
+
+
+}
+
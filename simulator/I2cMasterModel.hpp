@@ -0,0 +1,211 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "Simulator.hpp"
+#include "Register.hpp"
+
+#include "hal-core/Chip.hpp"
+
+
+namespace lr::sim {
+
+
+class I2cBus;
+
+
+/// The model of a SERCOM interface in I2C master mode.
+///
+/// The model implements the behaviour of the registers, which the driver relies on:
+///
+/// - Software reset, enable and the synchronization busy flags.
+/// - The bus state, forced to idle by writing `STATUS.BUSSTATE`.
+/// - Writing `ADDR` sends a (repeated) start and the address. For a read, the first byte
+///   is received after the acknowledge.
+/// - Writing `DATA` sends a byte. In smart mode, reading `DATA` while `SB` is set executes
+///   the acknowledge action and receives the next byte.
+/// - The commands in `CTRLB.CMD`, with the acknowledge action of `CTRLB.ACKACT`.
+/// - High-speed mode with the master code, sent in fast mode.
+/// - The length counter of `ADDR.LENEN`, with automatic stop and `STATUS.LENERR`.
+/// - The DMA triggers and the interrupt line.
+///
+/// Every phase takes the SCL periods calculated from the `BAUD` register and the rise time
+/// of the bus, plus the clock stretching of the addressed device. Timeouts, the inactive bus
+/// time-out, 10bit addresses and slave mode are not simulated.
+///
+class I2cMasterModel : public Peripheral
+{
+public:
+    /// Create the model for a SERCOM interface.
+    ///
+    /// @param registers The registers of the interface.
+    ///
+    explicit I2cMasterModel(SercomI2cm &registers) noexcept;
+
+public:
+    /// Connect the interface with a bus.
+    ///
+    /// @param bus The bus, or `nullptr` for an open bus without devices.
+    ///
+    void attachBus(I2cBus *bus);
+
+    /// Get the connected bus.
+    ///
+    inline I2cBus* getBus() const noexcept { return _bus; }
+
+    /// Check if the interrupt line is active.
+    ///
+    bool isInterruptActive() const;
+
+    /// Check if the receive trigger for the DMA controller is active.
+    ///
+    bool isRxTriggerActive() const;
+
+    /// Check if the transmit trigger for the DMA controller is active.
+    ///
+    bool isTxTriggerActive() const;
+
+    /// Check if an address is the data register of this interface.
+    ///
+    bool isDataRegister(uintptr_t address) const;
+
+    /// Read the data register from the DMA controller.
+    ///
+    uint8_t readData();
+
+    /// Write the data register from the DMA controller.
+    ///
+    void writeData(uint8_t data);
+
+    /// Get the time of the next event.
+    ///
+    Cycles getNextEvent() const;
+
+    /// Process the events up to the current time.
+    ///
+    void processEvents(Cycles now);
+
+public: // Peripheral
+    uint32_t readRegister(uint8_t index, uint32_t stored) override;
+    void writeRegister(uint8_t index, uint32_t &stored, uint32_t value) override;
+
+private:
+    /// The registers.
+    ///
+    enum Index : uint8_t {
+        CTRLA, CTRLB, BAUD, INTENCLR, INTENSET, INTFLAG, STATUS, SYNCBUSY, ADDR, DATA, DBGCTRL
+    };
+
+    /// The bus state as defined in `STATUS.BUSSTATE`.
+    ///
+    enum class BusState : uint8_t {
+        Unknown = 0, Idle = 1, Owner = 2, Busy = 3
+    };
+
+    /// The running operation on the bus.
+    ///
+    enum class Operation : uint8_t {
+        None, ///< No operation.
+        Address, ///< A start condition and the address.
+        WriteByte, ///< Sending a byte.
+        ReadByte, ///< The acknowledge bit of the previous byte and receiving a byte.
+        Nack, ///< The not acknowledge bit for the last byte, holding the bus afterwards.
+        Stop, ///< The acknowledge bit, if pending, and the stop condition.
+    };
+
+    /// The synchronized operations, matching the bits in `SYNCBUSY`.
+    ///
+    enum Sync : uint8_t {
+        SyncReset = 0, SyncEnable = 1, SyncSystemOperation = 2
+    };
+
+private:
+    /// Reset the interface.
+    ///
+    void softwareReset();
+
+    /// Start a synchronization.
+    ///
+    void startSync(Sync sync, Cycles cycles);
+
+    /// Check if the interface is enabled.
+    ///
+    bool isEnabled() const;
+
+    /// Get the current bus state.
+    ///
+    BusState getBusState() const;
+
+    /// Get the SCL period in CPU cycles.
+    ///
+    /// @param highSpeed `true` for the high-speed mode periods.
+    ///
+    Cycles getSclPeriod(bool highSpeed) const;
+
+    /// Start an operation.
+    ///
+    /// @param operation The operation.
+    /// @param cycles The duration.
+    ///
+    void startOperation(Operation operation, Cycles cycles);
+
+    /// Start the address phase.
+    ///
+    void startAddress(bool repeated);
+
+    /// Execute the acknowledge action for the received byte.
+    ///
+    /// @param useCommand The command to execute, or 0 for the read of `DATA` in smart mode.
+    ///
+    void executeCommand(uint8_t command);
+
+    /// Finish the current operation.
+    ///
+    void finishOperation();
+
+    /// Count a received byte and start the automatic stop at the end of the length.
+    ///
+    /// @return `true` if this was the last byte of the length.
+    ///
+    bool countLength();
+
+private:
+    SercomI2cm &_registers; ///< The registers.
+    I2cBus *_bus; ///< The connected bus.
+    Cycles _syncEnd[3]; ///< The end of the synchronizations.
+    uint8_t _intEnable; ///< The enabled interrupts.
+    uint8_t _intFlags; ///< The interrupt flags.
+    uint16_t _status; ///< The status flags, without the bus state.
+    BusState _busState; ///< The bus state, without the busy detection.
+    uint8_t _data; ///< The received byte.
+    Operation _operation; ///< The running operation.
+    Cycles _operationStart; ///< The start of the running operation.
+    Cycles _operationEnd; ///< The end of the running operation.
+    bool _isRead; ///< If the current transfer reads from the device.
+    bool _isHighSpeed; ///< If the current transfer is in high-speed mode.
+    bool _isRepeatedStart; ///< If the address phase starts with a repeated start.
+    bool _ackPending; ///< If the acknowledge bit for the received byte was not sent yet.
+    bool _autoStop; ///< If the length counter requests a stop after the current byte.
+    uint8_t _lengthCount; ///< The length counter.
+    uint8_t _pendingData; ///< The byte to send.
+};
+
+
+}
+
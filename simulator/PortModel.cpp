@@ -0,0 +1,221 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "PortModel.hpp"
+
+
+#include "I2cBus.hpp"
+
+#include <algorithm>
+
+
+namespace lr::sim {
+
+
+PortModel::PortModel(Port &registers) noexcept
+    : _registers(registers)
+{
+    for (uint8_t groupIndex = 0; groupIndex < 2; ++groupIndex) {
+        auto &group = _registers.Group[groupIndex];
+        const auto base = static_cast<uint8_t>(groupIndex * cGroupIndexCount);
+        group.DIR.cell.connect(this, base + DIR);
+        group.DIRCLR.cell.connect(this, base + DIRCLR);
+        group.DIRSET.cell.connect(this, base + DIRSET);
+        group.DIRTGL.cell.connect(this, base + DIRTGL);
+        group.OUT.cell.connect(this, base + OUT);
+        group.OUTCLR.cell.connect(this, base + OUTCLR);
+        group.OUTSET.cell.connect(this, base + OUTSET);
+        group.OUTTGL.cell.connect(this, base + OUTTGL);
+        group.IN.cell.connect(this, base + IN);
+        group.CTRL.cell.connect(this, base + CTRL);
+        group.WRCONFIG.cell.connect(this, base + WRCONFIG);
+        for (uint8_t i = 0; i < 16; ++i) {
+            group.PMUX[i].cell.connect(this, base + PMUX + i);
+        }
+        for (uint8_t i = 0; i < 32; ++i) {
+            group.PINCFG[i].cell.connect(this, base + PINCFG + i);
+        }
+    }
+}
+
+
+void PortModel::connectBus(I2cBus &bus, uint8_t pinSDA, uint8_t pinSCL)
+{
+    disconnectBus(bus);
+    _connections.push_back(Connection{&bus, pinSDA, pinSCL});
+    updateBuses();
+}
+
+
+void PortModel::disconnectBus(I2cBus &bus)
+{
+    _connections.erase(std::remove_if(_connections.begin(), _connections.end(), [&bus](const Connection &connection) {
+        return connection.bus == &bus;
+    }), _connections.end());
+}
+
+
+void PortModel::setInputLevels(uint8_t groupIndex, uint32_t mask, uint32_t levels)
+{
+    auto &inputMask = _inputMask[groupIndex & 0x1u];
+    auto &inputLevels = _inputLevels[groupIndex & 0x1u];
+    inputMask |= mask;
+    inputLevels = (inputLevels & ~mask) | (levels & mask);
+}
+
+
+void PortModel::releaseInputs()
+{
+    for (uint8_t i = 0; i < 2; ++i) {
+        _inputMask[i] = 0;
+        _inputLevels[i] = 0;
+    }
+}
+
+
+void PortModel::startRecording()
+{
+    _accesses.clear();
+    _isRecording = true;
+}
+
+
+void PortModel::stopRecording()
+{
+    _isRecording = false;
+}
+
+
+uint32_t PortModel::readRegister(uint8_t index, uint32_t stored)
+{
+    const auto groupIndex = static_cast<uint8_t>(index / cGroupIndexCount);
+    auto &group = _registers.Group[groupIndex];
+    uint32_t value;
+    switch (index % cGroupIndexCount) {
+    case DIRCLR:
+    case DIRSET:
+    case DIRTGL:
+        value = group.DIR.cell.stored();
+        break;
+    case OUTCLR:
+    case OUTSET:
+    case OUTTGL:
+        value = group.OUT.cell.stored();
+        break;
+    case IN: {
+        const auto direction = group.DIR.cell.stored();
+        value = (direction & group.OUT.cell.stored()) | ~direction;
+        const auto driven = _inputMask[groupIndex] & ~direction;
+        value = (value & ~driven) | (_inputLevels[groupIndex] & driven);
+        for (const auto &connection : _connections) {
+            const bool sdaLow = connection.bus->isDataHeld() || isDrivenLow(connection.pinSDA);
+            const bool sclLow = isDrivenLow(connection.pinSCL);
+            if ((connection.pinSDA >> 5u) == groupIndex && sdaLow) {
+                value &= ~(1u << (connection.pinSDA & 0x1fu));
+            }
+            if ((connection.pinSCL >> 5u) == groupIndex && sclLow) {
+                value &= ~(1u << (connection.pinSCL & 0x1fu));
+            }
+        }
+        break;
+    }
+    case WRCONFIG:
+        value = 0; // Write-only.
+        break;
+    default:
+        value = stored;
+        break;
+    }
+    if (_isRecording) {
+        _accesses.push_back(Access{false, groupIndex, static_cast<uint8_t>(index % cGroupIndexCount), value});
+    }
+    accessRegister();
+    return value;
+}
+
+
+void PortModel::writeRegister(uint8_t index, uint32_t &stored, uint32_t value)
+{
+    const auto groupIndex = static_cast<uint8_t>(index / cGroupIndexCount);
+    auto &group = _registers.Group[groupIndex];
+    if (_isRecording) {
+        _accesses.push_back(Access{true, groupIndex, static_cast<uint8_t>(index % cGroupIndexCount), value});
+    }
+    switch (index % cGroupIndexCount) {
+    case DIRCLR: group.DIR.cell.stored() &= ~value; break;
+    case DIRSET: group.DIR.cell.stored() |= value; break;
+    case DIRTGL: group.DIR.cell.stored() ^= value; break;
+    case OUTCLR: group.OUT.cell.stored() &= ~value; break;
+    case OUTSET: group.OUT.cell.stored() |= value; break;
+    case OUTTGL: group.OUT.cell.stored() ^= value; break;
+    case IN: break; // Read-only.
+    case WRCONFIG: writeConfiguration(group, value); break;
+    default: stored = value; break;
+    }
+    updateBuses();
+    accessRegister();
+}
+
+
+bool PortModel::isDrivenLow(uint8_t pin) const
+{
+    auto &group = _registers.Group[(pin >> 5u) & 0x1u];
+    const auto index = static_cast<uint8_t>(pin & 0x1fu);
+    const auto mask = static_cast<uint32_t>(1) << index;
+    // With the multiplexer enabled, the pin belongs to the peripheral.
+    if ((group.PINCFG[index].cell.stored() & PORT_PINCFG_PMUXEN) != 0) {
+        return false;
+    }
+    return (group.DIR.cell.stored() & mask) != 0 && (group.OUT.cell.stored() & mask) == 0;
+}
+
+
+void PortModel::updateBuses()
+{
+    for (const auto &connection : _connections) {
+        connection.bus->setGpioLevels(isDrivenLow(connection.pinSDA), isDrivenLow(connection.pinSCL));
+    }
+}
+
+
+void PortModel::writeConfiguration(PortGroup &group, uint32_t value)
+{
+    const auto offset = static_cast<uint8_t>(((value & PORT_WRCONFIG_HWSEL) != 0) ? 16 : 0);
+    const auto pinConfiguration = static_cast<uint8_t>((value >> 16u) & 0x47u);
+    const auto function = static_cast<uint8_t>((value >> 24u) & 0x0fu);
+    for (uint8_t i = 0; i < 16; ++i) {
+        if ((value & (1u << i)) == 0) {
+            continue;
+        }
+        const auto pinIndex = static_cast<uint8_t>(offset + i);
+        if ((value & PORT_WRCONFIG_WRPINCFG) != 0) {
+            group.PINCFG[pinIndex].cell.stored() = pinConfiguration;
+        }
+        if ((value & PORT_WRCONFIG_WRPMUX) != 0) {
+            auto &pmux = group.PMUX[pinIndex >> 1u].cell.stored();
+            if ((pinIndex & 1u) == 0) {
+                pmux = (pmux & 0xf0u) | function;
+            } else {
+                pmux = (pmux & 0x0fu) | (static_cast<uint32_t>(function) << 4u);
+            }
+        }
+    }
+}
+
+
+}
+
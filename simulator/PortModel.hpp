@@ -0,0 +1,147 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "Simulator.hpp"
+#include "Register.hpp"
+
+#include "hal-core/Chip.hpp"
+
+#include <vector>
+
+
+namespace lr::sim {
+
+
+class I2cBus;
+
+
+/// The model of the port.
+///
+/// The set, clear and toggle registers modify the direction and output registers,
+/// `WRCONFIG` writes the pin configuration and multiplexing. Inputs without a connection
+/// read as high, unless a test drives their levels. The pins of a connected I2C bus read the level of the bus lines, and
+/// drive them while the pins are used as GPIO, like for a bus recovery.
+///
+class PortModel : public Peripheral
+{
+public:
+    /// The registers of a group, `PMUX` and `PINCFG` follow `WRCONFIG`.
+    ///
+    enum Index : uint8_t {
+        DIR, DIRCLR, DIRSET, DIRTGL, OUT, OUTCLR, OUTSET, OUTTGL, IN, CTRL, WRCONFIG, PMUX, PINCFG = PMUX + 16
+    };
+
+    /// A recorded register access.
+    ///
+    struct Access {
+        bool isWrite; ///< If the register was written.
+        uint8_t group; ///< The port group.
+        uint8_t index; ///< The register, `PMUX` and `PINCFG` plus the register number.
+        uint32_t value; ///< The written or read value.
+    };
+
+public:
+    /// Create the model.
+    ///
+    /// @param registers The registers of the port.
+    ///
+    explicit PortModel(Port &registers) noexcept;
+
+public:
+    /// Connect the pins with the lines of an I2C bus.
+    ///
+    /// @param bus The bus.
+    /// @param pinSDA The pin number for SDA.
+    /// @param pinSCL The pin number for SCL.
+    ///
+    void connectBus(I2cBus &bus, uint8_t pinSDA, uint8_t pinSCL);
+
+    /// Disconnect a bus from the pins.
+    ///
+    void disconnectBus(I2cBus &bus);
+
+    /// Drive the levels of input pins from outside, e.g. for buttons.
+    ///
+    /// Pins configured as outputs keep their output level.
+    ///
+    /// @param groupIndex The port group.
+    /// @param mask The pins to drive, other pins keep their levels.
+    /// @param levels The levels for the pins in the mask.
+    ///
+    void setInputLevels(uint8_t groupIndex, uint32_t mask, uint32_t levels);
+
+    /// Stop driving all input pins from outside.
+    ///
+    void releaseInputs();
+
+    /// Start to record the register accesses, the last recording is cleared.
+    ///
+    void startRecording();
+
+    /// Stop to record the register accesses.
+    ///
+    void stopRecording();
+
+    /// Get the recorded register accesses.
+    ///
+    inline const std::vector<Access>& getAccesses() const noexcept { return _accesses; }
+
+public: // Peripheral
+    uint32_t readRegister(uint8_t index, uint32_t stored) override;
+    void writeRegister(uint8_t index, uint32_t &stored, uint32_t value) override;
+
+private:
+    /// The number of indexes used for one group.
+    ///
+    static constexpr uint8_t cGroupIndexCount = 64;
+
+    /// A connected bus.
+    ///
+    struct Connection {
+        I2cBus *bus; ///< The bus.
+        uint8_t pinSDA; ///< The pin for SDA.
+        uint8_t pinSCL; ///< The pin for SCL.
+    };
+
+private:
+    /// Check if a GPIO pin drives its line low.
+    ///
+    bool isDrivenLow(uint8_t pin) const;
+
+    /// Update the levels on the connected buses.
+    ///
+    void updateBuses();
+
+    /// Write the pin configuration from a `WRCONFIG` value.
+    ///
+    void writeConfiguration(PortGroup &group, uint32_t value);
+
+private:
+    Port &_registers; ///< The registers.
+    std::vector<Connection> _connections; ///< The connected buses.
+    uint32_t _inputMask[2] = {}; ///< The input pins driven from outside.
+    uint32_t _inputLevels[2] = {}; ///< The levels of the driven input pins.
+    bool _isRecording = false; ///< If the accesses are recorded.
+    std::vector<Access> _accesses; ///< The recorded accesses.
+};
+
+
+}
+
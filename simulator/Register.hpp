@@ -0,0 +1,182 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <cstdint>
+
+
+namespace lr::sim {
+
+
+/// The interface of a simulated peripheral.
+///
+/// The peripheral gets every access to its registers, so it can react on writes and
+/// compute the values of status registers.
+///
+class Peripheral
+{
+public:
+    virtual ~Peripheral() = default;
+
+public:
+    /// Read a register.
+    ///
+    /// @param index The index of the register in the peripheral.
+    /// @param stored The last value written to the register.
+    /// @return The value of the register.
+    ///
+    virtual uint32_t readRegister(uint8_t index, uint32_t stored) = 0;
+
+    /// Write a register.
+    ///
+    /// @param index The index of the register in the peripheral.
+    /// @param stored The stored value of the register, which can be modified.
+    /// @param value The written value.
+    ///
+    virtual void writeRegister(uint8_t index, uint32_t &stored, uint32_t value) = 0;
+};
+
+
+/// The storage of a simulated register.
+///
+/// Without a peripheral, the register works like plain memory.
+///
+class RegisterCell
+{
+public:
+    /// Connect the register with a peripheral.
+    ///
+    void connect(Peripheral *peripheral, uint8_t index) noexcept {
+        _peripheral = peripheral;
+        _index = index;
+    }
+
+    /// Read the value.
+    ///
+    uint32_t read() const {
+        return (_peripheral != nullptr) ? _peripheral->readRegister(_index, _stored) : _stored;
+    }
+
+    /// Write the value.
+    ///
+    void write(uint32_t value) {
+        if (_peripheral != nullptr) {
+            _peripheral->writeRegister(_index, _stored, value);
+        } else {
+            _stored = value;
+        }
+    }
+
+    /// Access the stored value, without the peripheral.
+    ///
+    uint32_t& stored() noexcept { return _stored; }
+
+private:
+    Peripheral *_peripheral = nullptr; ///< The peripheral or `nullptr`.
+    uint8_t _index = 0; ///< The index of the register.
+    uint32_t _stored = 0; ///< The stored value.
+};
+
+
+/// The access to the whole register, like the `reg` member of the chip headers.
+///
+/// Copies are not allowed, so `auto value = register.reg;` fails to compile, instead of
+/// keeping a reference to the register. Use the value type explicitly.
+///
+template<typename tValue>
+class RegisterValue
+{
+public:
+    explicit RegisterValue(RegisterCell *cell) noexcept : _cell(cell) {}
+    RegisterValue(const RegisterValue&) = delete;
+    RegisterValue& operator=(const RegisterValue&) = delete;
+
+public:
+    operator tValue() const { return static_cast<tValue>(_cell->read()); }
+    RegisterValue& operator=(tValue value) { _cell->write(value); return *this; }
+    // Like on the chip, the operand is promoted and the result is truncated to the register.
+    RegisterValue& operator|=(uint32_t value) { _cell->write(static_cast<tValue>(_cell->read() | value)); return *this; }
+    RegisterValue& operator&=(uint32_t value) { _cell->write(static_cast<tValue>(_cell->read() & value)); return *this; }
+
+private:
+    RegisterCell *_cell; ///< The register.
+};
+
+
+/// The access to a bit field, like the members of `bit` in the chip headers.
+///
+/// A write to a field, which does not cover the whole register, reads the register and
+/// writes it back with the modified bits. This is what the compiled code does on the chip.
+///
+template<typename tValue, uint8_t tOffset, uint8_t tWidth>
+class RegisterField
+{
+public:
+    static constexpr uint32_t cMask = ((tWidth >= 32) ? 0xffffffffu : ((1u << tWidth) - 1u)) << tOffset;
+    static constexpr uint32_t cRegisterMask = (sizeof(tValue) >= 4) ? 0xffffffffu : ((1u << (sizeof(tValue) * 8u)) - 1u);
+
+public:
+    explicit RegisterField(RegisterCell *cell) noexcept : _cell(cell) {}
+    RegisterField(const RegisterField&) = delete;
+    RegisterField& operator=(const RegisterField&) = delete;
+
+public:
+    operator tValue() const { return static_cast<tValue>((_cell->read() & cMask) >> tOffset); }
+    RegisterField& operator=(uint32_t value) {
+        const uint32_t bits = (value << tOffset) & cMask;
+        if (cMask == cRegisterMask) {
+            _cell->write(bits);
+        } else {
+            _cell->write((_cell->read() & ~cMask) | bits);
+        }
+        return *this;
+    }
+
+private:
+    RegisterCell *_cell; ///< The register.
+};
+
+
+/// A simulated register with the `reg` and `bit` members of the chip headers.
+///
+/// @tparam tValue The value type of the register.
+/// @tparam tBits The structure with the bit fields, it gets the cell as first member.
+///
+template<typename tValue, typename tBits>
+struct Register
+{
+    Register() noexcept : cell(), reg(&cell), bit{&cell} {}
+    Register(const Register&) = delete;
+    Register& operator=(const Register&) = delete;
+
+    RegisterCell cell; ///< The storage, used by the peripheral.
+    RegisterValue<tValue> reg; ///< The whole register.
+    tBits bit; ///< The bit fields.
+};
+
+
+/// The bit fields of a register without named fields.
+///
+struct NoBits {
+    RegisterCell *cell;
+};
+
+
+}
+
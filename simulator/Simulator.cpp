@@ -0,0 +1,484 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Simulator.hpp"
+
+
+#include "DmaControllerModel.hpp"
+#include "I2cMasterModel.hpp"
+#include "PortModel.hpp"
+
+#include "Reset_SAMD21.hpp"
+
+#include "hal-core/Chip.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+
+namespace lr::sim {
+
+
+// The registers, they are defined before the models, which connect to them.
+Sercom gSercom[6];
+Dmac gDmac;
+Port gPort;
+SysTick_Type gSysTick = {SysTick_CTRL_ENABLE_Msk|SysTick_CTRL_TICKINT_Msk, 47'999, {}, 0};
+SCB_Type gScb = {0x410cc601u, {}};
+Gclk gGclk = {};
+Pm gPm = {};
+Nvmctrl gNvmctrl = {};
+
+
+namespace {
+
+
+/// The number of SERCOM interfaces.
+///
+constexpr uint8_t cSercomCount = 6;
+
+/// The vector number of the SysTick exception.
+///
+constexpr uint16_t cSysTickVector = 15;
+
+/// The vector number of the first interrupt.
+///
+constexpr uint16_t cFirstInterruptVector = 16;
+
+/// The maximum number of handlers in a row, before the simulation assumes an interrupt storm.
+///
+constexpr uint32_t cInterruptStormLimit = 100'000;
+
+
+/// The models of the SERCOM interfaces.
+///
+I2cMasterModel gI2cMasters[cSercomCount] = {
+    I2cMasterModel(gSercom[0].I2CM), I2cMasterModel(gSercom[1].I2CM), I2cMasterModel(gSercom[2].I2CM),
+    I2cMasterModel(gSercom[3].I2CM), I2cMasterModel(gSercom[4].I2CM), I2cMasterModel(gSercom[5].I2CM),
+};
+
+/// The model of the DMA controller.
+///
+DmaControllerModel gDmaController(gDmac);
+
+/// The model of the port.
+///
+PortModel gPortModel(gPort);
+
+/// The current time.
+///
+Cycles gCycles = 0;
+
+/// The time of the next SysTick wrap.
+///
+Cycles gNextSysTickWrap = 48'000;
+
+/// If the SysTick exception is pending.
+///
+bool gSysTickPending = false;
+
+/// The enabled interrupts in the NVIC.
+///
+uint32_t gInterruptEnabled = 0;
+
+/// The interrupts set pending by software.
+///
+uint32_t gInterruptPending = 0;
+
+/// If the interrupts are disabled.
+///
+bool gPrimask = false;
+
+/// The active exception number, or zero in thread mode.
+///
+uint16_t gActiveVector = 0;
+
+/// The cycles spent in handlers.
+///
+Cycles gHandlerCycles = 0;
+
+/// The number of executed handlers.
+///
+uint32_t gInterruptCount = 0;
+
+/// The number of executed handlers for each interrupt.
+///
+uint32_t gInterruptCounts[32] = {};
+
+
+/// Get the cycles of one SysTick period.
+///
+inline Cycles getSysTickPeriod() {
+    return static_cast<Cycles>(gSysTick.LOAD & SysTick_VAL_CURRENT_Msk) + 1;
+}
+
+
+/// Check if an interrupt line is active.
+///
+bool isInterruptLineActive(uint8_t irq) {
+    if (irq == DMAC_IRQn) {
+        return gDmaController.isInterruptActive();
+    }
+    if (irq >= SERCOM0_IRQn && irq <= SERCOM5_IRQn) {
+        return gI2cMasters[irq - SERCOM0_IRQn].isInterruptActive();
+    }
+    return false;
+}
+
+
+/// Get the highest priority pending exception.
+///
+/// All interrupts use the same priority, so the lowest exception number wins.
+///
+/// @return The exception number, or zero if nothing is pending.
+///
+uint16_t getPendingVector() {
+    if (gSysTickPending && (gSysTick.CTRL & SysTick_CTRL_TICKINT_Msk) != 0) {
+        return cSysTickVector;
+    }
+    for (uint8_t irq = 0; irq < 32; ++irq) {
+        const auto mask = static_cast<uint32_t>(1) << irq;
+        if ((gInterruptEnabled & mask) != 0 && ((gInterruptPending & mask) != 0 || isInterruptLineActive(irq))) {
+            return static_cast<uint16_t>(cFirstInterruptVector + irq);
+        }
+    }
+    return 0;
+}
+
+
+/// Call the handler for an exception.
+///
+void callHandler(uint16_t vector) {
+    if (vector == cSysTickVector) {
+        gSysTickPending = false;
+        SysTick_Handler();
+        return;
+    }
+    const auto irq = static_cast<uint8_t>(vector - cFirstInterruptVector);
+    gInterruptPending &= ~(static_cast<uint32_t>(1) << irq);
+    ++gInterruptCounts[irq];
+    switch (irq) {
+    case DMAC_IRQn: DMAC_Handler(); break;
+    case SERCOM0_IRQn: SERCOM0_Handler(); break;
+    case SERCOM1_IRQn: SERCOM1_Handler(); break;
+    case SERCOM2_IRQn: SERCOM2_Handler(); break;
+    case SERCOM3_IRQn: SERCOM3_Handler(); break;
+    case SERCOM4_IRQn: SERCOM4_Handler(); break;
+    case SERCOM5_IRQn: SERCOM5_Handler(); break;
+    default: break; // No handler in the simulation.
+    }
+}
+
+
+/// Execute all pending interrupts, if the CPU accepts them.
+///
+void deliverInterrupts() {
+    if (gPrimask || gActiveVector != 0) {
+        return;
+    }
+    uint32_t count = 0;
+    for (auto vector = getPendingVector(); vector != 0; vector = getPendingVector()) {
+        if (++count > cInterruptStormLimit) {
+            std::fprintf(stderr, "Interrupt storm: exception %u does not clear its flags.\n", vector);
+            std::abort();
+        }
+        const auto start = gCycles;
+        ++gInterruptCount;
+        gActiveVector = vector;
+        advance(cInterruptEntryCycles);
+        callHandler(vector);
+        advance(cInterruptExitCycles);
+        gActiveVector = 0;
+        gHandlerCycles += gCycles - start;
+    }
+}
+
+
+/// Get the time of the next event.
+///
+Cycles getNextEvent() {
+    auto result = gNextSysTickWrap;
+    for (const auto &master : gI2cMasters) {
+        const auto next = master.getNextEvent();
+        if (next < result) {
+            result = next;
+        }
+    }
+    const auto next = gDmaController.getNextEvent();
+    if (next < result) {
+        result = next;
+    }
+    return result;
+}
+
+
+/// Process all events up to the current time.
+///
+void processEvents() {
+    while (gNextSysTickWrap <= gCycles) {
+        gNextSysTickWrap += getSysTickPeriod();
+        gSysTickPending = true;
+    }
+    for (auto &master : gI2cMasters) {
+        master.processEvents(gCycles);
+    }
+    gDmaController.updateTriggers(gCycles);
+    gDmaController.processEvents(gCycles);
+    gDmaController.updateTriggers(gCycles);
+}
+
+
+/// Advance the time to the next event, but not beyond a limit.
+///
+/// Interrupts are delivered after the event.
+///
+/// @param limit The latest time.
+///
+void advanceToNextEvent(Cycles limit) {
+    const auto next = getNextEvent();
+    if (next > limit) {
+        if (limit > gCycles) {
+            gCycles = limit;
+        }
+        return;
+    }
+    if (next > gCycles) {
+        gCycles = next;
+    }
+    processEvents();
+    deliverInterrupts();
+}
+
+
+}
+
+
+Cycles getCycles()
+{
+    return gCycles;
+}
+
+
+void accessRegister()
+{
+    advance(cRegisterAccessCycles);
+}
+
+
+void advance(Cycles cycles)
+{
+    const auto target = gCycles + cycles;
+    while (getNextEvent() <= target) {
+        advanceToNextEvent(target);
+    }
+    if (target > gCycles) {
+        gCycles = target;
+    }
+    processEvents();
+    deliverInterrupts();
+}
+
+
+void runFor(Cycles cycles)
+{
+    const auto target = gCycles + cycles;
+    while (gCycles < target) {
+        advanceToNextEvent(target);
+    }
+}
+
+
+bool runUntil(const std::function<bool()> &condition, Cycles maximum)
+{
+    const auto target = gCycles + maximum;
+    while (!condition()) {
+        if (gCycles >= target) {
+            return false;
+        }
+        advanceToNextEvent(target);
+    }
+    return true;
+}
+
+
+void waitForInterrupt()
+{
+    // The SysTick wraps every millisecond, so there is always a next event.
+    // Events without an interrupt do not wake the CPU.
+    const auto interruptCount = gInterruptCount;
+    while (gInterruptCount == interruptCount && getPendingVector() == 0) {
+        advanceToNextEvent(cNoEvent);
+    }
+}
+
+
+Cycles getHandlerCycles()
+{
+    return gHandlerCycles;
+}
+
+
+uint32_t getInterruptCount()
+{
+    return gInterruptCount;
+}
+
+
+uint32_t getInterruptCount(uint8_t irq)
+{
+    return gInterruptCounts[irq % 32];
+}
+
+
+I2cMasterModel& getI2cMaster(uint8_t sercomIndex)
+{
+    return gI2cMasters[sercomIndex % cSercomCount];
+}
+
+
+DmaControllerModel& getDmaController()
+{
+    return gDmaController;
+}
+
+
+PortModel& getPort()
+{
+    return gPortModel;
+}
+
+
+SysTickValue::operator uint32_t() const
+{
+    const auto period = getSysTickPeriod();
+    const auto value = static_cast<uint32_t>((period - 1) - (gCycles % period));
+    accessRegister();
+    return value;
+}
+
+
+InterruptControlState::operator uint32_t() const
+{
+    uint32_t value = gActiveVector & SCB_ICSR_VECTACTIVE_Msk;
+    if (gSysTickPending) {
+        value |= SCB_ICSR_PENDSTSET_Msk;
+    }
+    accessRegister();
+    return value;
+}
+
+
+}
+
+
+namespace lr::Reset {
+
+
+void eraseTick()
+{
+    // The simulation has no flash to erase.
+}
+
+
+}
+
+
+using lr::sim::gInterruptEnabled;
+using lr::sim::gInterruptPending;
+
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+    if (irq >= 0) {
+        lr::sim::gInterruptEnabled |= (static_cast<uint32_t>(1) << irq);
+        lr::sim::deliverInterrupts();
+    }
+}
+
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+    if (irq >= 0) {
+        lr::sim::gInterruptEnabled &= ~(static_cast<uint32_t>(1) << irq);
+    }
+}
+
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+    if (irq >= 0) {
+        lr::sim::gInterruptPending &= ~(static_cast<uint32_t>(1) << irq);
+    }
+}
+
+
+void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+    if (irq >= 0) {
+        lr::sim::gInterruptPending |= (static_cast<uint32_t>(1) << irq);
+        lr::sim::deliverInterrupts();
+    }
+}
+
+
+void NVIC_SetPriority(IRQn_Type, uint32_t)
+{
+    // All interrupts have the same priority in the simulation.
+}
+
+
+void NVIC_SystemReset()
+{
+    std::fprintf(stderr, "System reset requested.\n");
+    std::abort();
+}
+
+
+void __disable_irq()
+{
+    lr::sim::gPrimask = true;
+}
+
+
+void __enable_irq()
+{
+    lr::sim::gPrimask = false;
+    lr::sim::deliverInterrupts();
+}
+
+
+uint32_t __get_PRIMASK()
+{
+    return lr::sim::gPrimask ? 1u : 0u;
+}
+
+
+void __set_PRIMASK(uint32_t primask)
+{
+    if ((primask & 1u) != 0) {
+        __disable_irq();
+    } else {
+        __enable_irq();
+    }
+}
+
+
+void __WFI()
+{
+    lr::sim::waitForInterrupt();
+}
+
@@ -0,0 +1,150 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <cstdint>
+#include <functional>
+
+
+namespace lr::sim {
+
+
+class I2cMasterModel;
+class DmaControllerModel;
+class PortModel;
+
+
+/// A number of CPU clock cycles.
+///
+using Cycles = uint64_t;
+
+/// The value for "no event" of a component.
+///
+constexpr Cycles cNoEvent = ~static_cast<Cycles>(0);
+
+/// The CPU clock of the simulated chip.
+///
+constexpr Cycles cCpuClock = 48'000'000ull;
+
+/// The cycles for one access to a peripheral register.
+///
+/// The APB bridge adds wait states, an access to a SERCOM or DMAC register takes about
+/// this many cycles on the chip. The simulation uses the same value for all registers.
+///
+constexpr Cycles cRegisterAccessCycles = 6;
+
+/// The cycles from a pending interrupt to the first instruction of its handler.
+///
+constexpr Cycles cInterruptEntryCycles = 15;
+
+/// The cycles to return from an interrupt handler.
+///
+constexpr Cycles cInterruptExitCycles = 13;
+
+
+/// Get the clock cycles for a number of microseconds.
+///
+constexpr Cycles fromMicroseconds(uint32_t microseconds) {
+    return static_cast<Cycles>(microseconds) * (cCpuClock / 1'000'000ull);
+}
+
+/// Get the clock cycles for a number of milliseconds.
+///
+constexpr Cycles fromMilliseconds(uint32_t milliseconds) {
+    return static_cast<Cycles>(milliseconds) * (cCpuClock / 1'000ull);
+}
+
+
+/// Get the current time of the simulation.
+///
+/// @return The CPU clock cycles since the start of the simulation.
+///
+Cycles getCycles();
+
+/// Account the time for a register access.
+///
+/// Called by the simulated peripherals for every access. Events of the peripherals and
+/// interrupts happen in this call, like between two instructions on the chip.
+///
+void accessRegister();
+
+/// Let the time pass, while the CPU executes code without register accesses.
+///
+/// @param cycles The number of cycles.
+///
+void advance(Cycles cycles);
+
+/// Let the CPU wait in the main loop for a number of cycles.
+///
+/// All events and interrupts in this time are processed.
+///
+/// @param cycles The number of cycles.
+///
+void runFor(Cycles cycles);
+
+/// Let the CPU wait in the main loop until a condition is met.
+///
+/// The condition is checked after every event of the simulation.
+///
+/// @param condition The condition.
+/// @param maximum The maximum number of cycles to wait.
+/// @return `true` if the condition was met, `false` on a timeout.
+///
+bool runUntil(const std::function<bool()> &condition, Cycles maximum);
+
+/// Wait for the next interrupt, like the `WFI` instruction.
+///
+/// Returns after an interrupt was executed, or if an interrupt is pending while the
+/// interrupts are disabled.
+///
+void waitForInterrupt();
+
+/// Get the total cycles spent in interrupt handlers.
+///
+/// Includes the entry and exit of the handlers.
+///
+Cycles getHandlerCycles();
+
+/// Get the number of executed interrupt handlers.
+///
+uint32_t getInterruptCount();
+
+/// Get the number of executed handlers for one interrupt.
+///
+/// @param irq The interrupt number, e.g. `DMAC_IRQn`.
+///
+uint32_t getInterruptCount(uint8_t irq);
+
+/// Access the model of a SERCOM interface in I2C master mode.
+///
+/// @param sercomIndex The index of the SERCOM interface, 0-5.
+///
+I2cMasterModel& getI2cMaster(uint8_t sercomIndex);
+
+/// Access the model of the DMA controller.
+///
+DmaControllerModel& getDmaController();
+
+/// Access the model of the port.
+///
+PortModel& getPort();
+
+
+}
+
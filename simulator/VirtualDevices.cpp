@@ -0,0 +1,349 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "VirtualDevices.hpp"
+
+
+namespace lr::sim {
+
+
+RegisterMapDevice::RegisterMapDevice(uint8_t address, uint16_t size)
+    : I2cDevice(address), _registers(size, 0)
+{
+}
+
+
+void RegisterMapDevice::setRegister(uint8_t registerAddress, uint8_t value)
+{
+    _registers[registerAddress % _registers.size()] = value;
+}
+
+
+uint8_t RegisterMapDevice::getRegister(uint8_t registerAddress) const
+{
+    return _registers[registerAddress % _registers.size()];
+}
+
+
+bool RegisterMapDevice::onStart(bool read)
+{
+    ++_transactionCount;
+    _expectPointer = !read;
+    return true;
+}
+
+
+bool RegisterMapDevice::onWrite(uint8_t data)
+{
+    if (_expectPointer) {
+        _pointer = static_cast<uint16_t>(data % _registers.size());
+        _expectPointer = false;
+    } else {
+        _registers[_pointer] = data;
+        _pointer = static_cast<uint16_t>((_pointer + 1) % _registers.size());
+    }
+    return true;
+}
+
+
+uint8_t RegisterMapDevice::onRead()
+{
+    const auto value = _registers[_pointer];
+    _pointer = static_cast<uint16_t>((_pointer + 1) % _registers.size());
+    return value;
+}
+
+
+Cycles RegisterMapDevice::getStretchCycles() const
+{
+    return _stretchCycles;
+}
+
+
+bool RegisterMapDevice::supportsHighSpeed() const
+{
+    return _isHighSpeed;
+}
+
+
+EepromDevice::EepromDevice(uint8_t address, uint32_t size, uint16_t pageSize, Cycles writeCycles)
+    : I2cDevice(address), _memory(size, 0xffu), _pageSize(pageSize), _writeCycles(writeCycles)
+{
+}
+
+
+bool EepromDevice::isWriting() const
+{
+    return getCycles() < _writeEnd;
+}
+
+
+bool EepromDevice::onStart(bool read)
+{
+    if (isWriting()) {
+        ++_busyNackCount;
+        return false;
+    }
+    _isWrite = !read;
+    if (_isWrite) {
+        _addressBytes = 0;
+        _pending.clear();
+    }
+    return true;
+}
+
+
+bool EepromDevice::onWrite(uint8_t data)
+{
+    if (_addressBytes < 2) {
+        _pointer = ((_pointer << 8u) | data) & 0xffffu;
+        if (++_addressBytes == 2) {
+            _pointer %= _memory.size();
+        }
+        return true;
+    }
+    _pending.push_back(PendingByte{_pointer, data});
+    // The address wraps inside the page.
+    const auto pageStart = _pointer - (_pointer % _pageSize);
+    _pointer = pageStart + ((_pointer + 1) % _pageSize);
+    return true;
+}
+
+
+uint8_t EepromDevice::onRead()
+{
+    const auto value = _memory[_pointer];
+    _pointer = (_pointer + 1) % _memory.size();
+    return value;
+}
+
+
+void EepromDevice::onStop()
+{
+    if (!_isWrite || _pending.empty()) {
+        return;
+    }
+    for (const auto &pendingByte : _pending) {
+        _memory[pendingByte.address] = pendingByte.data;
+    }
+    _pending.clear();
+    _writeEnd = getCycles() + _writeCycles;
+}
+
+
+NackDevice::NackDevice(uint8_t address, uint8_t acceptedBytes, bool nackAddress) noexcept
+    : I2cDevice(address), _acceptedBytes(acceptedBytes), _nackAddress(nackAddress)
+{
+}
+
+
+bool NackDevice::onStart(bool)
+{
+    _byteCount = 0;
+    return !_nackAddress;
+}
+
+
+bool NackDevice::onWrite(uint8_t)
+{
+    if (_byteCount >= _acceptedBytes) {
+        return false;
+    }
+    ++_byteCount;
+    return true;
+}
+
+
+StuckDevice::StuckDevice(uint8_t address)
+    : RegisterMapDevice(address)
+{
+}
+
+
+bool StuckDevice::isHoldingData() const
+{
+    return _holdPulses > 0;
+}
+
+
+void StuckDevice::onClockPulse()
+{
+    if (_holdPulses > 0) {
+        --_holdPulses;
+    }
+}
+
+
+SmBusDevice::SmBusDevice(uint8_t address)
+    : I2cDevice(address)
+{
+}
+
+
+uint8_t SmBusDevice::calculatePec(const std::vector<uint8_t> &message)
+{
+    uint8_t crc = 0;
+    for (const auto data : message) {
+        crc ^= data;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint8_t>((crc & 0x80u) != 0 ? ((crc << 1u) ^ 0x07u) : (crc << 1u));
+        }
+    }
+    return crc;
+}
+
+
+void SmBusDevice::addCommand(uint8_t command, Protocol protocol)
+{
+    _commands[command] = protocol;
+}
+
+
+uint16_t SmBusDevice::getWord(uint8_t command) const
+{
+    const auto it = _words.find(command);
+    return (it != _words.end()) ? it->second : 0;
+}
+
+
+std::vector<uint8_t> SmBusDevice::getBlock(uint8_t command) const
+{
+    const auto it = _blocks.find(command);
+    return (it != _blocks.end()) ? it->second : std::vector<uint8_t>();
+}
+
+
+bool SmBusDevice::onStart(bool read)
+{
+    const auto addressData = static_cast<uint8_t>((getAddress() << 1u) | (read ? 0x01u : 0x00u));
+    if (!read) {
+        _message.clear();
+        _written.clear();
+        _response.clear();
+        _isRead = false;
+    }
+    _message.push_back(addressData);
+    _isActive = true;
+    if (read) {
+        _isRead = true;
+        prepareResponse();
+    }
+    return true;
+}
+
+
+bool SmBusDevice::onWrite(uint8_t data)
+{
+    _message.push_back(data);
+    _written.push_back(data);
+    return true;
+}
+
+
+uint8_t SmBusDevice::onRead()
+{
+    return (_readIndex < _response.size()) ? _response[_readIndex++] : 0xffu;
+}
+
+
+void SmBusDevice::onStop()
+{
+    if (!_isActive) {
+        return;
+    }
+    _isActive = false;
+    if (!_isRead) {
+        storeWrite();
+    }
+}
+
+
+void SmBusDevice::prepareResponse()
+{
+    _response.clear();
+    _readIndex = 0;
+    if (_written.empty() || _commands.count(_written[0]) == 0) {
+        return;
+    }
+    const auto command = _written[0];
+    switch (_commands[command]) {
+    case Protocol::Word:
+        _response = {static_cast<uint8_t>(getWord(command) & 0xffu), static_cast<uint8_t>(getWord(command) >> 8u)};
+        break;
+    case Protocol::Block:
+        _response = getBlock(command);
+        _response.insert(_response.begin(), static_cast<uint8_t>(_response.size()));
+        break;
+    case Protocol::ProcessCall:
+        _response = {static_cast<uint8_t>(getWord(command) & 0xffu), static_cast<uint8_t>(getWord(command) >> 8u)};
+        if (_written.size() == 3) {
+            setWord(command, static_cast<uint16_t>(_written[1] | (_written[2] << 8u)));
+        }
+        break;
+    }
+    if (_isPecEnabled) {
+        auto message = _message;
+        message.insert(message.end(), _response.begin(), _response.end());
+        auto pec = calculatePec(message);
+        if (_isPecCorrupt) {
+            pec ^= 0x01u;
+        }
+        _response.push_back(pec);
+    }
+}
+
+
+void SmBusDevice::storeWrite()
+{
+    if (_written.empty() || _commands.count(_written[0]) == 0) {
+        ++_errorCount;
+        return;
+    }
+    const auto command = _written[0];
+    const std::size_t pecSize = _isPecEnabled ? 1 : 0;
+    if (_isPecEnabled) {
+        // The PEC over the message and its PEC is zero.
+        if (_written.size() < 2 || calculatePec(_message) != 0) {
+            ++_errorCount;
+            return;
+        }
+    }
+    const auto dataEnd = _written.end() - static_cast<std::ptrdiff_t>(pecSize);
+    switch (_commands[command]) {
+    case Protocol::Word:
+        if (_written.size() != 3 + pecSize) {
+            ++_errorCount;
+            return;
+        }
+        setWord(command, static_cast<uint16_t>(_written[1] | (_written[2] << 8u)));
+        break;
+    case Protocol::Block:
+        if (_written.size() < 2 + pecSize || _written[1] == 0 || _written.size() != 2u + _written[1] + pecSize) {
+            ++_errorCount;
+            return;
+        }
+        setBlock(command, std::vector<uint8_t>(_written.begin() + 2, dataEnd));
+        break;
+    case Protocol::ProcessCall:
+        ++_errorCount;
+        break;
+    }
+}
+
+
+}
+
@@ -0,0 +1,312 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "I2cBus.hpp"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+
+namespace lr::sim {
+
+
+/// A device with an 8bit register pointer, like most sensors.
+///
+/// The first byte written after a start sets the register pointer, all following bytes are
+/// written to the registers. Reads start at the register pointer. The pointer increments
+/// after each byte and wraps at the end of the register map.
+///
+class RegisterMapDevice : public I2cDevice
+{
+public:
+    /// Create a new device.
+    ///
+    /// @param address The 7bit address.
+    /// @param size The number of registers, 1-256.
+    ///
+    explicit RegisterMapDevice(uint8_t address, uint16_t size = 256);
+
+public:
+    /// Set the value of a register.
+    ///
+    void setRegister(uint8_t registerAddress, uint8_t value);
+
+    /// Get the value of a register.
+    ///
+    uint8_t getRegister(uint8_t registerAddress) const;
+
+    /// Set the clock stretching for each byte.
+    ///
+    /// @param cycles The stretching in CPU cycles.
+    ///
+    inline void setStretchCycles(Cycles cycles) noexcept { _stretchCycles = cycles; }
+
+    /// Enable or disable the support for the high-speed mode.
+    ///
+    inline void setHighSpeed(bool enabled) noexcept { _isHighSpeed = enabled; }
+
+    /// Get the number of transactions addressed to this device.
+    ///
+    inline uint32_t getTransactionCount() const noexcept { return _transactionCount; }
+
+public: // I2cDevice
+    bool onStart(bool read) override;
+    bool onWrite(uint8_t data) override;
+    uint8_t onRead() override;
+    Cycles getStretchCycles() const override;
+    bool supportsHighSpeed() const override;
+
+private:
+    std::vector<uint8_t> _registers; ///< The register values.
+    uint16_t _pointer = 0; ///< The register pointer.
+    bool _expectPointer = false; ///< If the next written byte is the register pointer.
+    Cycles _stretchCycles = 0; ///< The clock stretching for each byte.
+    bool _isHighSpeed = false; ///< If the device supports the high-speed mode.
+    uint32_t _transactionCount = 0; ///< The number of addressed starts.
+};
+
+
+/// An EEPROM with a 16bit address, like the 24LC256.
+///
+/// Written data is collected in a page buffer, the address wraps at the page boundary.
+/// The stop condition starts the write cycle, while it is running, the device does not
+/// acknowledge its address. Use this to test acknowledge polling.
+///
+class EepromDevice : public I2cDevice
+{
+public:
+    /// Create a new EEPROM, erased to `0xff`.
+    ///
+    /// @param address The 7bit address.
+    /// @param size The size in bytes.
+    /// @param pageSize The size of a page in bytes.
+    /// @param writeCycles The duration of the write cycle in CPU cycles.
+    ///
+    explicit EepromDevice(uint8_t address, uint32_t size = 32'768, uint16_t pageSize = 64,
+        Cycles writeCycles = fromMilliseconds(5));
+
+public:
+    /// Access the memory.
+    ///
+    inline std::vector<uint8_t>& getMemory() noexcept { return _memory; }
+
+    /// Check if a write cycle is running.
+    ///
+    bool isWriting() const;
+
+    /// Get the number of addresses, which were not acknowledged because of a write cycle.
+    ///
+    inline uint32_t getBusyNackCount() const noexcept { return _busyNackCount; }
+
+public: // I2cDevice
+    bool onStart(bool read) override;
+    bool onWrite(uint8_t data) override;
+    uint8_t onRead() override;
+    void onStop() override;
+
+private:
+    /// One byte in the page buffer.
+    ///
+    struct PendingByte {
+        uint32_t address; ///< The address.
+        uint8_t data; ///< The byte.
+    };
+
+private:
+    std::vector<uint8_t> _memory; ///< The memory.
+    uint16_t _pageSize; ///< The size of a page.
+    Cycles _writeCycles; ///< The duration of a write cycle.
+    Cycles _writeEnd = 0; ///< The end of the running write cycle.
+    uint32_t _pointer = 0; ///< The address pointer.
+    uint8_t _addressBytes = 0; ///< The number of received address bytes.
+    bool _isWrite = false; ///< If the current transfer is a write.
+    std::vector<PendingByte> _pending; ///< The bytes for the next write cycle.
+    uint32_t _busyNackCount = 0; ///< The number of addresses not acknowledged while busy.
+};
+
+
+/// A device which does not acknowledge.
+///
+/// The device either does not acknowledge its address, or a byte after a number of
+/// accepted bytes. Use it for the error paths of the driver.
+///
+class NackDevice : public I2cDevice
+{
+public:
+    /// Create a new device.
+    ///
+    /// @param address The 7bit address.
+    /// @param acceptedBytes The number of written bytes to acknowledge after each start.
+    /// @param nackAddress `true` to not acknowledge the address.
+    ///
+    NackDevice(uint8_t address, uint8_t acceptedBytes, bool nackAddress = false) noexcept;
+
+public: // I2cDevice
+    bool onStart(bool read) override;
+    bool onWrite(uint8_t data) override;
+
+private:
+    uint8_t _acceptedBytes; ///< The number of acknowledged bytes.
+    bool _nackAddress; ///< If the address is not acknowledged.
+    uint8_t _byteCount = 0; ///< The bytes written since the start.
+};
+
+
+/// A device which stretches the clock and can get stuck, holding SDA low.
+///
+/// This is the situation after a reset of the master in the middle of a read: the device
+/// still sends a zero bit and waits for clock pulses. The device releases SDA after the
+/// given number of clock pulses of a bus recovery.
+///
+class StuckDevice : public RegisterMapDevice
+{
+public:
+    /// Create a new device.
+    ///
+    /// @param address The 7bit address.
+    ///
+    explicit StuckDevice(uint8_t address);
+
+public:
+    /// Hold SDA low until a number of clock pulses.
+    ///
+    /// @param pulses The clock pulses to release SDA, 1-9.
+    ///
+    inline void holdData(uint8_t pulses) noexcept { _holdPulses = pulses; }
+
+public: // I2cDevice
+    bool isHoldingData() const override;
+    void onClockPulse() override;
+
+private:
+    uint8_t _holdPulses = 0; ///< The remaining clock pulses, while SDA is held.
+};
+
+
+/// A SMBus device, which sends and checks the packet error code (PEC).
+///
+/// Each command code is registered with its protocol. A write word or block write stores
+/// the data at the stop condition. A read word or block read sends the stored data after the
+/// repeated start. A process call answers with the stored word and stores the written one.
+///
+/// The PEC is calculated bit by bit, independent of the table in the driver. If the PEC is
+/// enabled, a write with a wrong or missing PEC is discarded and counted as error.
+///
+class SmBusDevice : public I2cDevice
+{
+public:
+    /// The protocol of a command.
+    ///
+    enum class Protocol : uint8_t {
+        Word, ///< Write word and read word.
+        Block, ///< Block write and block read.
+        ProcessCall, ///< Process call.
+    };
+
+public:
+    /// Create a new device without commands.
+    ///
+    /// @param address The 7bit address.
+    ///
+    explicit SmBusDevice(uint8_t address);
+
+public:
+    /// Calculate the PEC of a message.
+    ///
+    /// @param message All bytes of the message, including the address bytes.
+    /// @return The CRC-8 with the polynomial 0x07.
+    ///
+    static uint8_t calculatePec(const std::vector<uint8_t> &message);
+
+public:
+    /// Register a command.
+    ///
+    void addCommand(uint8_t command, Protocol protocol);
+
+    /// Enable or disable the PEC.
+    ///
+    inline void setPecEnabled(bool enabled) noexcept { _isPecEnabled = enabled; }
+
+    /// Send a wrong PEC with the next reads.
+    ///
+    inline void setCorruptPec(bool corrupt) noexcept { _isPecCorrupt = corrupt; }
+
+    /// Set the word of a command.
+    ///
+    inline void setWord(uint8_t command, uint16_t value) { _words[command] = value; }
+
+    /// Get the word of a command.
+    ///
+    uint16_t getWord(uint8_t command) const;
+
+    /// Set the block of a command.
+    ///
+    inline void setBlock(uint8_t command, const std::vector<uint8_t> &data) { _blocks[command] = data; }
+
+    /// Get the block of a command.
+    ///
+    std::vector<uint8_t> getBlock(uint8_t command) const;
+
+    /// Get the bytes written in the last transaction, including the PEC.
+    ///
+    inline const std::vector<uint8_t>& getWritten() const noexcept { return _written; }
+
+    /// Get the bytes sent in the last transaction, including the PEC.
+    ///
+    inline const std::vector<uint8_t>& getResponse() const noexcept { return _response; }
+
+    /// Get the number of discarded writes.
+    ///
+    inline uint32_t getErrorCount() const noexcept { return _errorCount; }
+
+public: // I2cDevice
+    bool onStart(bool read) override;
+    bool onWrite(uint8_t data) override;
+    uint8_t onRead() override;
+    void onStop() override;
+
+private:
+    /// Prepare the response after the repeated start.
+    ///
+    void prepareResponse();
+
+    /// Store the written data at the end of a write.
+    ///
+    void storeWrite();
+
+private:
+    std::map<uint8_t, Protocol> _commands; ///< The registered commands.
+    std::map<uint8_t, uint16_t> _words; ///< The words of the commands.
+    std::map<uint8_t, std::vector<uint8_t>> _blocks; ///< The blocks of the commands.
+    bool _isPecEnabled = false; ///< If the PEC is sent and checked.
+    bool _isPecCorrupt = false; ///< If a wrong PEC is sent.
+    bool _isRead = false; ///< If the transaction has a read part.
+    bool _isActive = false; ///< If the device is addressed.
+    std::vector<uint8_t> _message; ///< All bytes of the transaction for the PEC.
+    std::vector<uint8_t> _written; ///< The bytes written by the master.
+    std::vector<uint8_t> _response; ///< The bytes to send.
+    std::size_t _readIndex = 0; ///< The index of the next byte to send.
+    uint32_t _errorCount = 0; ///< The number of discarded writes.
+};
+
+
+}
+
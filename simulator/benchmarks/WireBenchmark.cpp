@@ -0,0 +1,284 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "../tests/WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+
+
+namespace {
+
+
+/// The DMA channel for the benchmark.
+///
+constexpr uint8_t cDmaChannel = 0;
+
+/// The number of data bytes in each transfer.
+///
+constexpr uint8_t cByteCount = 32;
+
+
+/// The result of one measurement.
+///
+struct Measurement {
+    Status status; ///< The status of the transfer.
+    sim::Cycles totalCycles; ///< The cycles from the start to the end of the transfer.
+    sim::Cycles busCycles; ///< The cycles the bus was busy.
+    sim::Cycles cpuCycles; ///< The cycles the CPU was busy with the transfer.
+    uint32_t interrupts; ///< The number of interrupts.
+};
+
+
+/// Measure a transfer.
+///
+/// For a blocking transfer, the CPU is busy for the whole time. For an asynchronous
+/// transfer, the CPU is only busy to start the transfer and in the interrupt handlers.
+///
+template<typename Function>
+Measurement measure(bool isAsync, Function function) {
+    auto &fixture = test::WireFixture::get();
+    fixture.bus.resetCounters();
+    const auto startCycles = sim::getCycles();
+    const auto startHandlerCycles = sim::getHandlerCycles();
+    const auto startInterrupts = sim::getInterruptCount();
+    Measurement result = {};
+    result.status = function();
+    const auto startedCycles = sim::getCycles();
+    if (isAsync && result.status == Status::Success) {
+        if (!fixture.waitForAsync()) {
+            result.status = Status::Timeout;
+        } else {
+            result.status = fixture.wire.getAsyncStatus();
+        }
+    }
+    // The transaction is finished with the stop command, wait for the stop condition.
+    sim::runUntil([&fixture]() -> bool { return !fixture.bus.isBusy(); }, sim::fromMilliseconds(10));
+    result.totalCycles = sim::getCycles() - startCycles;
+    result.busCycles = fixture.bus.getCounters().busyCycles;
+    result.interrupts = sim::getInterruptCount() - startInterrupts;
+    const auto handlerCycles = sim::getHandlerCycles() - startHandlerCycles;
+    result.cpuCycles = isAsync ? (startedCycles - startCycles) + handlerCycles : result.totalCycles;
+    return result;
+}
+
+
+/// The register read paths, driven directly on the SERCOM registers.
+///
+/// Both paths share the same framing: the register address is written, a repeated start
+/// reads the bytes and the transfer ends with NACK and stop. They only differ in the loop
+/// that reads the bytes, so the numbers compare the old and the new read loop of the driver.
+///
+namespace legacy {
+
+
+/// The commands of the `CMD` field in `CTRLB`.
+///
+enum class Command : uint8_t {
+    RepeatedStart = 0x1,
+    ByteRead = 0x2,
+    Stop = 0x3,
+};
+
+/// The maximum number of register reads for a wait.
+///
+constexpr uint32_t cMaximumPolls = 100000;
+
+
+/// Wait until a condition is met.
+///
+template<typename Condition>
+bool waitFor(Condition condition) {
+    for (uint32_t i = 0; i < cMaximumPolls; ++i) {
+        if (condition()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Wait for the end of a system operation.
+///
+bool waitForSystemOperation(Sercom *sercom) {
+    return waitFor([sercom]() -> bool { return sercom->I2CM.SYNCBUSY.bit.SYSOP == 0; });
+}
+
+/// Wait for the slave on bus flag (SB).
+///
+bool waitForSlaveOnBus(Sercom *sercom) {
+    return waitFor([sercom]() -> bool { return sercom->I2CM.INTFLAG.bit.SB != 0; });
+}
+
+/// Set the acknowledge action.
+///
+bool setAcknowledge(Sercom *sercom, bool acknowledge) {
+    sercom->I2CM.CTRLB.bit.ACKACT = acknowledge ? 0 : 1;
+    return waitForSystemOperation(sercom);
+}
+
+/// Send a command.
+///
+bool sendCommand(Sercom *sercom, Command command) {
+    sercom->I2CM.CTRLB.bit.CMD = static_cast<uint8_t>(command);
+    return waitForSystemOperation(sercom);
+}
+
+
+/// The read loop before streaming.
+///
+/// Writes the acknowledge action and sends a byte read command for every byte, with a
+/// synchronization after each step.
+///
+bool readBytesPerByte(Sercom *sercom, uint8_t *data, uint8_t count) {
+    for (uint8_t i = 0; i < count; ++i) {
+        if (i != 0) {
+            if (!sendCommand(sercom, Command::ByteRead)) return false;
+            if (!waitForSlaveOnBus(sercom)) return false;
+        }
+        if ((i + 1) == count) {
+            if (!setAcknowledge(sercom, false)) return false;
+            if (!sendCommand(sercom, Command::Stop)) return false;
+        } else {
+            if (!setAcknowledge(sercom, true)) return false;
+        }
+        data[i] = sercom->I2CM.DATA.bit.DATA;
+        if (!waitForSystemOperation(sercom)) return false;
+    }
+    return true;
+}
+
+
+/// The streaming read loop.
+///
+/// The acknowledge action is set before the address. Reading `DATA` acknowledges the byte
+/// and starts the next read in smart mode. The last byte is answered with NACK and stop in
+/// a single `CTRLB` write.
+///
+bool readBytesStreaming(Sercom *sercom, uint8_t *data, uint8_t count) {
+    const uint8_t lastIndex = count - 1;
+    for (uint8_t i = 0; i < lastIndex; ++i) {
+        data[i] = sercom->I2CM.DATA.bit.DATA;
+        if (!waitForSlaveOnBus(sercom)) return false;
+    }
+    sercom->I2CM.CTRLB.reg = SERCOM_I2CM_CTRLB_SMEN|SERCOM_I2CM_CTRLB_ACKACT|
+        SERCOM_I2CM_CTRLB_CMD(static_cast<uint8_t>(Command::Stop));
+    if (!waitForSystemOperation(sercom)) return false;
+    data[lastIndex] = sercom->I2CM.DATA.bit.DATA;
+    return waitForSystemOperation(sercom);
+}
+
+
+/// Read register data with the given read loop.
+///
+template<typename ReadLoop>
+Status readRegisterData(uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count, ReadLoop readLoop) {
+    auto sercom = WireMaster_SAMD21::getSercom(test::cInterface);
+    sercom->I2CM.ADDR.reg = static_cast<uint32_t>(address << 1u);
+    if (!waitFor([sercom]() -> bool { return sercom->I2CM.INTFLAG.bit.MB != 0; })) return Status::Timeout;
+    sercom->I2CM.DATA.reg = registerAddress;
+    if (!waitFor([sercom]() -> bool { return sercom->I2CM.INTFLAG.bit.MB != 0; })) return Status::Timeout;
+    if (!setAcknowledge(sercom, true)) return Status::Timeout;
+    sercom->I2CM.ADDR.reg = static_cast<uint32_t>((address << 1u) | 1u);
+    if (!waitForSlaveOnBus(sercom)) return Status::Timeout;
+    if (!readLoop(sercom, data, count)) return Status::Timeout;
+    if (!waitFor([sercom]() -> bool { return sercom->I2CM.STATUS.bit.BUSSTATE == 1; })) return Status::Timeout;
+    return Status::Success;
+}
+
+
+}
+
+
+/// Check the data read back from the device.
+///
+Status checkData(Status status, const uint8_t *data) {
+    for (uint8_t i = 0; i < cByteCount && status == Status::Success; ++i) {
+        if (data[i] != i) {
+            status = Status::Error;
+        }
+    }
+    return status;
+}
+
+
+/// Print a measurement.
+///
+void print(const char *name, const Measurement &measurement) {
+    std::printf("%-24s %6s %10llu %10llu %10llu %6u\n", name,
+        (measurement.status == Status::Success) ? "ok" : "FAILED",
+        static_cast<unsigned long long>(measurement.totalCycles),
+        static_cast<unsigned long long>(measurement.busCycles),
+        static_cast<unsigned long long>(measurement.cpuCycles),
+        static_cast<unsigned>(measurement.interrupts));
+}
+
+
+}
+
+
+int main()
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    fixture.wire.setSpeed(WireMaster::Speed::Fast, Nanoseconds(100));
+    if (fixture.wire.setDmaChannel(cDmaChannel) != Status::Success) {
+        std::printf("Could not set the DMA channel.\n");
+        return 1;
+    }
+    uint8_t data[cByteCount];
+    for (uint8_t i = 0; i < cByteCount; ++i) {
+        data[i] = i;
+    }
+    auto &wire = fixture.wire;
+    std::printf("%u bytes at 400kHz, cycles at 48MHz.\n", static_cast<unsigned>(cByteCount));
+    std::printf("%-24s %6s %10s %10s %10s %6s\n", "Transfer", "Status", "Total", "Bus", "CPU", "IRQs");
+    print("write blocking", measure(false, [&]() {
+        return wire.writeRegisterData(0x40, 0x00, data, cByteCount);
+    }));
+    print("write interrupt", measure(true, [&]() {
+        return wire.writeRegisterDataAsync(0x40, 0x00, data, cByteCount);
+    }));
+    print("write dma", measure(true, [&]() {
+        return wire.writeRegisterDataDma(0x40, 0x00, data, cByteCount);
+    }));
+    print("read per byte (old)", measure(false, [&]() {
+        std::fill(data, data + cByteCount, 0xff);
+        return checkData(legacy::readRegisterData(0x40, 0x00, data, cByteCount, legacy::readBytesPerByte), data);
+    }));
+    print("read streaming (new)", measure(false, [&]() {
+        std::fill(data, data + cByteCount, 0xff);
+        return checkData(legacy::readRegisterData(0x40, 0x00, data, cByteCount, legacy::readBytesStreaming), data);
+    }));
+    print("read blocking", measure(false, [&]() {
+        return wire.readRegisterData(0x40, 0x00, data, cByteCount);
+    }));
+    print("read interrupt", measure(true, [&]() {
+        return wire.readRegisterDataAsync(0x40, 0x00, data, cByteCount);
+    }));
+    print("read dma", measure(true, [&]() {
+        return wire.readRegisterDataDma(0x40, 0x00, data, cByteCount);
+    }));
+    return 0;
+}
+
@@ -0,0 +1,562 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+// The host replacement of the chip header for the simulator.
+//
+// It declares the subset of the SAM D21 CMSIS definitions, which is used by the I2C driver
+// and the modules it depends on. The registers of the SERCOM I2C master, the DMA controller,
+// SysTick and the interrupt control state are simulated, all other registers are plain memory.
+// The bit positions and values are the ones of the SAM D21 datasheet.
+
+
+#include "Register.hpp"
+
+#include <cstdint>
+
+
+// ---------------------------------------------------------------------------
+// Core
+// ---------------------------------------------------------------------------
+
+typedef enum IRQn {
+    SysTick_IRQn = -1,
+    PM_IRQn = 0,
+    SYSCTRL_IRQn = 1,
+    WDT_IRQn = 2,
+    RTC_IRQn = 3,
+    EIC_IRQn = 4,
+    NVMCTRL_IRQn = 5,
+    DMAC_IRQn = 6,
+    USB_IRQn = 7,
+    EVSYS_IRQn = 8,
+    SERCOM0_IRQn = 9,
+    SERCOM1_IRQn = 10,
+    SERCOM2_IRQn = 11,
+    SERCOM3_IRQn = 12,
+    SERCOM4_IRQn = 13,
+    SERCOM5_IRQn = 14,
+    TCC0_IRQn = 15,
+    TCC1_IRQn = 16,
+    TCC2_IRQn = 17,
+    TC3_IRQn = 18,
+    TC4_IRQn = 19,
+    TC5_IRQn = 20,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+[[noreturn]] void NVIC_SystemReset();
+void __disable_irq();
+void __enable_irq();
+uint32_t __get_PRIMASK();
+void __set_PRIMASK(uint32_t primask);
+void __WFI();
+inline void __DSB() {}
+inline void __ISB() {}
+inline void __NOP() {}
+
+
+namespace lr::sim {
+
+/// The current value of the SysTick counter.
+///
+class SysTickValue
+{
+public:
+    operator uint32_t() const;
+};
+
+/// The interrupt control and state register.
+///
+class InterruptControlState
+{
+public:
+    operator uint32_t() const;
+};
+
+}
+
+typedef struct {
+    volatile uint32_t CTRL;
+    volatile uint32_t LOAD;
+    lr::sim::SysTickValue VAL;
+    volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+    volatile uint32_t CPUID;
+    lr::sim::InterruptControlState ICSR;
+} SCB_Type;
+
+namespace lr::sim {
+extern SysTick_Type gSysTick;
+extern SCB_Type gScb;
+}
+
+#define SysTick (&lr::sim::gSysTick)
+#define SCB (&lr::sim::gScb)
+
+#define SysTick_CTRL_ENABLE_Msk (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk (1UL << 1)
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL << 16)
+#define SysTick_VAL_CURRENT_Msk (0xFFFFFFUL)
+#define SCB_ICSR_VECTACTIVE_Msk (0x1FFUL)
+#define SCB_ICSR_PENDSTSET_Msk (1UL << 26)
+
+
+// ---------------------------------------------------------------------------
+// SERCOM I2C master
+// ---------------------------------------------------------------------------
+
+namespace lr::sim {
+
+template<uint8_t tOffset, uint8_t tWidth> using Field8 = RegisterField<uint8_t, tOffset, tWidth>;
+template<uint8_t tOffset, uint8_t tWidth> using Field16 = RegisterField<uint16_t, tOffset, tWidth>;
+template<uint8_t tOffset, uint8_t tWidth> using Field32 = RegisterField<uint32_t, tOffset, tWidth>;
+
+struct SercomI2cmCtrlaBits {
+    RegisterCell *cell;
+    Field32<0, 1> SWRST{cell};
+    Field32<1, 1> ENABLE{cell};
+    Field32<2, 3> MODE{cell};
+    Field32<7, 1> RUNSTDBY{cell};
+    Field32<16, 1> PINOUT{cell};
+    Field32<20, 2> SDAHOLD{cell};
+    Field32<22, 1> MEXTTOEN{cell};
+    Field32<23, 1> SEXTTOEN{cell};
+    Field32<24, 2> SPEED{cell};
+    Field32<27, 1> SCLSM{cell};
+    Field32<28, 2> INACTOUT{cell};
+    Field32<30, 1> LOWTOUTEN{cell};
+};
+
+struct SercomI2cmCtrlbBits {
+    RegisterCell *cell;
+    Field32<8, 1> SMEN{cell};
+    Field32<9, 1> QCEN{cell};
+    Field32<16, 2> CMD{cell};
+    Field32<18, 1> ACKACT{cell};
+};
+
+struct SercomI2cmBaudBits {
+    RegisterCell *cell;
+    Field32<0, 8> BAUD{cell};
+    Field32<8, 8> BAUDLOW{cell};
+    Field32<16, 8> HSBAUD{cell};
+    Field32<24, 8> HSBAUDLOW{cell};
+};
+
+struct SercomI2cmIntBits {
+    RegisterCell *cell;
+    Field8<0, 1> MB{cell};
+    Field8<1, 1> SB{cell};
+    Field8<7, 1> ERROR{cell};
+};
+
+struct SercomI2cmStatusBits {
+    RegisterCell *cell;
+    Field16<0, 1> BUSERR{cell};
+    Field16<1, 1> ARBLOST{cell};
+    Field16<2, 1> RXNACK{cell};
+    Field16<4, 2> BUSSTATE{cell};
+    Field16<6, 1> LOWTOUT{cell};
+    Field16<7, 1> CLKHOLD{cell};
+    Field16<8, 1> MEXTTOUT{cell};
+    Field16<9, 1> SEXTTOUT{cell};
+    Field16<10, 1> LENERR{cell};
+};
+
+struct SercomI2cmSyncbusyBits {
+    RegisterCell *cell;
+    Field32<0, 1> SWRST{cell};
+    Field32<1, 1> ENABLE{cell};
+    Field32<2, 1> SYSOP{cell};
+};
+
+struct SercomI2cmAddrBits {
+    RegisterCell *cell;
+    Field32<0, 11> ADDR{cell};
+    Field32<13, 1> LENEN{cell};
+    Field32<14, 1> HS{cell};
+    Field32<15, 1> TENBITEN{cell};
+    Field32<16, 8> LEN{cell};
+};
+
+struct SercomI2cmDataBits {
+    RegisterCell *cell;
+    Field8<0, 8> DATA{cell};
+};
+
+}
+
+/// The registers of a SERCOM in I2C master mode.
+///
+typedef struct {
+    lr::sim::Register<uint32_t, lr::sim::SercomI2cmCtrlaBits> CTRLA;
+    lr::sim::Register<uint32_t, lr::sim::SercomI2cmCtrlbBits> CTRLB;
+    lr::sim::Register<uint32_t, lr::sim::SercomI2cmBaudBits> BAUD;
+    lr::sim::Register<uint8_t, lr::sim::SercomI2cmIntBits> INTENCLR;
+    lr::sim::Register<uint8_t, lr::sim::SercomI2cmIntBits> INTENSET;
+    lr::sim::Register<uint8_t, lr::sim::SercomI2cmIntBits> INTFLAG;
+    lr::sim::Register<uint16_t, lr::sim::SercomI2cmStatusBits> STATUS;
+    lr::sim::Register<uint32_t, lr::sim::SercomI2cmSyncbusyBits> SYNCBUSY;
+    lr::sim::Register<uint32_t, lr::sim::SercomI2cmAddrBits> ADDR;
+    lr::sim::Register<uint8_t, lr::sim::SercomI2cmDataBits> DATA;
+    lr::sim::Register<uint8_t, lr::sim::NoBits> DBGCTRL;
+} SercomI2cm;
+
+/// A SERCOM interface, only the I2C master mode is simulated.
+///
+typedef struct {
+    SercomI2cm I2CM;
+} Sercom;
+
+#define SERCOM_I2CM_CTRLA_SWRST (0x1UL << 0)
+#define SERCOM_I2CM_CTRLA_ENABLE (0x1UL << 1)
+#define SERCOM_I2CM_CTRLA_MODE(value) ((0x7UL & (value)) << 2)
+#define SERCOM_I2CM_CTRLA_MODE_I2C_MASTER_Val 0x5UL
+#define SERCOM_I2CM_CTRLA_SDAHOLD(value) ((0x3UL & (value)) << 20)
+#define SERCOM_I2CM_CTRLA_MEXTTOEN (0x1UL << 22)
+#define SERCOM_I2CM_CTRLA_SEXTTOEN (0x1UL << 23)
+#define SERCOM_I2CM_CTRLA_SPEED(value) ((0x3UL & (value)) << 24)
+#define SERCOM_I2CM_CTRLA_SCLSM (0x1UL << 27)
+#define SERCOM_I2CM_CTRLA_LOWTOUTEN (0x1UL << 30)
+#define SERCOM_I2CM_CTRLB_SMEN (0x1UL << 8)
+#define SERCOM_I2CM_CTRLB_QCEN (0x1UL << 9)
+#define SERCOM_I2CM_CTRLB_CMD(value) ((0x3UL & (value)) << 16)
+#define SERCOM_I2CM_CTRLB_ACKACT_Pos 18
+#define SERCOM_I2CM_CTRLB_ACKACT (0x1UL << 18)
+#define SERCOM_I2CM_BAUD_BAUD(value) ((0xFFUL & (value)) << 0)
+#define SERCOM_I2CM_BAUD_BAUDLOW(value) ((0xFFUL & (value)) << 8)
+#define SERCOM_I2CM_BAUD_HSBAUD(value) ((0xFFUL & (value)) << 16)
+#define SERCOM_I2CM_BAUD_HSBAUDLOW(value) ((0xFFUL & (value)) << 24)
+#define SERCOM_I2CM_INTENCLR_MB (0x1U << 0)
+#define SERCOM_I2CM_INTENCLR_SB (0x1U << 1)
+#define SERCOM_I2CM_INTENCLR_ERROR (0x1U << 7)
+#define SERCOM_I2CM_INTENSET_MB (0x1U << 0)
+#define SERCOM_I2CM_INTENSET_SB (0x1U << 1)
+#define SERCOM_I2CM_INTENSET_ERROR (0x1U << 7)
+#define SERCOM_I2CM_INTFLAG_MB (0x1U << 0)
+#define SERCOM_I2CM_INTFLAG_SB (0x1U << 1)
+#define SERCOM_I2CM_INTFLAG_ERROR (0x1U << 7)
+#define SERCOM_I2CM_STATUS_BUSERR (0x1U << 0)
+#define SERCOM_I2CM_STATUS_ARBLOST (0x1U << 1)
+#define SERCOM_I2CM_STATUS_RXNACK (0x1U << 2)
+#define SERCOM_I2CM_STATUS_BUSSTATE_Pos 4
+#define SERCOM_I2CM_STATUS_BUSSTATE_Msk (0x3U << 4)
+#define SERCOM_I2CM_STATUS_BUSSTATE(value) ((0x3U & (value)) << 4)
+#define SERCOM_I2CM_STATUS_LOWTOUT (0x1U << 6)
+#define SERCOM_I2CM_STATUS_CLKHOLD (0x1U << 7)
+#define SERCOM_I2CM_STATUS_MEXTTOUT (0x1U << 8)
+#define SERCOM_I2CM_STATUS_SEXTTOUT (0x1U << 9)
+#define SERCOM_I2CM_STATUS_LENERR (0x1U << 10)
+#define SERCOM_I2CM_SYNCBUSY_SWRST (0x1UL << 0)
+#define SERCOM_I2CM_SYNCBUSY_ENABLE (0x1UL << 1)
+#define SERCOM_I2CM_SYNCBUSY_SYSOP (0x1UL << 2)
+#define SERCOM_I2CM_ADDR_ADDR(value) ((0x7FFUL & (value)) << 0)
+#define SERCOM_I2CM_ADDR_LENEN (0x1UL << 13)
+#define SERCOM_I2CM_ADDR_HS (0x1UL << 14)
+#define SERCOM_I2CM_ADDR_TENBITEN (0x1UL << 15)
+#define SERCOM_I2CM_ADDR_LEN(value) ((0xFFUL & (value)) << 16)
+
+
+// ---------------------------------------------------------------------------
+// DMA controller
+// ---------------------------------------------------------------------------
+
+/// A transfer descriptor.
+///
+/// The address fields have the size of a host pointer.
+///
+typedef struct {
+    union { uint16_t reg; } BTCTRL;
+    union { uint16_t reg; } BTCNT;
+    union { uintptr_t reg; } SRCADDR;
+    union { uintptr_t reg; } DSTADDR;
+    union { uintptr_t reg; } DESCADDR;
+} DmacDescriptor;
+
+namespace lr::sim {
+
+struct DmacCtrlBits {
+    RegisterCell *cell;
+    Field16<0, 1> SWRST{cell};
+    Field16<1, 1> DMAENABLE{cell};
+    Field16<2, 1> CRCENABLE{cell};
+    Field16<8, 4> LVLEN{cell};
+};
+
+struct DmacChidBits {
+    RegisterCell *cell;
+    Field8<0, 4> ID{cell};
+};
+
+struct DmacChctrlaBits {
+    RegisterCell *cell;
+    Field8<0, 1> SWRST{cell};
+    Field8<1, 1> ENABLE{cell};
+    Field8<6, 1> RUNSTDBY{cell};
+};
+
+struct DmacChctrlbBits {
+    RegisterCell *cell;
+    Field32<5, 2> LVL{cell};
+    Field32<8, 6> TRIGSRC{cell};
+    Field32<22, 2> TRIGACT{cell};
+    Field32<24, 2> CMD{cell};
+};
+
+struct DmacChintBits {
+    RegisterCell *cell;
+    Field8<0, 1> TERR{cell};
+    Field8<1, 1> TCMPL{cell};
+    Field8<2, 1> SUSP{cell};
+};
+
+struct DmacIntpendBits {
+    RegisterCell *cell;
+    Field16<0, 4> ID{cell};
+    Field16<8, 1> TERR{cell};
+    Field16<9, 1> TCMPL{cell};
+    Field16<10, 1> SUSP{cell};
+    Field16<13, 1> FERR{cell};
+    Field16<14, 1> BUSY{cell};
+    Field16<15, 1> PEND{cell};
+};
+
+/// A register which holds an address of the host.
+///
+struct AddressRegister {
+    AddressRegister() noexcept = default;
+    AddressRegister(const AddressRegister&) = delete;
+    AddressRegister& operator=(const AddressRegister&) = delete;
+    uintptr_t reg = 0;
+};
+
+}
+
+/// The registers of the DMA controller.
+///
+typedef struct {
+    lr::sim::Register<uint16_t, lr::sim::DmacCtrlBits> CTRL;
+    lr::sim::AddressRegister BASEADDR;
+    lr::sim::AddressRegister WRBADDR;
+    lr::sim::Register<uint8_t, lr::sim::DmacChidBits> CHID;
+    lr::sim::Register<uint8_t, lr::sim::DmacChctrlaBits> CHCTRLA;
+    lr::sim::Register<uint32_t, lr::sim::DmacChctrlbBits> CHCTRLB;
+    lr::sim::Register<uint8_t, lr::sim::DmacChintBits> CHINTENCLR;
+    lr::sim::Register<uint8_t, lr::sim::DmacChintBits> CHINTENSET;
+    lr::sim::Register<uint8_t, lr::sim::DmacChintBits> CHINTFLAG;
+    lr::sim::Register<uint16_t, lr::sim::DmacIntpendBits> INTPEND;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> INTSTATUS;
+} Dmac;
+
+namespace lr::sim {
+extern Dmac gDmac;
+}
+
+#define DMAC (&lr::sim::gDmac)
+
+#define DMAC_CTRL_SWRST (0x1U << 0)
+#define DMAC_CTRL_DMAENABLE (0x1U << 1)
+#define DMAC_CTRL_LVLEN(value) ((0xFU & (value)) << 8)
+#define DMAC_CHID_ID(value) ((0xFU & (value)) << 0)
+#define DMAC_CHCTRLA_SWRST (0x1U << 0)
+#define DMAC_CHCTRLA_ENABLE (0x1U << 1)
+#define DMAC_CHCTRLB_LVL(value) ((0x3UL & (value)) << 5)
+#define DMAC_CHCTRLB_TRIGSRC(value) ((0x3FUL & (value)) << 8)
+#define DMAC_CHCTRLB_TRIGACT_BLOCK (0x0UL << 22)
+#define DMAC_CHCTRLB_TRIGACT_BEAT (0x2UL << 22)
+#define DMAC_CHCTRLB_TRIGACT_TRANSACTION (0x3UL << 22)
+#define DMAC_CHINTENCLR_TERR (0x1U << 0)
+#define DMAC_CHINTENCLR_TCMPL (0x1U << 1)
+#define DMAC_CHINTENSET_TERR (0x1U << 0)
+#define DMAC_CHINTENSET_TCMPL (0x1U << 1)
+#define DMAC_CHINTFLAG_TERR (0x1U << 0)
+#define DMAC_CHINTFLAG_TCMPL (0x1U << 1)
+#define DMAC_BTCTRL_VALID (0x1U << 0)
+#define DMAC_BTCTRL_BLOCKACT_Msk (0x3U << 3)
+#define DMAC_BTCTRL_BLOCKACT_NOACT (0x0U << 3)
+#define DMAC_BTCTRL_BLOCKACT_INT (0x1U << 3)
+#define DMAC_BTCTRL_BEATSIZE_BYTE (0x0U << 8)
+#define DMAC_BTCTRL_SRCINC (0x1U << 10)
+#define DMAC_BTCTRL_DSTINC (0x1U << 11)
+
+
+// ---------------------------------------------------------------------------
+// Clocks, power manager, NVM controller
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    volatile union { uint8_t reg; } CTRL;
+    volatile union { struct { uint8_t :7; uint8_t SYNCBUSY:1; } bit; uint8_t reg; } STATUS;
+    volatile union { struct { uint16_t ID:6; uint16_t :2; uint16_t GEN:4; uint16_t :2; uint16_t CLKEN:1; uint16_t WRTLOCK:1; } bit; uint16_t reg; } CLKCTRL;
+    volatile union { uint32_t reg; } GENCTRL;
+    volatile union { uint32_t reg; } GENDIV;
+} Gclk;
+
+typedef struct {
+    volatile union { uint32_t reg; } AHBMASK;
+    volatile union { uint32_t reg; } APBAMASK;
+    volatile union { uint32_t reg; } APBBMASK;
+    volatile union { uint32_t reg; } APBCMASK;
+} Pm;
+
+typedef struct {
+    volatile union { uint32_t reg; } CTRLA;
+    volatile union { uint32_t reg; } CTRLB;
+    volatile union { uint8_t reg; } INTFLAG;
+    volatile union { uint16_t reg; } STATUS;
+    volatile union { uint32_t reg; } ADDR;
+} Nvmctrl;
+
+namespace lr::sim {
+extern Gclk gGclk;
+extern Pm gPm;
+extern Nvmctrl gNvmctrl;
+}
+
+#define GCLK (&lr::sim::gGclk)
+#define PM (&lr::sim::gPm)
+#define NVMCTRL (&lr::sim::gNvmctrl)
+
+#define GCLK_STATUS_SYNCBUSY (0x1U << 7)
+#define GCLK_CLKCTRL_ID(value) ((0x3FU & (value)) << 0)
+#define GCLK_CLKCTRL_GEN(value) ((0xFU & (value)) << 8)
+#define GCLK_CLKCTRL_GEN_GCLK0 (0x0U << 8)
+#define GCLK_CLKCTRL_CLKEN (0x1U << 14)
+#define GCLK_CLKCTRL_ID_SERCOM0_CORE_Val 0x14U
+#define GCLK_CLKCTRL_ID_SERCOM1_CORE_Val 0x15U
+#define GCLK_CLKCTRL_ID_SERCOM2_CORE_Val 0x16U
+#define GCLK_CLKCTRL_ID_SERCOM3_CORE_Val 0x17U
+#define GCLK_CLKCTRL_ID_SERCOM4_CORE_Val 0x18U
+#define GCLK_CLKCTRL_ID_SERCOM5_CORE_Val 0x19U
+#define GCLK_CLKCTRL_ID_TCC2_TC3_Val 0x1BU
+#define PM_AHBMASK_DMAC (0x1U << 5)
+#define PM_APBBMASK_DMAC (0x1U << 4)
+#define NVMCTRL_CTRLA_CMD_ER (0x02U << 0)
+#define NVMCTRL_CTRLA_CMDEX_KEY (0xA5U << 8)
+#define NVMCTRL_INTFLAG_READY (0x1U << 0)
+#define NVMCTRL_STATUS_MASK 0x011EU
+
+
+// ---------------------------------------------------------------------------
+// Port
+// ---------------------------------------------------------------------------
+
+namespace lr::sim {
+
+struct PortPmuxBits {
+    RegisterCell *cell;
+    Field8<0, 4> PMUXE{cell};
+    Field8<4, 4> PMUXO{cell};
+};
+
+struct PortPincfgBits {
+    RegisterCell *cell;
+    Field8<0, 1> PMUXEN{cell};
+    Field8<1, 1> INEN{cell};
+    Field8<2, 1> PULLEN{cell};
+    Field8<6, 1> DRVSTR{cell};
+};
+
+}
+
+/// The registers of a port group.
+///
+typedef struct {
+    lr::sim::Register<uint32_t, lr::sim::NoBits> DIR;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> DIRCLR;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> DIRSET;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> DIRTGL;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> OUT;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> OUTCLR;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> OUTSET;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> OUTTGL;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> IN;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> CTRL;
+    lr::sim::Register<uint32_t, lr::sim::NoBits> WRCONFIG;
+    lr::sim::Register<uint8_t, lr::sim::PortPmuxBits> PMUX[16];
+    lr::sim::Register<uint8_t, lr::sim::PortPincfgBits> PINCFG[32];
+} PortGroup;
+
+typedef struct {
+    PortGroup Group[2];
+} Port;
+
+namespace lr::sim {
+extern Port gPort;
+}
+
+#define PORT (&lr::sim::gPort)
+#define PORT_IOBUS (&lr::sim::gPort)
+
+#define PORT_PINCFG_PMUXEN (0x1U << 0)
+#define PORT_PINCFG_INEN (0x1U << 1)
+#define PORT_PINCFG_PULLEN (0x1U << 2)
+#define PORT_PINCFG_DRVSTR (0x1U << 6)
+#define PORT_WRCONFIG_PINMASK(value) ((0xFFFFUL & (value)) << 0)
+#define PORT_WRCONFIG_PMUXEN (0x1UL << 16)
+#define PORT_WRCONFIG_INEN (0x1UL << 17)
+#define PORT_WRCONFIG_PULLEN (0x1UL << 18)
+#define PORT_WRCONFIG_DRVSTR (0x1UL << 22)
+#define PORT_WRCONFIG_PMUX(value) ((0xFUL & (value)) << 24)
+#define PORT_WRCONFIG_WRPMUX (0x1UL << 28)
+#define PORT_WRCONFIG_WRPINCFG (0x1UL << 30)
+#define PORT_WRCONFIG_HWSEL (0x1UL << 31)
+
+
+// ---------------------------------------------------------------------------
+// Interrupt handlers
+// ---------------------------------------------------------------------------
+
+extern "C" {
+void SysTick_Handler();
+void DMAC_Handler();
+void SERCOM0_Handler();
+void SERCOM1_Handler();
+void SERCOM2_Handler();
+void SERCOM3_Handler();
+void SERCOM4_Handler();
+void SERCOM5_Handler();
+}
+
+
+// ---------------------------------------------------------------------------
+// Peripheral instances
+// ---------------------------------------------------------------------------
+
+namespace lr::sim {
+extern Sercom gSercom[6];
+}
+
+namespace lr::chip {
+inline Sercom* const gSercom0 = &lr::sim::gSercom[0];
+inline Sercom* const gSercom1 = &lr::sim::gSercom[1];
+inline Sercom* const gSercom2 = &lr::sim::gSercom[2];
+inline Sercom* const gSercom3 = &lr::sim::gSercom[3];
+inline Sercom* const gSercom4 = &lr::sim::gSercom[4];
+inline Sercom* const gSercom5 = &lr::sim::gSercom[5];
+inline Port* const gPort = &lr::sim::gPort;
+}
+
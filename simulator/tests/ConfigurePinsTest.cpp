@@ -0,0 +1,226 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+
+#include "PortModel.hpp"
+
+#include "GPIO_SAMD21.hpp"
+
+#include <vector>
+
+
+using namespace lr;
+using namespace lr::GPIO;
+using Access = sim::PortModel::Access;
+using Index = sim::PortModel::Index;
+
+
+namespace {
+
+
+/// A pin in the lower half of the port group.
+///
+constexpr uint8_t cLowerPin = 3;
+
+/// A pin in the upper half of the port group.
+///
+constexpr uint8_t cUpperPin = 20;
+
+/// The mask with both pins.
+///
+constexpr uint32_t cMask = (1u << cLowerPin) | (1u << cUpperPin);
+
+
+/// Configure the pins and record the register writes.
+///
+std::vector<Access> configure(uint32_t mask, Mode mode, Pull pull = Pull::None,
+    GPIO::Function function = GPIO::Function::Disabled)
+{
+    auto &port = sim::getPort();
+    port.startRecording();
+    LR_REQUIRE(configurePins(Group::A, mask, mode, pull, function) == GPIO::Status::Success);
+    port.stopRecording();
+    std::vector<Access> writes;
+    for (const auto &access : port.getAccesses()) {
+        if (access.isWrite) {
+            writes.push_back(access);
+        }
+    }
+    return writes;
+}
+
+
+/// Get the position of the first write to a register, or the number of writes.
+///
+std::size_t findWrite(const std::vector<Access> &writes, uint8_t index)
+{
+    for (std::size_t i = 0; i < writes.size(); ++i) {
+        if (writes[i].index == index) {
+            return i;
+        }
+    }
+    return writes.size();
+}
+
+
+/// Count the writes to a register.
+///
+std::size_t countWrites(const std::vector<Access> &writes, uint8_t index)
+{
+    std::size_t count = 0;
+    for (const auto &write : writes) {
+        count += (write.index == index) ? 1 : 0;
+    }
+    return count;
+}
+
+
+/// Get the pin configuration.
+///
+uint8_t getPinConfig(uint8_t pin)
+{
+    return PORT->Group[0].PINCFG[pin].reg;
+}
+
+
+/// Check that both halves of the port group are written with `WRCONFIG`.
+///
+bool isWrittenInBothHalves(const std::vector<Access> &writes)
+{
+    std::vector<uint32_t> values;
+    for (const auto &write : writes) {
+        if (write.index == Index::WRCONFIG) {
+            values.push_back(write.value);
+        }
+    }
+    return values.size() == 2 &&
+        (values[0] & PORT_WRCONFIG_HWSEL) == 0 && (values[0] & 0xffffu) == (1u << cLowerPin) &&
+        (values[1] & PORT_WRCONFIG_HWSEL) != 0 && (values[1] & 0xffffu) == (1u << (cUpperPin - 16));
+}
+
+
+}
+
+
+LR_TEST(inputWithPullUpSetsTheOutputForThePull)
+{
+    const auto writes = configure(cMask, Mode::Input, Pull::Up);
+    LR_REQUIRE(writes.size() == 4);
+    LR_CHECK(writes[0].index == Index::DIRCLR && writes[0].value == cMask);
+    LR_CHECK(writes[1].index == Index::OUTSET && writes[1].value == cMask);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    LR_CHECK(getPinConfig(cLowerPin) == (PORT_PINCFG_INEN|PORT_PINCFG_PULLEN));
+    LR_CHECK(getPinConfig(cUpperPin) == (PORT_PINCFG_INEN|PORT_PINCFG_PULLEN));
+    LR_CHECK((PORT->Group[0].DIR.reg & cMask) == 0);
+    LR_CHECK((PORT->Group[0].OUT.reg & cMask) == cMask);
+}
+
+
+LR_TEST(inputWithPullDownClearsTheOutput)
+{
+    const auto writes = configure(cMask, Mode::Input, Pull::Down);
+    LR_REQUIRE(writes.size() == 4);
+    LR_CHECK(writes[0].index == Index::DIRCLR && writes[0].value == cMask);
+    LR_CHECK(writes[1].index == Index::OUTCLR && writes[1].value == cMask);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    LR_CHECK((PORT->Group[0].OUT.reg & cMask) == 0);
+}
+
+
+LR_TEST(inputWithoutPullKeepsTheOutput)
+{
+    const auto writes = configure(cMask, Mode::Input);
+    LR_REQUIRE(writes.size() == 3);
+    LR_CHECK(writes[0].index == Index::DIRCLR && writes[0].value == cMask);
+    LR_CHECK(countWrites(writes, Index::OUTSET) + countWrites(writes, Index::OUTCLR) == 0);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    LR_CHECK(getPinConfig(cLowerPin) == PORT_PINCFG_INEN);
+}
+
+
+LR_TEST(highImpedanceDisablesTheInput)
+{
+    const auto writes = configure(cMask, Mode::HighImpendance);
+    LR_REQUIRE(writes.size() == 4);
+    LR_CHECK(writes[0].index == Index::DIRCLR && writes[0].value == cMask);
+    LR_CHECK(writes[1].index == Index::OUTCLR && writes[1].value == cMask);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    LR_CHECK(getPinConfig(cLowerPin) == 0);
+    LR_CHECK(getPinConfig(cUpperPin) == 0);
+}
+
+
+LR_TEST(outputsGetTheLevelBeforeTheDirection)
+{
+    configure(cMask, Mode::Input, Pull::Down);
+    auto writes = configure(cMask, Mode::High);
+    LR_REQUIRE(writes.size() == 4);
+    LR_CHECK(writes[0].index == Index::OUTSET && writes[0].value == cMask);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    LR_CHECK(writes[3].index == Index::DIRSET && writes[3].value == cMask);
+    LR_CHECK((PORT->Group[0].OUT.reg & cMask) == cMask);
+    LR_CHECK((PORT->Group[0].DIR.reg & cMask) == cMask);
+    writes = configure(cMask, Mode::Low);
+    LR_REQUIRE(writes.size() == 4);
+    LR_CHECK(writes[0].index == Index::OUTCLR && writes[0].value == cMask);
+    LR_CHECK(findWrite(writes, Index::OUTCLR) < findWrite(writes, Index::DIRSET));
+    LR_CHECK(writes[3].index == Index::DIRSET && writes[3].value == cMask);
+    LR_CHECK((PORT->Group[0].OUT.reg & cMask) == 0);
+    LR_CHECK(getPinConfig(cLowerPin) == 0);
+}
+
+
+LR_TEST(functionIsWrittenToBothHalves)
+{
+    const auto writes = configure(cMask, Mode::Input, Pull::None, GPIO::Function::Sercom);
+    LR_CHECK(isWrittenInBothHalves(writes));
+    const auto function = static_cast<uint8_t>(GPIO::Function::Sercom);
+    LR_CHECK(getPinConfig(cLowerPin) == (PORT_PINCFG_PMUXEN|PORT_PINCFG_INEN));
+    LR_CHECK(getPinConfig(cUpperPin) == (PORT_PINCFG_PMUXEN|PORT_PINCFG_INEN));
+    // PA03 is odd and uses the upper nibble, PA20 is even and uses the lower nibble.
+    LR_CHECK((PORT->Group[0].PMUX[cLowerPin >> 1].reg >> 4u) == function);
+    LR_CHECK((PORT->Group[0].PMUX[cUpperPin >> 1].reg & 0x0fu) == function);
+}
+
+
+LR_TEST(onlyUsedHalvesAreWritten)
+{
+    PORT->Group[0].PINCFG[cLowerPin + 1].reg = PORT_PINCFG_DRVSTR;
+    auto writes = configure(1u << cLowerPin, Mode::Input, Pull::Up);
+    LR_REQUIRE(countWrites(writes, Index::WRCONFIG) == 1);
+    LR_CHECK((writes[findWrite(writes, Index::WRCONFIG)].value & PORT_WRCONFIG_HWSEL) == 0);
+    writes = configure(1u << cUpperPin, Mode::Input, Pull::Up);
+    LR_REQUIRE(countWrites(writes, Index::WRCONFIG) == 1);
+    LR_CHECK((writes[findWrite(writes, Index::WRCONFIG)].value & PORT_WRCONFIG_HWSEL) != 0);
+    // Other pins keep their configuration.
+    LR_CHECK(getPinConfig(cLowerPin + 1) == PORT_PINCFG_DRVSTR);
+}
+
+
+LR_TEST(unknownModeWritesNothing)
+{
+    auto &port = sim::getPort();
+    port.startRecording();
+    LR_CHECK(configurePins(Group::A, cMask, static_cast<Mode>(0x7f)) == GPIO::Status::Error);
+    port.stopRecording();
+    LR_CHECK(port.getAccesses().empty());
+}
+
+
+LR_TEST_MAIN()
+
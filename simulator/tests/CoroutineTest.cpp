@@ -0,0 +1,234 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include "Coroutine_SAMD21.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+using Coroutine::Executor;
+using Coroutine::Task;
+
+
+namespace {
+
+
+/// The results of a coroutine.
+///
+struct Result {
+    bool isDone; ///< If the coroutine returned.
+    Status writeStatus; ///< The status of the write.
+    Status readStatus; ///< The status of the read.
+    sim::Cycles delayCycles; ///< The cycles spent in the delay.
+};
+
+
+/// A serial line which accepts a given number of bytes.
+///
+class TestSerialLine : public SerialLine
+{
+public:
+    DataSize sendBytesAvailable() noexcept override { return available; }
+    Status send(uint8_t data) noexcept override { return send(&data, 1); }
+    Status send(const uint8_t *data, DataSize dataSize, DataSize *dataSent = nullptr) noexcept override {
+        if (dataSize > available) {
+            return Status::Error;
+        }
+        for (DataSize i = 0; i < dataSize; ++i) {
+            sent[sentCount++] = data[i];
+        }
+        available -= dataSize;
+        if (dataSent != nullptr) {
+            *dataSent = dataSize;
+        }
+        return Status::Success;
+    }
+
+public:
+    DataSize available = 0; ///< The number of bytes the line accepts.
+    uint8_t sent[16] = {}; ///< The sent bytes.
+    DataSize sentCount = 0; ///< The number of sent bytes.
+};
+
+
+/// A coroutine parameter, which counts its destruction with the frame.
+///
+struct FrameProbe {
+    explicit FrameProbe(uint32_t &destroyed) : destroyed(&destroyed) {}
+    FrameProbe(FrameProbe &&other) noexcept : destroyed(other.destroyed) { other.destroyed = nullptr; }
+    ~FrameProbe() {
+        if (destroyed != nullptr) {
+            ++(*destroyed);
+        }
+    }
+
+    uint32_t *destroyed; ///< The destruction counter.
+};
+
+
+/// Write a register, wait and read it back.
+///
+Task writeWaitAndRead(Executor &executor, Result &result, uint8_t address, uint8_t *data)
+{
+    result.writeStatus = co_await executor.writeRegisterData(test::WireFixture::get().wire, address, 0x10, data, 4);
+    const auto start = sim::getCycles();
+    co_await executor.delay(Milliseconds(5));
+    result.delayCycles = sim::getCycles() - start;
+    uint8_t readData[4] = {};
+    result.readStatus = co_await executor.readRegisterData(test::WireFixture::get().wire, address, 0x10, readData, 4);
+    for (uint8_t i = 0; i < 4; ++i) {
+        data[i] = readData[i];
+    }
+    result.isDone = true;
+}
+
+
+/// Send a message to a serial line.
+///
+Task sendMessage(Executor &executor, SerialLine &serialLine, bool &isDone)
+{
+    static const uint8_t cMessage[] = {'p', 'i', 'n', 'g'};
+    co_await executor.send(serialLine, cMessage, 4);
+    isDone = true;
+}
+
+
+/// A coroutine which only counts its runs.
+///
+Task countRun(FrameProbe, uint32_t &runs)
+{
+    ++runs;
+    co_return;
+}
+
+
+/// Run the executor like `Executor::run()`, until a flag is set.
+///
+/// @return The number of loops.
+///
+uint32_t runUntil(Executor &executor, const bool &isDone, sim::Cycles maximum = sim::fromMilliseconds(100))
+{
+    const auto end = sim::getCycles() + maximum;
+    uint32_t loops = 0;
+    while (!isDone && sim::getCycles() < end) {
+        ++loops;
+        executor.runOnce();
+        if (!isDone) {
+            __WFI();
+        }
+    }
+    return loops;
+}
+
+
+}
+
+
+LR_TEST(sensorAccessAsStraightLineCode)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    Executor executor;
+    Result result = {};
+    uint8_t data[4] = {0x12, 0x34, 0x56, 0x78};
+    LR_REQUIRE(executor.spawn(writeWaitAndRead(executor, result, 0x40, data)));
+    LR_CHECK(!result.isDone);
+    const auto interrupts = sim::getInterruptCount();
+    const auto loops = runUntil(executor, result.isDone);
+    LR_REQUIRE(result.isDone);
+    LR_CHECK(result.writeStatus == Status::Success);
+    LR_CHECK(result.readStatus == Status::Success);
+    LR_CHECK(device.getRegister(0x13) == 0x78);
+    LR_CHECK(data[0] == 0x12 && data[3] == 0x78);
+    // The delay is measured in ticks of one millisecond.
+    LR_CHECK(result.delayCycles >= sim::fromMilliseconds(4));
+    LR_CHECK(result.delayCycles <= sim::fromMilliseconds(6));
+    // The executor sleeps until the next interrupt, it never busy-waits.
+    LR_CHECK(loops <= sim::getInterruptCount() - interrupts + 1);
+}
+
+
+LR_TEST(failedTransactionsResumeTheCoroutine)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::StuckDevice device(0x40);
+    fixture.prepare({&device});
+    Executor executor;
+    // The missing device is reported with the callback.
+    Result result = {};
+    uint8_t data[4] = {};
+    LR_REQUIRE(executor.spawn(writeWaitAndRead(executor, result, 0x41, data)));
+    runUntil(executor, result.isDone);
+    LR_REQUIRE(result.isDone);
+    LR_CHECK(result.writeStatus == Status::AddressNotFound);
+    LR_CHECK(result.readStatus == Status::AddressNotFound);
+    // A transaction which can not start continues the coroutine directly.
+    sim::runFor(sim::fromMicroseconds(100));
+    device.holdData(9);
+    result = {};
+    LR_REQUIRE(executor.spawn(writeWaitAndRead(executor, result, 0x40, data)));
+    runUntil(executor, result.isDone);
+    LR_REQUIRE(result.isDone);
+    LR_CHECK(result.writeStatus == Status::Timeout);
+    LR_CHECK(result.readStatus == Status::Timeout);
+    LR_CHECK(fixture.wire.recoverBus() == Status::Success);
+}
+
+
+LR_TEST(sendWaitsForTheSerialLine)
+{
+    Executor executor;
+    TestSerialLine serialLine;
+    bool isDone = false;
+    LR_REQUIRE(executor.spawn(sendMessage(executor, serialLine, isDone)));
+    executor.runOnce();
+    executor.runOnce();
+    LR_CHECK(!isDone);
+    LR_CHECK(serialLine.sentCount == 0);
+    serialLine.available = 8;
+    executor.runOnce();
+    LR_CHECK(isDone);
+    LR_CHECK(serialLine.sentCount == 4);
+    LR_CHECK(serialLine.sent[0] == 'p' && serialLine.sent[3] == 'g');
+}
+
+
+LR_TEST(spawnDestroysTheFrameIfTheQueueIsFull)
+{
+    Executor executor;
+    uint32_t destroyed = 0;
+    uint32_t runs = 0;
+    for (uint8_t i = 0; i < Executor::cReadySize; ++i) {
+        LR_REQUIRE(executor.spawn(countRun(FrameProbe(destroyed), runs)));
+    }
+    LR_CHECK(destroyed == 0);
+    LR_CHECK(!executor.spawn(countRun(FrameProbe(destroyed), runs)));
+    LR_CHECK(destroyed == 1);
+    executor.runOnce();
+    LR_CHECK(runs == Executor::cReadySize);
+    LR_CHECK(destroyed == Executor::cReadySize + 1);
+}
+
+
+LR_TEST_MAIN()
+
@@ -0,0 +1,220 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+
+#include "PortModel.hpp"
+#include "Simulator.hpp"
+
+#include "Debouncer_SAMD21.hpp"
+#include "VerticalDebouncer.hpp"
+
+#include <initializer_list>
+
+
+using namespace lr;
+using GPIO::Group;
+using GPIO::Port;
+
+
+namespace {
+
+
+/// The mask of PA16.
+///
+constexpr uint32_t cPA16 = GPIO::getMask(Port::PA16);
+
+/// The mask of PA17.
+///
+constexpr uint32_t cPA17 = GPIO::getMask(Port::PA17);
+
+/// The mask of PB08.
+///
+constexpr uint32_t cPB08 = GPIO::getMask(Port::PB08);
+
+
+/// Feed a trace of samples into a vertical debouncer.
+///
+/// @return The debounced state after the last sample.
+///
+uint32_t debounceTrace(std::initializer_list<uint32_t> samples, std::size_t count)
+{
+    VerticalDebouncer debouncer;
+    for (auto it = samples.begin(); it != samples.begin() + count; ++it) {
+        debouncer.update(*it);
+    }
+    return debouncer.getState();
+}
+
+
+/// Drive the levels of pins for one SysTick each.
+///
+/// @param group The port group.
+/// @param mask The driven pins.
+/// @param levels One level for each tick, `true` drives the pins high.
+///
+void feed(Group group, uint32_t mask, std::initializer_list<bool> levels)
+{
+    for (const auto level : levels) {
+        sim::getPort().setInputLevels(static_cast<uint8_t>(group), mask, level ? mask : 0);
+        sim::runFor(sim::fromMilliseconds(1));
+    }
+}
+
+
+/// Stop debouncing and release the pins after a test.
+///
+void clearInputs()
+{
+    Debouncer::setInputs(Group::A, 0);
+    Debouncer::setInputs(Group::B, 0);
+    Debouncer::setSampleDivider(1);
+    sim::getPort().releaseInputs();
+}
+
+
+}
+
+
+LR_TEST(verticalCountersNeedFourEqualSamples)
+{
+    // A stable input after bouncing.
+    LR_CHECK(debounceTrace({1, 0, 1, 1, 0, 1, 1, 1, 1}, 9) == 1);
+    LR_CHECK(debounceTrace({1, 0, 1, 1, 0, 1, 1, 1, 1}, 8) == 0);
+    // Bounces which are shorter than four samples.
+    LR_CHECK(debounceTrace({1, 0, 1, 1, 1, 0, 1, 0, 0}, 9) == 0);
+    // A press followed by a bouncing release.
+    LR_CHECK(debounceTrace({1, 1, 1, 1, 0, 1, 0, 0, 0, 0}, 4) == 1);
+    LR_CHECK(debounceTrace({1, 1, 1, 1, 0, 1, 0, 0, 0, 0}, 9) == 1);
+    LR_CHECK(debounceTrace({1, 1, 1, 1, 0, 1, 0, 0, 0, 0}, 10) == 0);
+    // Independent inputs in one word.
+    LR_CHECK(debounceTrace({0x3, 0x1, 0x3, 0x1, 0x1, 0x1, 0x1, 0x80000001u}, 8) == 0x1);
+}
+
+
+LR_TEST(bouncingInputPublishesOnePressAndRelease)
+{
+    sim::getPort().setInputLevels(0, cPA16, 0);
+    Debouncer::setInputs(Group::A, cPA16);
+    Debouncer::EventReader events;
+    feed(Group::A, cPA16, {true, false, true, true, false, true, true, true});
+    events.update();
+    LR_CHECK(events.getPressed(Group::A) == 0);
+    LR_CHECK(!events.isActive(Port::PA16));
+    feed(Group::A, cPA16, {true});
+    events.update();
+    LR_CHECK(events.getPressed(Group::A) == cPA16);
+    LR_CHECK(events.getReleased(Group::A) == 0);
+    LR_CHECK(events.isActive(Port::PA16));
+    // No new events without a change.
+    feed(Group::A, cPA16, {true, true});
+    events.update();
+    LR_CHECK(!events.isPressed(Port::PA16));
+    feed(Group::A, cPA16, {false, true, false, false, false, false});
+    events.update();
+    LR_CHECK(events.getReleased(Group::A) == cPA16);
+    LR_CHECK(events.getPressed(Group::A) == 0);
+    LR_CHECK(!events.isActive(Port::PA16));
+    clearInputs();
+}
+
+
+LR_TEST(activeLowInputsAreInverted)
+{
+    sim::getPort().setInputLevels(0, cPA16 | cPA17, cPA16 | cPA17);
+    Debouncer::setInputs(Group::A, cPA16 | cPA17, cPA17);
+    Debouncer::EventReader events;
+    // The high active-low input is inactive, the high active-high input is active.
+    LR_CHECK(events.getState(Group::A) == cPA16);
+    feed(Group::A, cPA17, {false, false, false, false});
+    events.update();
+    LR_CHECK(events.getPressed(Group::A) == cPA17);
+    LR_CHECK(events.getState(Group::A) == (cPA16 | cPA17));
+    clearInputs();
+}
+
+
+LR_TEST(bothPortGroupsAreSampledInOneTick)
+{
+    sim::getPort().setInputLevels(0, cPA16, 0);
+    sim::getPort().setInputLevels(1, cPB08, 0);
+    Debouncer::setInputs(Group::A, cPA16);
+    Debouncer::setInputs(Group::B, cPB08);
+    Debouncer::EventReader events;
+    const auto before = Debouncer::getSnapshot();
+    for (uint8_t i = 0; i < 4; ++i) {
+        sim::getPort().setInputLevels(0, cPA16, cPA16);
+        sim::getPort().setInputLevels(1, cPB08, cPB08);
+        sim::runFor(sim::fromMilliseconds(1));
+    }
+    const auto after = Debouncer::getSnapshot();
+    // Both changes are published with one update of the sequence.
+    LR_CHECK((after.sequence & 1u) == 0);
+    LR_CHECK(after.sequence == before.sequence + 2);
+    LR_CHECK(after.state[0] == cPA16);
+    LR_CHECK(after.state[1] == cPB08);
+    events.update();
+    LR_CHECK(events.isPressed(Port::PA16));
+    LR_CHECK(events.isPressed(Port::PB08));
+    clearInputs();
+}
+
+
+LR_TEST(sampleDividerStretchesTheInterval)
+{
+    sim::getPort().setInputLevels(0, cPA16, 0);
+    Debouncer::setInputs(Group::A, cPA16);
+    Debouncer::setSampleDivider(3);
+    Debouncer::EventReader events;
+    sim::getPort().setInputLevels(0, cPA16, cPA16);
+    sim::runFor(sim::fromMilliseconds(11));
+    events.update();
+    LR_CHECK(!events.isActive(Port::PA16));
+    sim::runFor(sim::fromMilliseconds(1));
+    events.update();
+    LR_CHECK(events.isPressed(Port::PA16));
+    clearInputs();
+}
+
+
+LR_TEST(readerFasterThanEightSamplesSeesEveryPress)
+{
+    sim::getPort().setInputLevels(0, cPA16, 0);
+    Debouncer::setInputs(Group::A, cPA16);
+    Debouncer::EventReader events;
+    uint32_t presses = 0;
+    uint32_t releases = 0;
+    for (uint8_t sample = 1; sample <= 64; ++sample) {
+        // The shortest possible press and release, four samples each.
+        feed(Group::A, cPA16, {((sample - 1) / 4) % 2 == 0});
+        if (sample % 7 == 0) {
+            events.update();
+            presses += events.isPressed(Port::PA16) ? 1 : 0;
+            releases += events.isReleased(Port::PA16) ? 1 : 0;
+        }
+    }
+    events.update();
+    presses += events.isPressed(Port::PA16) ? 1 : 0;
+    releases += events.isReleased(Port::PA16) ? 1 : 0;
+    LR_CHECK(presses == 8);
+    LR_CHECK(releases == 8);
+    clearInputs();
+}
+
+
+LR_TEST_MAIN()
+
@@ -0,0 +1,140 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+
+#include "PortModel.hpp"
+
+#include "GPIO_PinGroup_SAMD21.hpp"
+
+#include <vector>
+
+
+using namespace lr;
+using namespace lr::GPIO;
+using Access = sim::PortModel::Access;
+
+
+namespace {
+
+
+/// Four consecutive pins, written with a shift.
+///
+using ShiftGroup = PinGroup<PinPA16, PinPA17, PinPA18, PinPA19>;
+
+/// Pins in both port groups, written with spread masks.
+///
+using SpreadGroup = PinGroup<PinPB08, PinPA05, PinPA17>;
+
+
+/// Record the register accesses of a function.
+///
+template<typename Function>
+std::vector<Access> record(Function function)
+{
+    auto &port = sim::getPort();
+    port.startRecording();
+    function();
+    port.stopRecording();
+    return port.getAccesses();
+}
+
+
+/// Check an access.
+///
+bool isAccess(const Access &access, bool isWrite, uint8_t group, uint8_t index, uint32_t value)
+{
+    return access.isWrite == isWrite && access.group == group && access.index == index && access.value == value;
+}
+
+
+/// Get the output register of a port group.
+///
+uint32_t getOutput(uint8_t group)
+{
+    return PORT->Group[group].OUT.reg;
+}
+
+
+}
+
+
+LR_TEST(writeSetsAndClearsWithoutReadingTheOutput)
+{
+    ShiftGroup::setOutputLow();
+    const auto accesses = record([] { ShiftGroup::write(0x0a); });
+    LR_REQUIRE(accesses.size() == 2);
+    LR_CHECK(isAccess(accesses[0], true, 0, sim::PortModel::OUTSET, 0x0au << 16u));
+    LR_CHECK(isAccess(accesses[1], true, 0, sim::PortModel::OUTCLR, 0x05u << 16u));
+    LR_CHECK(((getOutput(0) >> 16u) & 0xfu) == 0x0a);
+}
+
+
+LR_TEST(writeSpreadsTheBitsOverBothPortGroups)
+{
+    SpreadGroup::setOutputLow();
+    auto accesses = record([] { SpreadGroup::write(0b101); });
+    LR_REQUIRE(accesses.size() == 4);
+    LR_CHECK(isAccess(accesses[0], true, 0, sim::PortModel::OUTSET, 1u << 17u));
+    LR_CHECK(isAccess(accesses[1], true, 0, sim::PortModel::OUTCLR, 1u << 5u));
+    LR_CHECK(isAccess(accesses[2], true, 1, sim::PortModel::OUTSET, 1u << 8u));
+    LR_CHECK(isAccess(accesses[3], true, 1, sim::PortModel::OUTCLR, 0));
+    // The lookup table writes the same masks.
+    const auto tableAccesses = record([] { SpreadGroup::writeFromTable(0b101); });
+    LR_REQUIRE(tableAccesses.size() == accesses.size());
+    for (std::size_t i = 0; i < accesses.size(); ++i) {
+        LR_CHECK(isAccess(tableAccesses[i], true, accesses[i].group, accesses[i].index, accesses[i].value));
+    }
+    LR_CHECK((getOutput(0) & ((1u << 17u) | (1u << 5u))) == (1u << 17u));
+    LR_CHECK((getOutput(1) & (1u << 8u)) != 0);
+}
+
+
+LR_TEST(writeGlitchFreeTogglesTheChangedBits)
+{
+    ShiftGroup::configureAsOutput();
+    ShiftGroup::write(0x3);
+    PinPA20::setOutputHigh();
+    const auto accesses = record([] { ShiftGroup::writeGlitchFree(0x6); });
+    LR_REQUIRE(accesses.size() == 2);
+    LR_CHECK(!accesses[0].isWrite);
+    LR_CHECK(accesses[0].index == sim::PortModel::OUT);
+    LR_CHECK(isAccess(accesses[1], true, 0, sim::PortModel::OUTTGL, 0x5u << 16u));
+    LR_CHECK(((getOutput(0) >> 16u) & 0xfu) == 0x6);
+    // Pins outside of the group keep their value.
+    LR_CHECK((getOutput(0) & (1u << 20u)) != 0);
+    // The outputs read back as inputs.
+    LR_CHECK(ShiftGroup::read() == 0x6);
+}
+
+
+LR_TEST(setClearAndToggleAreOneWritePerPortGroup)
+{
+    auto accesses = record([] { SpreadGroup::setOutputHigh(); });
+    LR_REQUIRE(accesses.size() == 2);
+    LR_CHECK(isAccess(accesses[0], true, 0, sim::PortModel::OUTSET, (1u << 17u) | (1u << 5u)));
+    LR_CHECK(isAccess(accesses[1], true, 1, sim::PortModel::OUTSET, 1u << 8u));
+    accesses = record([] { SpreadGroup::toggleOutput(); });
+    LR_REQUIRE(accesses.size() == 2);
+    LR_CHECK(isAccess(accesses[0], true, 0, sim::PortModel::OUTTGL, (1u << 17u) | (1u << 5u)));
+    LR_CHECK(isAccess(accesses[1], true, 1, sim::PortModel::OUTTGL, 1u << 8u));
+    LR_CHECK((getOutput(0) & ((1u << 17u) | (1u << 5u))) == 0);
+}
+
+
+LR_TEST_MAIN()
+
@@ -0,0 +1,213 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include "SmBusPec.hpp"
+
+#include <vector>
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+using Protocol = sim::SmBusDevice::Protocol;
+
+
+namespace {
+
+
+/// The address of a smart battery, 0x16 for a write and 0x17 for a read.
+///
+constexpr uint8_t cAddress = 0x0b;
+
+/// The command for the word tests.
+///
+constexpr uint8_t cWordCommand = 0x09;
+
+/// The command for the block tests.
+///
+constexpr uint8_t cBlockCommand = 0x20;
+
+/// The command for the process call.
+///
+constexpr uint8_t cProcessCommand = 0x30;
+
+
+/// Create a device with all commands.
+///
+sim::SmBusDevice createDevice(bool usePec) {
+    sim::SmBusDevice device(cAddress);
+    device.addCommand(cWordCommand, Protocol::Word);
+    device.addCommand(cBlockCommand, Protocol::Block);
+    device.addCommand(cProcessCommand, Protocol::ProcessCall);
+    device.setPecEnabled(usePec);
+    return device;
+}
+
+
+}
+
+
+// The check value of CRC-8/SMBUS in the catalogue of parametrised CRC algorithms is 0xf4.
+// The transaction vectors below are calculated with this CRC over all bytes, including
+// the address bytes.
+LR_TEST(pecMatchesTheCatalogueCheckValue)
+{
+    const std::vector<uint8_t> digits = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    LR_CHECK(SmBusPec::calculate(digits.data(), static_cast<uint16_t>(digits.size())) == 0xf4);
+    LR_CHECK(sim::SmBusDevice::calculatePec(digits) == 0xf4);
+    // A message followed by its PEC results in zero.
+    auto message = digits;
+    message.push_back(0xf4);
+    LR_CHECK(SmBusPec::calculate(message.data(), static_cast<uint16_t>(message.size())) == 0);
+}
+
+
+LR_TEST(writeWordSendsThePec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    LR_CHECK(fixture.wire.smBusWriteWord(cAddress, cWordCommand, 0x1234, true) == Status::Success);
+    // 0x16 0x09 0x34 0x12 -> PEC 0xfa
+    LR_CHECK(device.getWritten() == std::vector<uint8_t>({cWordCommand, 0x34, 0x12, 0xfa}));
+    LR_CHECK(device.getWord(cWordCommand) == 0x1234);
+    LR_CHECK(device.getErrorCount() == 0);
+    // Without PEC.
+    device.setPecEnabled(false);
+    LR_CHECK(fixture.wire.smBusWriteWord(cAddress, cWordCommand, 0xabcd) == Status::Success);
+    LR_CHECK(device.getWritten() == std::vector<uint8_t>({cWordCommand, 0xcd, 0xab}));
+    LR_CHECK(device.getWord(cWordCommand) == 0xabcd);
+}
+
+
+LR_TEST(readWordChecksThePec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    device.setWord(cWordCommand, 0x3a98);
+    uint16_t value = 0;
+    LR_CHECK(fixture.wire.smBusReadWord(cAddress, cWordCommand, value, true) == Status::Success);
+    LR_CHECK(value == 0x3a98);
+    // 0x16 0x09 0x17 0x98 0x3a -> PEC 0x84
+    LR_CHECK(device.getResponse() == std::vector<uint8_t>({0x98, 0x3a, 0x84}));
+    // Without PEC.
+    device.setPecEnabled(false);
+    value = 0;
+    LR_CHECK(fixture.wire.smBusReadWord(cAddress, cWordCommand, value) == Status::Success);
+    LR_CHECK(value == 0x3a98);
+}
+
+
+LR_TEST(blockWriteSendsThePec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    const uint8_t data[] = {'A', 'B', 'C'};
+    LR_CHECK(fixture.wire.smBusBlockWrite(cAddress, cBlockCommand, data, 3, true) == Status::Success);
+    // 0x16 0x20 0x03 0x41 0x42 0x43 -> PEC 0x64
+    LR_CHECK(device.getWritten() == std::vector<uint8_t>({cBlockCommand, 0x03, 'A', 'B', 'C', 0x64}));
+    LR_CHECK(device.getBlock(cBlockCommand) == std::vector<uint8_t>({'A', 'B', 'C'}));
+    LR_CHECK(device.getErrorCount() == 0);
+}
+
+
+LR_TEST(blockReadChecksThePec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    device.addCommand(0x21, Protocol::Block);
+    device.setBlock(0x21, {'L', 'R'});
+    uint8_t data[32] = {};
+    uint8_t count = sizeof(data);
+    LR_CHECK(fixture.wire.smBusBlockRead(cAddress, 0x21, data, count, true) == Status::Success);
+    LR_CHECK(count == 2);
+    LR_CHECK(data[0] == 'L' && data[1] == 'R');
+    // 0x16 0x21 0x17 0x02 0x4c 0x52 -> PEC 0xa3
+    LR_CHECK(device.getResponse() == std::vector<uint8_t>({0x02, 'L', 'R', 0xa3}));
+    // A block larger than the buffer is an error.
+    count = 1;
+    LR_CHECK(fixture.wire.smBusBlockRead(cAddress, 0x21, data, count, true) == Status::Error);
+    LR_CHECK(count == 1);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(processCallChecksThePec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    device.setWord(cProcessCommand, 0xbeef);
+    uint16_t result = 0;
+    LR_CHECK(fixture.wire.smBusProcessCall(cAddress, cProcessCommand, 0x1234, result, true) == Status::Success);
+    LR_CHECK(result == 0xbeef);
+    LR_CHECK(device.getWord(cProcessCommand) == 0x1234);
+    // No PEC after the written word, one PEC over the whole transaction.
+    LR_CHECK(device.getWritten() == std::vector<uint8_t>({cProcessCommand, 0x34, 0x12}));
+    // 0x16 0x30 0x34 0x12 0x17 0xef 0xbe -> PEC 0x2f
+    LR_CHECK(device.getResponse() == std::vector<uint8_t>({0xef, 0xbe, 0x2f}));
+}
+
+
+LR_TEST(pecMismatchIsAnError)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    device.setWord(cWordCommand, 0x3a98);
+    device.setWord(cProcessCommand, 0xbeef);
+    device.setBlock(cBlockCommand, {1, 2, 3});
+    device.setCorruptPec(true);
+    uint16_t value = 0;
+    LR_CHECK(fixture.wire.smBusReadWord(cAddress, cWordCommand, value, true) == Status::Error);
+    uint8_t data[32] = {};
+    uint8_t count = sizeof(data);
+    LR_CHECK(fixture.wire.smBusBlockRead(cAddress, cBlockCommand, data, count, true) == Status::Error);
+    LR_CHECK(count == sizeof(data));
+    LR_CHECK(fixture.wire.smBusProcessCall(cAddress, cProcessCommand, 0x1234, value, true) == Status::Error);
+    // The transactions are complete, the next one succeeds.
+    device.setCorruptPec(false);
+    LR_CHECK(fixture.wire.smBusReadWord(cAddress, cWordCommand, value, true) == Status::Success);
+    LR_CHECK(value == 0x3a98);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(deviceDiscardsAWriteWithAWrongPec)
+{
+    auto &fixture = test::WireFixture::get();
+    auto device = createDevice(true);
+    fixture.prepare({&device});
+    device.setWord(cWordCommand, 0x1111);
+    const uint8_t message[] = {cWordCommand, 0x34, 0x12, 0xfb};
+    LR_CHECK(fixture.wire.writeBytes(cAddress, message, 4) == Status::Success);
+    LR_CHECK(device.getErrorCount() == 1);
+    LR_CHECK(device.getWord(cWordCommand) == 0x1111);
+}
+
+
+LR_TEST_MAIN()
+
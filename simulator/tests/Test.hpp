@@ -0,0 +1,125 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+
+/// A minimal test framework for the simulator tests.
+///
+/// Each test file is one executable. Tests register with `LR_TEST` and run in the order of
+/// their definition, `LR_CHECK` records a failure and continues, `LR_REQUIRE` ends the test.
+///
+namespace lr::test {
+
+
+/// A registered test.
+///
+struct TestCase {
+    const char *name; ///< The name of the test.
+    void (*function)(); ///< The test function.
+};
+
+/// Access the list of the registered tests.
+///
+inline std::vector<TestCase>& getTests() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+/// The number of failed checks in the current test.
+///
+inline uint32_t& getFailureCount() {
+    static uint32_t failureCount = 0;
+    return failureCount;
+}
+
+/// Register a test.
+///
+struct Registration {
+    Registration(const char *name, void (*function)()) {
+        getTests().push_back(TestCase{name, function});
+    }
+};
+
+/// Exception to end a test after a failed requirement.
+///
+struct RequirementFailed {};
+
+/// Record a failed check.
+///
+inline void fail(const char *file, int line, const char *expression) {
+    std::printf("  %s:%d: check failed: %s\n", file, line, expression);
+    ++getFailureCount();
+}
+
+/// Run all registered tests.
+///
+/// @return The exit code for the test driver.
+///
+inline int runAll() {
+    uint32_t failedTests = 0;
+    for (const auto &test : getTests()) {
+        std::printf("[ RUN  ] %s\n", test.name);
+        getFailureCount() = 0;
+        try {
+            test.function();
+        } catch (const RequirementFailed&) {
+            // Already recorded.
+        }
+        if (getFailureCount() > 0) {
+            ++failedTests;
+            std::printf("[ FAIL ] %s\n", test.name);
+        } else {
+            std::printf("[  OK  ] %s\n", test.name);
+        }
+    }
+    std::printf("%u of %u tests failed.\n", static_cast<unsigned>(failedTests), static_cast<unsigned>(getTests().size()));
+    return (failedTests == 0) ? 0 : 1;
+}
+
+
+}
+
+
+/// Define a test.
+///
+#define LR_TEST(name) \
+    static void name(); \
+    static const lr::test::Registration name##Registration(#name, &name); \
+    static void name()
+
+/// Check a condition and continue on failure.
+///
+#define LR_CHECK(expression) \
+    do { if (!(expression)) { lr::test::fail(__FILE__, __LINE__, #expression); } } while (false)
+
+/// Check a condition and end the test on failure.
+///
+#define LR_REQUIRE(expression) \
+    do { if (!(expression)) { lr::test::fail(__FILE__, __LINE__, #expression); throw lr::test::RequirementFailed(); } } while (false)
+
+/// The main function of a test executable.
+///
+#define LR_TEST_MAIN() \
+    int main() { return lr::test::runAll(); }
+
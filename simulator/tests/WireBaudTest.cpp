@@ -0,0 +1,224 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include "WireBaud_SAMD21.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+using Speed = WireMaster::Speed;
+
+
+namespace {
+
+
+/// A generic clock generator with its frequency.
+///
+struct ClockSource {
+    uint8_t generator; ///< The generic clock generator.
+    uint32_t frequencyHz; ///< The frequency of the generator.
+};
+
+/// The tested clock sources: DFLL48M, OSC8M, OSC32K and OSC8M divided by 8.
+///
+constexpr ClockSource cClockSources[] = {{0, 48000000}, {3, 8000000}, {1, 32768}, {4, 1000000}};
+
+/// The tested speeds with their frequencies.
+///
+constexpr struct {
+    Speed speed;
+    uint32_t frequencyHz;
+} cSpeeds[] = {
+    {Speed::Standard, 100000}, {Speed::Fast, 400000}, {Speed::FastPlus, 1000000}, {Speed::HighSpeed, 3400000}
+};
+
+/// The tested rise times in nanoseconds.
+///
+constexpr uint32_t cRiseTimes[] = {0, 90, 300, 1000};
+
+/// The fixed cycles of the standard, fast and fast-plus mode.
+///
+constexpr uint32_t cFixedCycles = 10;
+
+/// The fixed cycles of the high-speed mode.
+///
+constexpr uint32_t cHighSpeedFixedCycles = 2;
+
+
+/// Check a result of the baud calculation.
+///
+/// @param result The result to check.
+/// @param clockHz The frequency of the generic clock.
+/// @param targetHz The target SCL frequency.
+/// @param fixedCycles The cycles of the period, which are not set by the baud values.
+/// @return `true` if the result is valid and within all bounds.
+///
+bool isWithinBounds(const WireBaud::Result &result, uint32_t clockHz, uint32_t targetHz, uint32_t fixedCycles) {
+    if (!result.isValid) {
+        return false;
+    }
+    // Both fields have eight bits, the low time gets the larger half.
+    const uint32_t sum = static_cast<uint32_t>(result.baud) + result.baudLow;
+    if (sum > 510 || result.baudLow < result.baud || result.baudLow - result.baud > 1) {
+        return false;
+    }
+    // The achieved frequency matches the baud values and never exceeds the target.
+    const uint32_t periodCycles = fixedCycles + sum;
+    if (result.frequencyHz != clockHz / periodCycles || result.frequencyHz > targetHz) {
+        return false;
+    }
+    // One cycle less would exceed the target, so the error is below one clock cycle per period.
+    if (sum > 0 && static_cast<uint64_t>(targetHz) * (periodCycles - 1) >= clockHz) {
+        return false;
+    }
+    const auto expectedPpm = (static_cast<int64_t>(result.frequencyHz) - targetHz) * 1000000 / targetHz;
+    const double maximumPpm = 1e6 * targetHz / (static_cast<double>(clockHz) + targetHz) + 1e6 / targetHz + 1.0;
+    return result.errorPpm == expectedPpm && result.errorPpm <= 0 && -result.errorPpm <= maximumPpm;
+}
+
+
+/// Check if the solver must find a solution.
+///
+/// A solution exists if the period of the target frequency is at least the fixed cycles
+/// and at most the fixed cycles plus the largest sum of the baud values.
+///
+bool hasSolution(uint32_t clockHz, uint32_t targetHz, uint32_t fixedCycles) {
+    if (targetHz > clockHz) {
+        return false;
+    }
+    const uint32_t periodCycles = (clockHz + targetHz - 1) / targetHz;
+    return periodCycles >= fixedCycles && periodCycles <= fixedCycles + 510;
+}
+
+
+/// Get the rise time in clock cycles.
+///
+uint32_t getRiseCycles(uint32_t clockHz, uint32_t riseTimeNs) {
+    return static_cast<uint32_t>(static_cast<uint64_t>(clockHz) * riseTimeNs / 1000000000ull);
+}
+
+
+}
+
+
+LR_TEST(solverStaysWithinTheBounds)
+{
+    for (const auto &source : cClockSources) {
+        for (const auto &speed : cSpeeds) {
+            for (const auto riseTimeNs : cRiseTimes) {
+                const auto clockHz = source.frequencyHz;
+                if (speed.speed == Speed::HighSpeed) {
+                    const auto result = WireBaud::calculateHighSpeed(clockHz, speed.frequencyHz);
+                    LR_CHECK(result.isValid == hasSolution(clockHz, speed.frequencyHz, cHighSpeedFixedCycles));
+                    if (result.isValid) {
+                        LR_CHECK(isWithinBounds(result, clockHz, speed.frequencyHz, cHighSpeedFixedCycles));
+                    }
+                    continue;
+                }
+                const auto fixedCycles = cFixedCycles + getRiseCycles(clockHz, riseTimeNs);
+                const auto result = WireBaud::calculate(clockHz, speed.frequencyHz, riseTimeNs);
+                LR_CHECK(result.isValid == hasSolution(clockHz, speed.frequencyHz, fixedCycles));
+                if (result.isValid) {
+                    LR_CHECK(isWithinBounds(result, clockHz, speed.frequencyHz, fixedCycles));
+                }
+            }
+        }
+    }
+}
+
+
+LR_TEST(slowClocksOnlyReachSlowSpeeds)
+{
+    // 48MHz reaches all speeds.
+    LR_CHECK(WireBaud::calculate(48000000, 1000000, 300).isValid);
+    LR_CHECK(WireBaud::calculateHighSpeed(48000000, 3400000).isValid);
+    // 8MHz has no room for fast-plus mode with the fixed cycles.
+    LR_CHECK(WireBaud::calculate(8000000, 400000, 300).isValid);
+    LR_CHECK(!WireBaud::calculate(8000000, 1000000, 0).isValid);
+    // 1MHz only reaches standard mode, without rise time.
+    LR_CHECK(WireBaud::calculate(1000000, 100000, 0).isValid);
+    LR_CHECK(!WireBaud::calculate(1000000, 100000, 1000).isValid);
+    LR_CHECK(!WireBaud::calculate(1000000, 400000, 0).isValid);
+    // 32kHz reaches no speed at all.
+    for (const auto &speed : cSpeeds) {
+        LR_CHECK(!WireBaud::calculate(32768, speed.frequencyHz, 0).isValid);
+    }
+}
+
+
+LR_TEST(clockSourceIsUsedEndToEnd)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    auto sercom = WireMaster_SAMD21::getSercom(test::cInterface);
+    for (const auto &source : cClockSources) {
+        WireMaster_SAMD21 wire(test::cInterface, test::cPinSDA, test::cPinSCL);
+        LR_REQUIRE(wire.setClockSource(source.generator, source.frequencyHz) == Status::Success);
+        // The default is standard mode with 90ns rise time.
+        const bool isDefaultValid = WireBaud::calculate(source.frequencyHz, 100000, 90).isValid;
+        LR_CHECK(wire.initialize() == (isDefaultValid ? Status::Success : Status::Error));
+        LR_CHECK(GCLK->CLKCTRL.bit.GEN == source.generator);
+        LR_CHECK(GCLK->CLKCTRL.bit.ID == GCLK_CLKCTRL_ID_SERCOM3_CORE_Val);
+        for (const auto &speed : cSpeeds) {
+            for (const auto riseTimeNs : cRiseTimes) {
+                const bool isHighSpeed = (speed.speed == Speed::HighSpeed);
+                // The master code in high-speed mode is sent in fast mode.
+                const auto result = WireBaud::calculate(source.frequencyHz,
+                    isHighSpeed ? 400000 : speed.frequencyHz, riseTimeNs);
+                const auto highSpeedResult = WireBaud::calculateHighSpeed(source.frequencyHz, speed.frequencyHz);
+                const bool isValid = result.isValid && (!isHighSpeed || highSpeedResult.isValid);
+                const uint32_t previousBaud = sercom->I2CM.BAUD.reg;
+                const auto status = wire.setSpeed(speed.speed, Nanoseconds(riseTimeNs));
+                LR_CHECK(status == (isValid ? Status::Success : Status::Error));
+                if (!isValid) {
+                    // The interface is not touched.
+                    LR_CHECK(sercom->I2CM.BAUD.reg == previousBaud);
+                    continue;
+                }
+                uint32_t expectedBaud = SERCOM_I2CM_BAUD_BAUD(result.baud)|SERCOM_I2CM_BAUD_BAUDLOW(result.baudLow);
+                if (isHighSpeed) {
+                    expectedBaud |= SERCOM_I2CM_BAUD_HSBAUD(highSpeedResult.baud)|
+                        SERCOM_I2CM_BAUD_HSBAUDLOW(highSpeedResult.baudLow);
+                }
+                LR_CHECK(sercom->I2CM.BAUD.reg == expectedBaud);
+                const auto &baudResult = wire.getBaudResult();
+                LR_CHECK(baudResult.frequencyHz == (isHighSpeed ? highSpeedResult : result).frequencyHz);
+                LR_CHECK(baudResult.frequencyHz <= speed.frequencyHz);
+                // A transfer with the new settings.
+                LR_CHECK(wire.writeRegisterData(0x40, 0x10, 0xa5) == Status::Success);
+                uint8_t value = 0;
+                LR_CHECK(wire.readRegisterData(0x40, 0x10, &value, 1) == Status::Success);
+                LR_CHECK(value == 0xa5);
+            }
+        }
+    }
+    // Invalid parameters.
+    LR_CHECK(fixture.wire.setClockSource(9, 48000000) == Status::Error);
+    LR_CHECK(fixture.wire.setClockSource(0, 0) == Status::Error);
+    // Restore the interface for the shared driver.
+    LR_CHECK(fixture.wire.initialize() == Status::Success);
+}
+
+
+LR_TEST_MAIN()
+
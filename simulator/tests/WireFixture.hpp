@@ -0,0 +1,103 @@
+#pragma once
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+
+
+#include "I2cBus.hpp"
+#include "I2cMasterModel.hpp"
+#include "PortModel.hpp"
+#include "Simulator.hpp"
+
+#include "WireMaster_SAMD21.hpp"
+
+
+namespace lr::test {
+
+
+/// The SERCOM interface used by the tests.
+///
+constexpr auto cInterface = WireMaster_SAMD21::Interface::SerCom3;
+
+/// The SDA pin, PA22.
+///
+constexpr GPIO::PinNumber cPinSDA = 22;
+
+/// The SCL pin, PA23.
+///
+constexpr GPIO::PinNumber cPinSCL = 23;
+
+
+/// A driver, connected to a simulated bus.
+///
+/// The driver, the bus and the chip are shared by all tests of an executable. Call
+/// `prepare()` at the start of each test, to remove the devices of the last test and to
+/// reset the interface.
+///
+class WireFixture
+{
+public:
+    /// Access the shared fixture, initialized at the first call.
+    ///
+    static WireFixture& get() {
+        static WireFixture fixture;
+        return fixture;
+    }
+
+public:
+    /// Prepare a test with the given devices.
+    ///
+    /// @param devices The devices to attach to the bus.
+    ///
+    void prepare(std::initializer_list<sim::I2cDevice*> devices) {
+        for (auto device : _attached) {
+            bus.detach(*device);
+        }
+        _attached.assign(devices.begin(), devices.end());
+        for (auto device : _attached) {
+            bus.attach(*device);
+        }
+        wire.reset();
+        bus.resetCounters();
+    }
+
+    /// Run the simulation until the running asynchronous transaction is finished.
+    ///
+    /// @return `true` if the transaction finished in time.
+    ///
+    bool waitForAsync(sim::Cycles maximum = sim::fromMilliseconds(200)) {
+        return sim::runUntil([this]() -> bool { return !wire.isAsyncBusy(); }, maximum);
+    }
+
+public:
+    sim::I2cBus bus; ///< The simulated bus.
+    WireMaster_SAMD21 wire; ///< The driver.
+
+private:
+    WireFixture() : wire(cInterface, cPinSDA, cPinSCL) {
+        sim::getI2cMaster(WireMaster_SAMD21::getSercomIndex(cInterface)).attachBus(&bus);
+        sim::getPort().connectBus(bus, cPinSDA, cPinSCL);
+        wire.initialize();
+    }
+
+private:
+    std::vector<sim::I2cDevice*> _attached; ///< The devices attached for the current test.
+};
+
+
+}
+
@@ -0,0 +1,211 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+
+
+
+namespace {
+
+
+/// The result reported to the callback.
+///
+struct CallbackResult {
+    uint32_t count; ///< The number of calls.
+    Status status; ///< The last reported status.
+    bool isBusyInCallback; ///< If the driver reported a busy transaction in the callback.
+};
+
+
+/// The callback for the transactions.
+///
+void onFinished(void *context, Status status)
+{
+    auto result = static_cast<CallbackResult*>(context);
+    ++result->count;
+    result->status = status;
+    result->isBusyInCallback = test::WireFixture::get().wire.isAsyncBusy();
+}
+
+
+}
+
+
+LR_TEST(writeBytesInInterrupts)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    const uint8_t values[] = {0x10, 0xa1, 0xa2, 0xa3};
+    CallbackResult result = {};
+    const auto interrupts = sim::getInterruptCount();
+    LR_REQUIRE(fixture.wire.writeBytesAsync(0x40, values, 4, &onFinished, &result) == Status::Success);
+    // The call returns after the address is written, the bus is driven by the interrupts.
+    LR_CHECK(fixture.wire.isAsyncBusy());
+    LR_CHECK(fixture.bus.getCounters().bytesWritten == 0);
+    LR_CHECK(fixture.wire.writeBytesAsync(0x40, values, 4) == Status::Error);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(result.count == 1);
+    LR_CHECK(result.status == Status::Success);
+    LR_CHECK(!result.isBusyInCallback);
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    LR_CHECK(sim::getInterruptCount() - interrupts >= 5);
+    LR_CHECK(device.getRegister(0x10) == 0xa1);
+    LR_CHECK(device.getRegister(0x11) == 0xa2);
+    LR_CHECK(device.getRegister(0x12) == 0xa3);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().stops == 1);
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(readRegisterDataInInterrupts)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    for (uint8_t i = 0; i < 8; ++i) {
+        device.setRegister(static_cast<uint8_t>(0x30 + i), static_cast<uint8_t>(0xc0 + i));
+    }
+    uint8_t data[8] = {};
+    CallbackResult result = {};
+    LR_REQUIRE(fixture.wire.readRegisterDataAsync(0x40, 0x30, data, 8, &onFinished, &result) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(result.count == 1);
+    LR_CHECK(result.status == Status::Success);
+    for (uint8_t i = 0; i < 8; ++i) {
+        LR_CHECK(data[i] == 0xc0 + i);
+    }
+    sim::runFor(sim::fromMicroseconds(100));
+    const auto &counters = fixture.bus.getCounters();
+    LR_CHECK(counters.starts == 1);
+    LR_CHECK(counters.repeatedStarts == 1);
+    LR_CHECK(counters.stops == 1);
+    LR_CHECK(counters.bytesRead == 8);
+}
+
+
+LR_TEST(readBytesInInterrupts)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    device.setRegister(0x00, 0x5a);
+    device.setRegister(0x01, 0xa5);
+    uint8_t data[2] = {};
+    LR_REQUIRE(fixture.wire.readBytesAsync(0x40, data, 2) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    LR_CHECK(data[0] == 0x5a);
+    LR_CHECK(data[1] == 0xa5);
+    // A single byte is answered with a NACK directly.
+    LR_REQUIRE(fixture.wire.readBytesAsync(0x40, data, 1) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    LR_CHECK(data[0] == 0x00);
+}
+
+
+LR_TEST(missingDeviceFinishesWithAddressNotFound)
+{
+    auto &fixture = test::WireFixture::get();
+    fixture.prepare({});
+    const uint8_t value = 0x01;
+    CallbackResult result = {};
+    LR_REQUIRE(fixture.wire.writeBytesAsync(0x22, &value, 1, &onFinished, &result) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(result.count == 1);
+    LR_CHECK(result.status == Status::AddressNotFound);
+    uint8_t data = 0;
+    LR_REQUIRE(fixture.wire.readBytesAsync(0x22, &data, 1, &onFinished, &result) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(result.count == 2);
+    LR_CHECK(result.status == Status::AddressNotFound);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().addressNacks == 2);
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(nackedByteFinishesWithNoAcknowledge)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::NackDevice device(0x21, 1);
+    fixture.prepare({&device});
+    const uint8_t values[] = {1, 2, 3};
+    LR_REQUIRE(fixture.wire.writeBytesAsync(0x21, values, 3) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::NoAcknowledge);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().bytesWritten == 2);
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(busyBusIsNotWaitedFor)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::StuckDevice device(0x40);
+    fixture.prepare({&device});
+    device.holdData(9);
+    LR_CHECK(!fixture.wire.isBusFree());
+    const uint8_t value = 0x01;
+    const auto startCycles = sim::getCycles();
+    LR_CHECK(fixture.wire.writeBytesAsync(0x40, &value, 1) == Status::Timeout);
+    LR_CHECK(!fixture.wire.isAsyncBusy());
+    LR_CHECK(sim::getCycles() - startCycles < sim::fromMicroseconds(10));
+    LR_CHECK(fixture.wire.recoverBus() == Status::Success);
+    LR_CHECK(fixture.wire.isBusFree());
+    LR_CHECK(fixture.wire.writeBytesAsync(0x40, &value, 1) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+}
+
+
+LR_TEST(resetAbortsTheTransaction)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    const uint8_t values[] = {0x00, 1, 2, 3, 4, 5, 6, 7};
+    CallbackResult result = {};
+    LR_REQUIRE(fixture.wire.writeBytesAsync(0x40, values, 8, &onFinished, &result) == Status::Success);
+    sim::runFor(sim::fromMicroseconds(300));
+    LR_REQUIRE(fixture.wire.isAsyncBusy());
+    LR_CHECK(fixture.wire.reset() == Status::Success);
+    LR_CHECK(!fixture.wire.isAsyncBusy());
+    LR_CHECK(result.count == 1);
+    LR_CHECK(result.status == Status::Error);
+    // No interrupt continues the aborted transaction.
+    const auto bytesWritten = fixture.bus.getCounters().bytesWritten;
+    sim::runFor(sim::fromMilliseconds(2));
+    LR_CHECK(fixture.bus.getCounters().bytesWritten == bytesWritten);
+    LR_CHECK(result.count == 1);
+    uint8_t data = 0;
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x01, &data, 1) == Status::Success);
+}
+
+
+LR_TEST_MAIN()
+
@@ -0,0 +1,222 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "DmaControllerModel.hpp"
+#include "VirtualDevices.hpp"
+
+#include "Dma_SAMD21.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+
+
+namespace {
+
+
+/// The DMA channel for the tests.
+///
+constexpr uint8_t cDmaChannel = 3;
+
+
+/// Prepare the fixture with a DMA channel.
+///
+void prepareDma(std::initializer_list<sim::I2cDevice*> devices)
+{
+    auto &fixture = test::WireFixture::get();
+    fixture.prepare(devices);
+    LR_REQUIRE(fixture.wire.setDmaChannel(cDmaChannel) == Status::Success);
+}
+
+
+}
+
+
+LR_TEST(descriptorsPointAfterTheLastByte)
+{
+    uint8_t source[4] = {};
+    uint8_t destination[4] = {};
+    DmacDescriptor last = {};
+    DmacDescriptor first = {};
+    Dma::prepareDescriptor(last, source, true, destination, false, 4);
+    Dma::prepareDescriptor(first, source, false, destination, true, 4, &last);
+    LR_CHECK(last.BTCNT.reg == 4);
+    LR_CHECK(last.SRCADDR.reg == reinterpret_cast<uintptr_t>(source) + 4);
+    LR_CHECK(last.DSTADDR.reg == reinterpret_cast<uintptr_t>(destination));
+    LR_CHECK(last.DESCADDR.reg == 0);
+    LR_CHECK((last.BTCTRL.reg & DMAC_BTCTRL_VALID) != 0);
+    LR_CHECK((last.BTCTRL.reg & DMAC_BTCTRL_SRCINC) != 0);
+    LR_CHECK((last.BTCTRL.reg & DMAC_BTCTRL_DSTINC) == 0);
+    LR_CHECK((last.BTCTRL.reg & DMAC_BTCTRL_BLOCKACT_Msk) == DMAC_BTCTRL_BLOCKACT_INT);
+    LR_CHECK(first.SRCADDR.reg == reinterpret_cast<uintptr_t>(source));
+    LR_CHECK(first.DSTADDR.reg == reinterpret_cast<uintptr_t>(destination) + 4);
+    LR_CHECK(first.DESCADDR.reg == reinterpret_cast<uintptr_t>(&last));
+    LR_CHECK((first.BTCTRL.reg & DMAC_BTCTRL_BLOCKACT_Msk) == DMAC_BTCTRL_BLOCKACT_NOACT);
+}
+
+
+LR_TEST(writeBytesWithDma)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    prepareDma({&device});
+    uint8_t values[33];
+    values[0] = 0x20;
+    for (uint8_t i = 1; i < 33; ++i) {
+        values[i] = static_cast<uint8_t>(i * 3);
+    }
+    const auto beats = sim::getDmaController().getBeatCount();
+    const auto sercomInterrupts = sim::getInterruptCount(SERCOM3_IRQn);
+    const auto dmaInterrupts = sim::getInterruptCount(DMAC_IRQn);
+    LR_REQUIRE(fixture.wire.writeBytesDma(0x40, values, 33) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    for (uint8_t i = 1; i < 33; ++i) {
+        LR_CHECK(device.getRegister(static_cast<uint8_t>(0x20 + i - 1)) == values[i]);
+    }
+    LR_CHECK(sim::getDmaController().getBeatCount() - beats == 33);
+    // The DMA completion and the MB interrupt for the last byte, no interrupt per byte.
+    LR_CHECK(sim::getInterruptCount(DMAC_IRQn) - dmaInterrupts == 1);
+    LR_CHECK(sim::getInterruptCount(SERCOM3_IRQn) - sercomInterrupts <= 2);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().bytesWritten == 33);
+    LR_CHECK(fixture.bus.getCounters().stops == 1);
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(registerWriteChainsTwoDescriptors)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    prepareDma({&device});
+    const uint8_t values[] = {0x11, 0x22, 0x33, 0x44, 0x55};
+    const auto beats = sim::getDmaController().getBeatCount();
+    LR_REQUIRE(fixture.wire.writeRegisterDataDma(0x40, 0x80, values, 5) == Status::Success);
+    // The first descriptor sends the register address and links the data.
+    const auto &descriptor = Dma::getDescriptor(cDmaChannel);
+    LR_CHECK(descriptor.BTCNT.reg == 1);
+    LR_CHECK(descriptor.DESCADDR.reg != 0);
+    const auto &next = *reinterpret_cast<const DmacDescriptor*>(descriptor.DESCADDR.reg);
+    LR_CHECK(next.BTCNT.reg == 5);
+    LR_CHECK(next.SRCADDR.reg == reinterpret_cast<uintptr_t>(values) + 5);
+    LR_CHECK(next.DESCADDR.reg == 0);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    for (uint8_t i = 0; i < 5; ++i) {
+        LR_CHECK(device.getRegister(static_cast<uint8_t>(0x80 + i)) == values[i]);
+    }
+    LR_CHECK(sim::getDmaController().getBeatCount() - beats == 6);
+}
+
+
+LR_TEST(readWithDma)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    prepareDma({&device});
+    for (uint16_t i = 0; i < 64; ++i) {
+        device.setRegister(static_cast<uint8_t>(i), static_cast<uint8_t>(0xff - i));
+    }
+    uint8_t data[64] = {};
+    LR_REQUIRE(fixture.wire.readRegisterDataDma(0x40, 0x10, data, 20) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    for (uint8_t i = 0; i < 20; ++i) {
+        LR_CHECK(data[i] == 0xff - 0x10 - i);
+    }
+    // The length counter sends the NACK and the stop condition.
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().repeatedStarts == 1);
+    LR_CHECK(fixture.bus.getCounters().bytesRead == 20);
+    LR_CHECK(fixture.bus.getCounters().stops == 1);
+    LR_CHECK(!fixture.bus.isBusy());
+    // A plain read continues at the register pointer.
+    fixture.bus.resetCounters();
+    LR_REQUIRE(fixture.wire.readBytesDma(0x40, data, 4) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+    for (uint8_t i = 0; i < 4; ++i) {
+        LR_CHECK(data[i] == 0xff - 0x24 - i);
+    }
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().bytesRead == 4);
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(nackStopsTheDmaWrite)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::NackDevice device(0x21, 3);
+    prepareDma({&device});
+    const uint8_t values[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    LR_REQUIRE(fixture.wire.writeBytesDma(0x21, values, 8) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::NoAcknowledge);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(fixture.bus.getCounters().bytesWritten == 4);
+    LR_CHECK(fixture.bus.getCounters().stops == 1);
+    LR_CHECK(!fixture.bus.isBusy());
+    // The channel is free for the next transfer.
+    LR_REQUIRE(fixture.wire.writeBytesDma(0x21, values, 2) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::Success);
+}
+
+
+LR_TEST(missingDeviceEndsTheDmaRead)
+{
+    auto &fixture = test::WireFixture::get();
+    prepareDma({});
+    uint8_t data[4] = {};
+    const auto beats = sim::getDmaController().getBeatCount();
+    LR_REQUIRE(fixture.wire.readBytesDma(0x33, data, 4) == Status::Success);
+    LR_REQUIRE(fixture.waitForAsync());
+    LR_CHECK(fixture.wire.getAsyncStatus() == Status::AddressNotFound);
+    LR_CHECK(sim::getDmaController().getBeatCount() == beats);
+    sim::runFor(sim::fromMicroseconds(100));
+    LR_CHECK(!fixture.bus.isBusy());
+}
+
+
+LR_TEST(invalidDescriptorReportsAnError)
+{
+    prepareDma({});
+    auto &descriptor = Dma::getDescriptor(cDmaChannel);
+    uint8_t value = 0;
+    Dma::prepareDescriptor(descriptor, &value, false, &value, false, 1);
+    descriptor.BTCTRL.reg = 0;
+    struct Result { uint32_t count; bool success; } result = {0, true};
+    LR_REQUIRE(Dma::startTransfer(cDmaChannel, Dma::getSercomTxTrigger(0), [](void *context, bool success) {
+        auto result = static_cast<Result*>(context);
+        ++result->count;
+        result->success = success;
+    }, &result));
+    sim::runFor(sim::fromMicroseconds(10));
+    LR_CHECK(result.count == 1);
+    LR_CHECK(!result.success);
+    Dma::abortTransfer(cDmaChannel);
+}
+
+
+LR_TEST_MAIN()
+
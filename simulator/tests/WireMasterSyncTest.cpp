@@ -0,0 +1,226 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+
+
+LR_TEST(registerMapWriteAndRead)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    const uint8_t values[] = {0x11, 0x22, 0x33};
+    LR_CHECK(fixture.wire.writeRegisterData(0x40, 0x10, values, 3) == Status::Success);
+    LR_CHECK(device.getRegister(0x10) == 0x11);
+    LR_CHECK(device.getRegister(0x11) == 0x22);
+    LR_CHECK(device.getRegister(0x12) == 0x33);
+    device.setRegister(0x20, 0xa5);
+    device.setRegister(0x21, 0x5a);
+    uint8_t data[2] = {};
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x20, data, 2) == Status::Success);
+    LR_CHECK(data[0] == 0xa5);
+    LR_CHECK(data[1] == 0x5a);
+    const auto &counters = fixture.bus.getCounters();
+    LR_CHECK(counters.starts == 2);
+    LR_CHECK(counters.repeatedStarts == 1);
+    LR_CHECK(counters.stops == 2);
+    LR_CHECK(counters.bytesWritten == 5);
+    LR_CHECK(counters.bytesRead == 2);
+    LR_CHECK(counters.addressNacks == 0);
+}
+
+
+LR_TEST(missingDeviceIsNotAcknowledged)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    uint8_t data = 0;
+    LR_CHECK(fixture.wire.readBytes(0x50, &data, 1) == Status::NoAcknowledge);
+    LR_CHECK(fixture.wire.writeRegisterData(0x51, 0x00, 0x01) == Status::AddressNotFound);
+    LR_CHECK(fixture.bus.getCounters().addressNacks == 2);
+    // The next transaction reaches the device.
+    LR_CHECK(fixture.wire.writeRegisterData(0x40, 0x00, 0x01) == Status::Success);
+    LR_CHECK(device.getRegister(0x00) == 0x01);
+}
+
+
+LR_TEST(nackDeviceStopsTheWrite)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::NackDevice device(0x21, 2);
+    fixture.prepare({&device});
+    const uint8_t values[] = {1, 2, 3, 4};
+    LR_CHECK(fixture.wire.writeBytes(0x21, values, 4) == Status::NoAcknowledge);
+    const auto &counters = fixture.bus.getCounters();
+    LR_CHECK(counters.bytesWritten == 3);
+    LR_CHECK(counters.dataNacks == 1);
+    LR_CHECK(counters.stops == 1);
+    // The bus is usable after the error.
+    LR_CHECK(fixture.wire.writeBytes(0x21, values, 2) == Status::Success);
+}
+
+
+LR_TEST(eepromPageWriteWithAcknowledgePolling)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::EepromDevice eeprom(0x50);
+    fixture.prepare({&eeprom});
+    uint8_t page[16];
+    for (uint8_t i = 0; i < 16; ++i) {
+        page[i] = static_cast<uint8_t>(0x80u + i);
+    }
+    LR_REQUIRE(fixture.wire.writeMemory(0x50, 0x0130, page, 16) == Status::Success);
+    LR_CHECK(eeprom.isWriting());
+    // Poll with the address, until the write cycle is finished.
+    uint32_t polls = 0;
+    while (fixture.wire.writeBegin(0x50) == Status::AddressNotFound) {
+        ++polls;
+        LR_REQUIRE(polls < 1000);
+    }
+    LR_CHECK(fixture.wire.writeEndAndStop() == Status::Success);
+    LR_CHECK(polls > 0);
+    LR_CHECK(eeprom.getBusyNackCount() == polls);
+    LR_CHECK(!eeprom.isWriting());
+    uint8_t data[16] = {};
+    LR_CHECK(fixture.wire.readMemory(0x50, 0x0130, data, 16) == Status::Success);
+    for (uint8_t i = 0; i < 16; ++i) {
+        LR_CHECK(data[i] == page[i]);
+    }
+    LR_CHECK(eeprom.getMemory()[0x012f] == 0xff);
+    LR_CHECK(eeprom.getMemory()[0x0140] == 0xff);
+}
+
+
+LR_TEST(eepromWriteWrapsAtThePage)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::EepromDevice eeprom(0x51, 1024, 16, sim::fromMicroseconds(100));
+    fixture.prepare({&eeprom});
+    const uint8_t values[] = {1, 2, 3, 4};
+    LR_REQUIRE(fixture.wire.writeMemory(0x51, 0x001e, values, 4) == Status::Success);
+    auto &memory = eeprom.getMemory();
+    LR_CHECK(memory[0x1e] == 1);
+    LR_CHECK(memory[0x1f] == 2);
+    LR_CHECK(memory[0x10] == 3);
+    LR_CHECK(memory[0x11] == 4);
+    LR_CHECK(memory[0x20] == 0xff);
+}
+
+
+LR_TEST(clockStretchingExtendsTheTransfer)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    uint8_t data[4] = {};
+    LR_REQUIRE(fixture.wire.readRegisterData(0x40, 0x00, data, 4) == Status::Success);
+    const auto plainCycles = fixture.bus.getCounters().busyCycles;
+    fixture.bus.resetCounters();
+    constexpr auto cStretch = sim::fromMicroseconds(20);
+    device.setStretchCycles(cStretch);
+    LR_REQUIRE(fixture.wire.readRegisterData(0x40, 0x00, data, 4) == Status::Success);
+    const auto stretchedCycles = fixture.bus.getCounters().busyCycles;
+    // The device stretches the clock for the written and the four read bytes.
+    LR_CHECK(stretchedCycles >= plainCycles + 5 * cStretch);
+    LR_CHECK(stretchedCycles < plainCycles + 5 * cStretch + sim::fromMicroseconds(10));
+}
+
+
+LR_TEST(busCyclesMatchTheClock)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    LR_REQUIRE(fixture.wire.setSpeed(400'000, Nanoseconds(100)) == Status::Success);
+    const uint8_t values[] = {1, 2, 3, 4, 5, 6, 7};
+    LR_REQUIRE(fixture.wire.writeRegisterData(0x40, 0x00, values, 7) == Status::Success);
+    const auto &counters = fixture.bus.getCounters();
+    // The address, eight bytes and the stop condition.
+    LR_CHECK(counters.sclPeriods >= 9 * 9);
+    const auto expected = counters.sclPeriods * (sim::cCpuClock / 400'000);
+    LR_CHECK(counters.busyCycles >= expected * 95 / 100);
+    LR_CHECK(counters.busyCycles <= expected * 115 / 100);
+    LR_REQUIRE(fixture.wire.setSpeed(WireMaster::Speed::Standard, Nanoseconds(100)) == Status::Success);
+}
+
+
+LR_TEST(stuckBusIsRecoveredAfterTheThreshold)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::StuckDevice device(0x40);
+    fixture.prepare({&device});
+    fixture.wire.setRecoveryThreshold(2);
+    const auto recoveries = fixture.wire.getRecoveryCount();
+    // The device holds SDA low, the interface sees a busy bus.
+    device.holdData(5);
+    uint8_t data = 0;
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x00, &data, 1) != Status::Success);
+    LR_CHECK(fixture.wire.getRecoveryCount() == recoveries);
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x00, &data, 1) != Status::Success);
+    LR_CHECK(fixture.wire.getRecoveryCount() == recoveries + 1);
+    LR_CHECK(!device.isHoldingData());
+    LR_CHECK(fixture.bus.getCounters().clockPulses >= 5);
+    device.setRegister(0x00, 0x42);
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x00, &data, 1) == Status::Success);
+    LR_CHECK(data == 0x42);
+    fixture.wire.setRecoveryThreshold(3);
+}
+
+
+LR_TEST(highSpeedFallsBackToFastMode)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice fastDevice(0x40);
+    sim::RegisterMapDevice highSpeedDevice(0x41);
+    highSpeedDevice.setHighSpeed(true);
+    fixture.prepare({&fastDevice, &highSpeedDevice});
+    LR_REQUIRE(fixture.wire.setSpeed(WireMaster::Speed::HighSpeed, Nanoseconds(100)) == Status::Success);
+    fastDevice.setRegister(0x05, 0x77);
+    highSpeedDevice.setRegister(0x05, 0x88);
+    uint8_t data = 0;
+    // The device ignores the high-speed address, the driver retries in fast mode.
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x05, &data, 1) == Status::Success);
+    LR_CHECK(data == 0x77);
+    LR_CHECK(fixture.bus.getCounters().addressNacks == 1);
+    // The fallback is remembered for the device.
+    fixture.bus.resetCounters();
+    data = 0;
+    LR_CHECK(fixture.wire.readRegisterData(0x40, 0x05, &data, 1) == Status::Success);
+    LR_CHECK(data == 0x77);
+    LR_CHECK(fixture.bus.getCounters().addressNacks == 0);
+    const auto fastCycles = fixture.bus.getCounters().busyCycles;
+    // The device with high-speed support is addressed after the master code, which is faster.
+    fixture.bus.resetCounters();
+    data = 0;
+    LR_CHECK(fixture.wire.readRegisterData(0x41, 0x05, &data, 1) == Status::Success);
+    LR_CHECK(data == 0x88);
+    LR_CHECK(fixture.bus.getCounters().addressNacks == 0);
+    LR_CHECK(fixture.bus.getCounters().busyCycles < fastCycles / 2);
+    LR_REQUIRE(fixture.wire.setSpeed(WireMaster::Speed::Standard, Nanoseconds(100)) == Status::Success);
+}
+
+
+LR_TEST_MAIN()
+
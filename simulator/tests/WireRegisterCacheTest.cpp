@@ -0,0 +1,102 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include "WireRegisterCache.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+using Cache = WireRegisterCache<64>;
+
+
+LR_TEST(cachedReadsStayInRam)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    device.setRegister(0x05, 0x5a);
+    Cache cache(fixture.wire, 0x40);
+    cache.setCacheable(0x00, 0x10);
+    uint8_t value = 0;
+    LR_CHECK(cache.read(0x05, value) == Status::Success);
+    LR_CHECK(cache.read(0x05, value) == Status::Success);
+    LR_CHECK(value == 0x5a);
+    // A register read addresses the device twice, with a repeated start.
+    LR_CHECK(device.getTransactionCount() == 2);
+    // Registers which are not cacheable are always read from the device.
+    LR_CHECK(cache.read(0x20, value) == Status::Success);
+    LR_CHECK(cache.read(0x20, value) == Status::Success);
+    LR_CHECK(device.getTransactionCount() == 6);
+    // A modification without a change is not written.
+    LR_CHECK(cache.modify(0x05, 0x0f, 0x0a) == Status::Success);
+    LR_CHECK(device.getTransactionCount() == 6);
+    LR_CHECK(cache.modify(0x05, 0x0f, 0x03) == Status::Success);
+    LR_CHECK(device.getRegister(0x05) == 0x53);
+}
+
+
+LR_TEST(dirtyRegistersAreMergedIntoBursts)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    Cache cache(fixture.wire, 0x40);
+    cache.setCacheable(0x00, 64);
+    LR_CHECK(cache.setDeferred(0x10, 0x01) == Status::Success);
+    LR_CHECK(cache.setDeferred(0x11, 0x02) == Status::Success);
+    LR_CHECK(cache.setDeferred(0x12, 0x03) == Status::Success);
+    LR_CHECK(cache.setDeferred(0x20, 0x04) == Status::Success);
+    LR_CHECK(cache.hasDirty());
+    LR_CHECK(cache.syncDirty() == Status::Success);
+    LR_CHECK(!cache.hasDirty());
+    LR_CHECK(device.getTransactionCount() == 2);
+    LR_CHECK(device.getRegister(0x11) == 0x02);
+    LR_CHECK(device.getRegister(0x12) == 0x03);
+    LR_CHECK(device.getRegister(0x20) == 0x04);
+}
+
+
+LR_TEST(failedWriteDiscardsTheDeferredValue)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    Cache cache(fixture.wire, 0x40);
+    cache.setCacheable(0x00, 64);
+    LR_CHECK(cache.setDeferred(0x10, 0x11) == Status::Success);
+    // The direct write fails, the device state of the register is unknown.
+    fixture.bus.detach(device);
+    LR_CHECK(cache.write(0x10, 0x22) == Status::AddressNotFound);
+    fixture.bus.attach(device);
+    // The older deferred value must not overwrite the register.
+    LR_CHECK(!cache.hasDirty());
+    LR_CHECK(cache.syncDirty() == Status::Success);
+    LR_CHECK(device.getTransactionCount() == 0);
+    device.setRegister(0x10, 0x33);
+    uint8_t value = 0;
+    LR_CHECK(cache.read(0x10, value) == Status::Success);
+    LR_CHECK(value == 0x33);
+}
+
+
+LR_TEST_MAIN()
+
@@ -0,0 +1,296 @@
+//
+// (c)2019 by Lucky Resistor. See LICENSE for details.
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+//
+#include "Test.hpp"
+#include "WireFixture.hpp"
+
+#include "VirtualDevices.hpp"
+
+#include "WireScheduler_SAMD21.hpp"
+
+
+using namespace lr;
+using Status = WireMaster::Status;
+using Request = WireScheduler::Request;
+using Operation = WireScheduler::Operation;
+
+
+namespace {
+
+
+/// The two additional buses, beside the bus of the fixture.
+///
+/// SERCOM1 uses PA16/PA17, SERCOM4 uses PB08/PB09 as on the Feather M0.
+///
+struct ExtraBuses
+{
+    static ExtraBuses& get() {
+        static ExtraBuses buses;
+        return buses;
+    }
+
+    sim::I2cBus bus1; ///< The bus of SERCOM1.
+    sim::I2cBus bus4; ///< The bus of SERCOM4.
+    WireMaster_SAMD21 wire1; ///< The driver for SERCOM1.
+    WireMaster_SAMD21 wire4; ///< The driver for SERCOM4.
+
+private:
+    ExtraBuses()
+        : wire1(WireMaster_SAMD21::Interface::SerCom1, 16, 17),
+        wire4(WireMaster_SAMD21::Interface::SerCom4Alt, 40, 41)
+    {
+        sim::getI2cMaster(1).attachBus(&bus1);
+        sim::getI2cMaster(4).attachBus(&bus4);
+        sim::getPort().connectBus(bus1, 16, 17);
+        sim::getPort().connectBus(bus4, 40, 41);
+        wire1.initialize();
+        wire4.initialize();
+    }
+};
+
+
+/// Create a write request.
+///
+Request makeWrite(uint16_t tag, uint8_t address, uint8_t registerAddress, uint8_t *data, uint8_t count)
+{
+    return Request{tag, address, registerAddress, Operation::WriteRegister, data, count};
+}
+
+
+/// Run the simulation until the scheduler is idle.
+///
+bool waitForIdle(const WireScheduler &scheduler, sim::Cycles maximum = sim::fromMilliseconds(200))
+{
+    return sim::runUntil([&scheduler]() -> bool { return scheduler.isIdle(); }, maximum);
+}
+
+
+}
+
+
+LR_TEST(invalidBusIsRejected)
+{
+    auto &fixture = test::WireFixture::get();
+    fixture.prepare({});
+    WireScheduler scheduler;
+    uint8_t value = 0;
+    LR_CHECK(scheduler.submit(0, makeWrite(1, 0x40, 0x00, &value, 1)) == WireScheduler::Status::Error);
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    LR_CHECK(scheduler.submit(1, makeWrite(1, 0x40, 0x00, &value, 1)) == WireScheduler::Status::Error);
+    LR_CHECK(scheduler.isIdle());
+}
+
+
+LR_TEST(transfersOnThreeBusesOverlap)
+{
+    auto &fixture = test::WireFixture::get();
+    auto &extra = ExtraBuses::get();
+    sim::RegisterMapDevice device3(0x40);
+    sim::RegisterMapDevice device1(0x40);
+    sim::RegisterMapDevice device4(0x40);
+    fixture.prepare({&device3});
+    extra.bus1.attach(device1);
+    extra.bus4.attach(device4);
+    WireScheduler scheduler;
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.addBus(extra.wire1) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.addBus(extra.wire4) == WireScheduler::Status::Success);
+    uint8_t data[3][16];
+    for (uint8_t bus = 0; bus < 3; ++bus) {
+        for (uint8_t i = 0; i < 16; ++i) {
+            data[bus][i] = static_cast<uint8_t>((bus << 4u) | i);
+        }
+    }
+    // The time for one bus alone.
+    auto startCycles = sim::getCycles();
+    LR_REQUIRE(scheduler.submit(0, makeWrite(10, 0x40, 0x00, data[0], 16)) == WireScheduler::Status::Success);
+    LR_REQUIRE(waitForIdle(scheduler));
+    const auto singleCycles = sim::getCycles() - startCycles;
+    WireScheduler::Completion completion = {};
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 10);
+    LR_CHECK(completion.bus == 0);
+    LR_CHECK(completion.status == Status::Success);
+    // All three buses at once take about the same time.
+    startCycles = sim::getCycles();
+    for (uint8_t bus = 0; bus < 3; ++bus) {
+        LR_REQUIRE(scheduler.submit(bus, makeWrite(static_cast<uint16_t>(20 + bus), 0x40, 0x20, data[bus], 16)) ==
+            WireScheduler::Status::Success);
+    }
+    LR_REQUIRE(waitForIdle(scheduler));
+    const auto parallelCycles = sim::getCycles() - startCycles;
+    LR_CHECK(parallelCycles < singleCycles + singleCycles / 2);
+    bool seen[3] = {};
+    while (scheduler.getCompletion(completion)) {
+        LR_CHECK(completion.status == Status::Success);
+        LR_REQUIRE(completion.bus < 3);
+        LR_CHECK(completion.tag == 20 + completion.bus);
+        seen[completion.bus] = true;
+    }
+    LR_CHECK(seen[0] && seen[1] && seen[2]);
+    for (uint8_t i = 0; i < 16; ++i) {
+        LR_CHECK(device3.getRegister(static_cast<uint8_t>(0x20 + i)) == data[0][i]);
+        LR_CHECK(device1.getRegister(static_cast<uint8_t>(0x20 + i)) == data[1][i]);
+        LR_CHECK(device4.getRegister(static_cast<uint8_t>(0x20 + i)) == data[2][i]);
+    }
+    extra.bus1.detach(device1);
+    extra.bus4.detach(device4);
+}
+
+
+LR_TEST(requestsOfABusRunInOrder)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    device.setRegister(0x30, 0x5a);
+    WireScheduler scheduler;
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    uint8_t value = 0xa5;
+    uint8_t readValue = 0;
+    // A missing device does not block the following requests.
+    LR_REQUIRE(scheduler.submit(0, makeWrite(1, 0x41, 0x30, &value, 1)) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.submit(0, Request{2, 0x40, 0x30, Operation::ReadRegister, &readValue, 1}) ==
+        WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.submit(0, makeWrite(3, 0x40, 0x30, &value, 1)) == WireScheduler::Status::Success);
+    LR_REQUIRE(waitForIdle(scheduler));
+    WireScheduler::Completion completion = {};
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 1);
+    LR_CHECK(completion.status == Status::AddressNotFound);
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 2);
+    LR_CHECK(completion.status == Status::Success);
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 3);
+    LR_CHECK(completion.status == Status::Success);
+    LR_CHECK(!scheduler.getCompletion(completion));
+    LR_CHECK(readValue == 0x5a);
+    LR_CHECK(device.getRegister(0x30) == 0xa5);
+}
+
+
+LR_TEST(requestsWaitForABusyBus)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::StuckDevice device(0x40);
+    fixture.prepare({&device});
+    device.holdData(9);
+    WireScheduler scheduler;
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    uint8_t values[WireScheduler::cRequestQueueSize];
+    for (uint8_t i = 0; i < WireScheduler::cRequestQueueSize; ++i) {
+        values[i] = i;
+        LR_REQUIRE(scheduler.submit(0, makeWrite(i, 0x40, i, &values[i], 1)) == WireScheduler::Status::Success);
+    }
+    LR_CHECK(scheduler.submit(0, makeWrite(99, 0x40, 0x00, &values[0], 1)) == WireScheduler::Status::QueueFull);
+    // The requests stay in the queue, while the bus is not free.
+    sim::runFor(sim::fromMilliseconds(1));
+    WireScheduler::Completion completion = {};
+    LR_CHECK(!scheduler.getCompletion(completion));
+    LR_CHECK(!scheduler.isIdle());
+    LR_CHECK(fixture.bus.getCounters().starts == 0);
+    // After the recovery, the next poll starts the queue.
+    LR_REQUIRE(fixture.wire.recoverBus() == Status::Success);
+    scheduler.poll();
+    LR_REQUIRE(waitForIdle(scheduler));
+    for (uint8_t i = 0; i < WireScheduler::cRequestQueueSize; ++i) {
+        LR_REQUIRE(scheduler.getCompletion(completion));
+        LR_CHECK(completion.tag == i);
+        LR_CHECK(completion.status == Status::Success);
+        LR_CHECK(device.getRegister(i) == i);
+    }
+    LR_CHECK(scheduler.getDroppedCount() == 0);
+}
+
+
+LR_TEST(resetContinuesWithTheNextRequest)
+{
+    auto &fixture = test::WireFixture::get();
+    sim::RegisterMapDevice device(0x40);
+    fixture.prepare({&device});
+    WireScheduler scheduler;
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    uint8_t first[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t second[2] = {0xa1, 0xa2};
+    LR_REQUIRE(scheduler.submit(0, makeWrite(1, 0x40, 0x00, first, 8)) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.submit(0, makeWrite(2, 0x40, 0x40, second, 2)) == WireScheduler::Status::Success);
+    sim::runFor(sim::fromMicroseconds(300));
+    LR_REQUIRE(fixture.wire.isAsyncBusy());
+    // The callback of the aborted request starts the next one, after the reset.
+    LR_CHECK(fixture.wire.reset() == Status::Success);
+    LR_CHECK(fixture.wire.isAsyncBusy());
+    LR_REQUIRE(waitForIdle(scheduler));
+    WireScheduler::Completion completion = {};
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 1);
+    LR_CHECK(completion.status == Status::Error);
+    LR_REQUIRE(scheduler.getCompletion(completion));
+    LR_CHECK(completion.tag == 2);
+    LR_CHECK(completion.status == Status::Success);
+    LR_CHECK(device.getRegister(0x40) == 0xa1);
+    LR_CHECK(device.getRegister(0x41) == 0xa2);
+}
+
+
+LR_TEST(fullCompletionQueueDropsTheOldest)
+{
+    auto &fixture = test::WireFixture::get();
+    auto &extra = ExtraBuses::get();
+    sim::RegisterMapDevice device3(0x40);
+    sim::RegisterMapDevice device1(0x40);
+    sim::RegisterMapDevice device4(0x40);
+    fixture.prepare({&device3});
+    extra.bus1.attach(device1);
+    extra.bus4.attach(device4);
+    WireScheduler scheduler;
+    LR_REQUIRE(scheduler.addBus(fixture.wire) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.addBus(extra.wire1) == WireScheduler::Status::Success);
+    LR_REQUIRE(scheduler.addBus(extra.wire4) == WireScheduler::Status::Success);
+    uint8_t value = 0x01;
+    for (uint8_t i = 0; i < 6; ++i) {
+        for (uint8_t bus = 0; bus < 3; ++bus) {
+            LR_REQUIRE(scheduler.submit(bus, makeWrite(static_cast<uint16_t>(bus * 100 + i), 0x40, i, &value, 1)) ==
+                WireScheduler::Status::Success);
+        }
+    }
+    LR_REQUIRE(waitForIdle(scheduler));
+    LR_CHECK(scheduler.getDroppedCount() == 18 - WireScheduler::cCompletionQueueSize);
+    // The oldest completions are dropped, the last request of each bus is kept.
+    uint8_t completionCount = 0;
+    uint8_t firstCount = 0;
+    uint8_t lastCount = 0;
+    WireScheduler::Completion completion = {};
+    while (scheduler.getCompletion(completion)) {
+        ++completionCount;
+        LR_CHECK(completion.tag == completion.bus * 100 + completion.tag % 100);
+        if (completion.tag % 100 == 0) {
+            ++firstCount;
+        } else if (completion.tag % 100 == 5) {
+            ++lastCount;
+        }
+    }
+    LR_CHECK(completionCount == WireScheduler::cCompletionQueueSize);
+    LR_CHECK(firstCount == 1);
+    LR_CHECK(lastCount == 3);
+    extra.bus1.detach(device1);
+    extra.bus4.detach(device4);
+}
+
+
+LR_TEST_MAIN()
+
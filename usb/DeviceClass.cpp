@@ -26,7 +26,7 @@
 #include "InterruptHandler.hpp"
 #include "ConfigDescriptor.hpp"
 
-#include "../ClockCycles.hpp"
+#include "../SpinDeadline_SAMD21.hpp"
 
 #include <limits>
 #include <cstring>
@@ -291,6 +291,7 @@ void USBDeviceClass::setAddress(uint32_t addr)
     _deviceWrapper.epBank1SetReady(0);
 
     // Wait for transfer to complete
+    // No deadline: the address must only change after the status stage was sent, and there is no way to report a failure.
     while (!_deviceWrapper.epBank1IsTransferComplete(0)) {}
 
     // Set USB address to addr
@@ -513,8 +514,12 @@ uint8_t USBDeviceClass::armRecvCtrlOUT(uint32_t ep)
     _deviceWrapper.epBank0ResetReady(ep);
 
     // Wait OUT
-    while (!_deviceWrapper.epBank0IsReady(ep)) {}
-    while (!_deviceWrapper.epBank0IsTransferComplete(ep)) {}
+    SpinDeadline deadline{Milliseconds(TX_TIMEOUT_MS)};
+    while (!_deviceWrapper.epBank0IsReady(ep) || !_deviceWrapper.epBank0IsTransferComplete(ep)) {
+        if (deadline.hasTimeout()) {
+            return 0;
+        }
+    }
     return _deviceWrapper.epBank0ByteCount(ep);
 }
 
@@ -547,14 +552,12 @@ uint32_t USBDeviceClass::send(uint32_t ep, const void *data, uint32_t len)
         if (_deviceWrapper.epBank1IsReady(ep)) {
             // previous transfer is still not complete
 
-            // convert the timeout from microseconds to a number of times through
-            // the wait loop; it takes (roughly) 23 clock cycles per iteration.
-            uint32_t timeout = lr::ClockCycles::fromMicroseconds(TX_TIMEOUT_MS * 1000) / 23;
+            SpinDeadline deadline{Milliseconds(TX_TIMEOUT_MS)};
 
             // Wait for (previous) transfer to complete
             // inspired by Paul Stoffregen's work on Teensy
             while (!_deviceWrapper.epBank1IsTransferComplete(ep)) {
-                if (LastTransmitTimedOut[ep] || timeout-- == 0) {
+                if (LastTransmitTimedOut[ep] || deadline.hasTimeout()) {
                     LastTransmitTimedOut[ep] = 1;
 
                     // set byte count to zero, so that ZLP is sent
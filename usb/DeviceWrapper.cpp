@@ -21,6 +21,8 @@
 
 #include "InterruptGuard.hpp"
 
+#include "../SpinDeadline_SAMD21.hpp"
+
 #include <cstring>
 
 
@@ -81,6 +83,7 @@ void DeviceWrapper::init()
     GCLK->CLKCTRL.reg = GCLK_CLKCTRL_ID(6) | // Generic Clock Multiplexer 6
                         GCLK_CLKCTRL_GEN_GCLK0 | // Generic Clock Generator 0 is source
                         GCLK_CLKCTRL_CLKEN;
+    // No deadline: the USB clock must run before the peripheral is used, and there is no way to report a failure.
     while (GCLK->STATUS.bit.SYNCBUSY);
 }
 
@@ -89,7 +92,12 @@ void DeviceWrapper::reset()
 {
     _usb->CTRLA.bit.SWRST = 1;
     memset(_endPointDescriptor, 0, sizeof(_endPointDescriptor));
-    while (_usb->SYNCBUSY.bit.SWRST || _usb->SYNCBUSY.bit.ENABLE) {}
+    SpinDeadline deadline(Milliseconds(10));
+    while (_usb->SYNCBUSY.bit.SWRST || _usb->SYNCBUSY.bit.ENABLE) {
+        if (deadline.hasTimeout()) {
+            break;
+        }
+    }
     _usb->DESCADD.reg = (uint32_t) (&_endPointDescriptor);
 }
 